@@ -5,6 +5,8 @@
  *
  */
 
+#include <cassert>
+
 #include "LoFTR.hpp"
 
 namespace Ort
@@ -12,13 +14,8 @@ namespace Ort
 void LoFTR::preprocess(float* dst, const unsigned char* src, const int64_t targetImgWidth,
                        const int64_t targetImgHeight, const int numChannels) const
 {
-    for (int i = 0; i < targetImgHeight; ++i) {
-        for (int j = 0; j < targetImgWidth; ++j) {
-            for (int c = 0; c < numChannels; ++c) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                    (src[i * targetImgWidth * numChannels + j * numChannels + c] / 255.0);
-            }
-        }
-    }
+    assert(numChannels == IMG_CHANNEL);
+    this->preprocessInput<IMG_CHANNEL, Layout::HWC, ChannelOrder::BGR, InputNormalization>(
+        dst, src, targetImgWidth, targetImgHeight);
 }
 }  // namespace Ort
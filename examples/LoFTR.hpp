@@ -17,6 +17,7 @@ class LoFTR : public OrtSessionHandler
     static constexpr int64_t IMG_H = 480;
     static constexpr int64_t IMG_W = 640;
     static constexpr int64_t IMG_CHANNEL = 1;
+    using InputNormalization = UnitScaleNormalization;
 
     using OrtSessionHandler::OrtSessionHandler;
 
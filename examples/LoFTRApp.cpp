@@ -13,9 +13,11 @@ static constexpr float CONFIDENCE_THRESHOLD = 0.1;
 
 namespace
 {
+// gray images at the model input size, matches are mapped back to the original sizes
 std::pair<std::vector<cv::KeyPoint>, std::vector<cv::KeyPoint>>
-processOneImagePair(const Ort::LoFTR& loftrOsh, const cv::Mat& queryImg, const cv::Mat& refImg, float* queryData,
-                    float* refData, float confidenceThresh = CONFIDENCE_THRESHOLD);
+processOneImagePair(const Ort::LoFTR& loftrOsh, const cv::Mat& queryImg, const cv::Size& origQuerySize,
+                    const cv::Mat& refImg, const cv::Size& origRefSize, float* queryData, float* refData,
+                    float confidenceThresh = CONFIDENCE_THRESHOLD);
 }  // namespace
 
 int main(int argc, char* argv[])
@@ -37,19 +39,20 @@ int main(int argc, char* argv[])
             throw std::runtime_error("failed to open " + IMAGE_PATHS[i]);
         }
     }
-
-    std::transform(IMAGE_PATHS.begin(), IMAGE_PATHS.end(), std::back_inserter(grays),
-                   [](const auto& imagePath) { return cv::imread(imagePath, 0); });
-
-    std::vector<float> queryData(Ort::LoFTR::IMG_CHANNEL * Ort::LoFTR::IMG_H * Ort::LoFTR::IMG_W);
-    std::vector<float> refData(Ort::LoFTR::IMG_CHANNEL * Ort::LoFTR::IMG_H * Ort::LoFTR::IMG_W);
+    // the color images are kept for drawing, so derive the gray inputs from them instead of decoding every file twice
+    for (int i = 0; i < 2; ++i) {
+        grays.emplace_back(::resizeImage(images[i], Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H, 1));
+    }
 
     Ort::LoFTR osh(
         ONNX_MODEL_PATH, 0,
         std::vector<std::vector<int64_t>>{{1, Ort::LoFTR::IMG_CHANNEL, Ort::LoFTR::IMG_H, Ort::LoFTR::IMG_W},
                                           {1, Ort::LoFTR::IMG_CHANNEL, Ort::LoFTR::IMG_H, Ort::LoFTR::IMG_W}});
+    // query and reference image buffers
+    auto inputBuffers = osh.allocateInputBuffers();
 
-    auto matchedKpts = processOneImagePair(osh, grays[0], grays[1], queryData.data(), refData.data());
+    auto matchedKpts = processOneImagePair(osh, grays[0], images[0].size(), grays[1], images[1].size(),
+                                           inputBuffers[0].data(), inputBuffers[1].data());
     const std::vector<cv::KeyPoint>& queryKpts = matchedKpts.first;
     const std::vector<cv::KeyPoint>& refKpts = matchedKpts.second;
     std::vector<cv::DMatch> matches;
@@ -73,18 +76,15 @@ int main(int argc, char* argv[])
 namespace
 {
 std::pair<std::vector<cv::KeyPoint>, std::vector<cv::KeyPoint>>
-processOneImagePair(const Ort::LoFTR& loftrOsh, const cv::Mat& queryImg, const cv::Mat& refImg, float* queryData,
-                    float* refData, float confidenceThresh)
+processOneImagePair(const Ort::LoFTR& loftrOsh, const cv::Mat& queryImg, const cv::Size& origQuerySize,
+                    const cv::Mat& refImg, const cv::Size& origRefSize, float* queryData, float* refData,
+                    float confidenceThresh)
 {
-    int origQueryW = queryImg.cols, origQueryH = queryImg.rows;
-    int origRefW = refImg.cols, origRefH = refImg.rows;
-
-    cv::Mat scaledQueryImg, scaledRefImg;
-    cv::resize(queryImg, scaledQueryImg, cv::Size(Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H), 0, 0, cv::INTER_CUBIC);
-    cv::resize(refImg, scaledRefImg, cv::Size(Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H), 0, 0, cv::INTER_CUBIC);
+    const int origQueryW = origQuerySize.width, origQueryH = origQuerySize.height;
+    const int origRefW = origRefSize.width, origRefH = origRefSize.height;
 
-    loftrOsh.preprocess(queryData, scaledQueryImg.data, Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H, Ort::LoFTR::IMG_CHANNEL);
-    loftrOsh.preprocess(refData, scaledRefImg.data, Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H, Ort::LoFTR::IMG_CHANNEL);
+    loftrOsh.preprocess(queryData, queryImg.data, Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H, Ort::LoFTR::IMG_CHANNEL);
+    loftrOsh.preprocess(refData, refImg.data, Ort::LoFTR::IMG_W, Ort::LoFTR::IMG_H, Ort::LoFTR::IMG_CHANNEL);
     auto inferenceOutput = loftrOsh({queryData, refData});
 
     // inferenceOutput[0].second: keypoints0 of shape [num kpt x 2]
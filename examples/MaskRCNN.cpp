@@ -5,7 +5,10 @@
  *
  */
 
-#include <cstring>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
 
 #include "MaskRCNN.hpp"
 
@@ -29,14 +32,9 @@ void MaskRCNN::preprocess(float* dst,                     //
                           const int64_t targetImgHeight,  //
                           const int numChannels) const
 {
-    for (int c = 0; c < numChannels; ++c) {
-        for (int i = 0; i < targetImgHeight; ++i) {
-            for (int j = 0; j < targetImgWidth; ++j) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                    src[i * targetImgWidth * numChannels + j * numChannels + c];
-            }
-        }
-    }
+    assert(numChannels == IMG_CHANNEL);
+    this->preprocessInput<IMG_CHANNEL, Layout::HWC, ChannelOrder::BGR, InputNormalization>(
+        dst, src, targetImgWidth, targetImgHeight);
 }
 
 void MaskRCNN::preprocess(float* dst,                     //
@@ -45,13 +43,119 @@ void MaskRCNN::preprocess(float* dst,                     //
                           const int64_t targetImgHeight,  //
                           const int numChannels) const
 {
-    for (int i = 0; i < targetImgHeight; ++i) {
-        for (int j = 0; j < targetImgWidth; ++j) {
-            for (int c = 0; c < numChannels; ++c) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] = imgSrc.ptr<float>(i, j)[c];
-            }
+    assert(imgSrc.isContinuous());
+    this->preprocess(dst, imgSrc.ptr<float>(), targetImgWidth, targetImgHeight, numChannels);
+}
+
+void MaskRCNN::enableMasks(const bool enabled)
+{
+    this->selectOutputs(enabled ? std::vector<std::size_t>{}
+                                : std::vector<std::size_t>{BOXES_OUTPUT, LABELS_OUTPUT, SCORES_OUTPUT});
+}
+
+void MaskRCNN::selectDetections(const std::vector<DataOutputType>& inferenceOutput,  //
+                                const float ratio,                                   //
+                                const int64_t imageWidth,                            //
+                                const int64_t imageHeight,                           //
+                                const float confThresh,                              //
+                                MaskRCNNResult* result,                              //
+                                const std::size_t topN,                              //
+                                const float maskThresh) const
+{
+    // boxes: numBoxes x 4, labels: numBoxes, scores: numBoxes, masks: numBoxes x 1 x maskHeight x maskWidth
+    const std::size_t numBoxes = inferenceOutput[LABELS_OUTPUT].second[0];
+    const float* boxes = inferenceOutput[BOXES_OUTPUT].first;
+    const int64_t* labels = reinterpret_cast<const int64_t*>(inferenceOutput[LABELS_OUTPUT].first);
+    const float* scores = inferenceOutput[SCORES_OUTPUT].first;
+
+    // the topN best cut at the threshold, or all the boxes above it in output order, selected in place in the
+    // result so that concurrent calls on different results do not share any buffer
+    std::vector<uint64_t>& selected = result->m_maskIndices;
+    selected.resize(numBoxes);
+    std::size_t numSelected = 0;
+    if (topN) {
+        numSelected = Ort::topK(scores, numBoxes, topN, selected.data());
+        while (numSelected > 0 && !(scores[selected[numSelected - 1]] > confThresh)) {
+            --numSelected;
+        }
+    } else {
+        numSelected = Ort::findAboveThreshold(scores, numBoxes, 1, confThresh, selected.data());
+    }
+    selected.resize(numSelected);
+
+    result->m_detections.clear();
+    result->m_detections.beginImage();
+    for (const uint64_t i : selected) {
+        const float* box = boxes + 4 * i;
+        result->m_detections.push(box[0], box[1], box[2], box[3], scores[i], labels[i]);
+    }
+    result->m_detections.rescale(0, 1 / ratio, 1 / ratio, imageWidth, imageHeight);
+
+    // only a view of the masks, decoded on access
+    const auto& maskOutput = inferenceOutput[MASKS_OUTPUT];
+    result->m_masks = maskOutput.first;
+    if (maskOutput.first) {
+        const auto& maskShape = maskOutput.second;
+        if (maskShape.size() != 4 || maskShape[0] != static_cast<int64_t>(numBoxes)) {
+            throw std::runtime_error("unexpected mask shape");
         }
+        result->m_maskWidth = maskShape[3];
+        result->m_maskHeight = maskShape[2];
     }
+    result->m_maskThresh = maskThresh;
+    result->m_imageWidth = imageWidth;
+    result->m_imageHeight = imageHeight;
+    result->m_decodedMasks.resize(numSelected);
+    result->m_isDecoded.assign(numSelected, 0);
 }
 
+const float* MaskRCNNResult::maskProbabilities(const std::size_t i) const
+{
+    if (!this->hasMasks()) {
+        throw std::runtime_error("the mask output was not fetched");
+    }
+    return m_masks + m_maskIndices.at(i) * m_maskHeight * m_maskWidth;
+}
+
+const MaskRCNNResult::InstanceMask& MaskRCNNResult::mask(const std::size_t i) const
+{
+    const float* probabilities = this->maskProbabilities(i);
+    InstanceMask& mask = m_decodedMasks[i];
+    if (m_isDecoded[i]) {
+        return mask;
+    }
+
+    // masks are pasted into boxes rounded to whole pixels: the rounded box moved to the mask origin pastes the same
+    // pixels as into the whole image
+    const int64_t xBegin = std::lround(m_detections.xmins()[i]);
+    const int64_t yBegin = std::lround(m_detections.ymins()[i]);
+    const int64_t xEnd = std::lround(m_detections.xmaxs()[i]);
+    const int64_t yEnd = std::lround(m_detections.ymaxs()[i]);
+    mask.x = std::min(std::max<int64_t>(xBegin, 0), m_imageWidth);
+    mask.y = std::min(std::max<int64_t>(yBegin, 0), m_imageHeight);
+    mask.width = std::max<int64_t>(std::min(xEnd, m_imageWidth) - mask.x, 0);
+    mask.height = std::max<int64_t>(std::min(yEnd, m_imageHeight) - mask.y, 0);
+    mask.pixels.resize(mask.width * mask.height);
+
+    const float xmin = xBegin - mask.x;
+    const float ymin = yBegin - mask.y;
+    const float xmax = xEnd - mask.x;
+    const float ymax = yEnd - mask.y;
+    Ort::pasteMasks(probabilities, m_maskWidth, m_maskHeight, nullptr, &xmin, &ymin, &xmax, &ymax, 1, m_maskThresh,
+                    mask.pixels.data(), mask.width, mask.height);
+    m_isDecoded[i] = 1;
+    return mask;
+}
+
+void MaskRCNNResult::pasteMasks(uint16_t* instanceIds, const std::size_t numThreads) const
+{
+    if (!this->hasMasks()) {
+        throw std::runtime_error("the mask output was not fetched");
+    }
+    Ort::pasteMasks(m_masks, m_maskWidth, m_maskHeight, m_maskIndices.data(),  //
+                    m_detections.xmins(), m_detections.ymins(),                //
+                    m_detections.xmaxs(), m_detections.ymaxs(),                //
+                    m_detections.size(), m_maskThresh,                         //
+                    instanceIds, m_imageWidth, m_imageHeight, numThreads);
+}
 }  // namespace Ort
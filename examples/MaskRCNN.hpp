@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <vector>
@@ -17,6 +19,80 @@
 
 namespace Ort
 {
+/**
+ *  @brief detections of one MaskRCNN inference, selected by score before any mask is read
+ *
+ *  the masks are not copied: they are read from the mask output of the session, so a result is valid until the next
+ *  inference. Each mask is decoded, upsampled to its box and thresholded, when it is first accessed.
+ */
+class MaskRCNNResult
+{
+ public:
+    // binary mask of one instance over its box clipped to the image
+    struct InstanceMask {
+        // top left pixel of the mask in the image
+        int64_t x = 0;
+        int64_t y = 0;
+        std::size_t width = 0;
+        std::size_t height = 0;
+
+        // height x width, 1 inside the instance, 0 outside
+        std::vector<uint16_t> pixels;
+    };
+
+    // the selected detections in image pixels, best first when selected by topN
+    const DetectionBatch& detections() const
+    {
+        return m_detections;
+    }
+
+    std::size_t size() const
+    {
+        return m_detections.size();
+    }
+
+    // false when the mask output was not fetched, see OrtSessionHandler::selectOutputs
+    bool hasMasks() const
+    {
+        return m_masks != nullptr;
+    }
+
+    /**
+     *  @brief maskHeight x maskWidth probabilities of detection i, in the output tensor of the session
+     */
+    const float* maskProbabilities(std::size_t i) const;
+
+    /**
+     *  @brief mask of detection i, decoded on the first access; overlaps with other instances are not resolved
+     */
+    const InstanceMask& mask(std::size_t i) const;
+
+    /**
+     *  @brief the masks of all the detections pasted into one image of instance ids, see Ort::pasteMasks
+     *
+     *  @param instanceIds imageHeight x imageWidth: detection i owns the pixels of value i + 1, the background is 0
+     */
+    void pasteMasks(uint16_t* instanceIds, std::size_t numThreads = 1) const;
+
+ private:
+    friend class MaskRCNN;
+
+    DetectionBatch m_detections;
+
+    // box of each selected detection in the outputs, and so its mask in the mask output
+    std::vector<uint64_t> m_maskIndices;
+    const float* m_masks = nullptr;
+    std::size_t m_maskWidth = 0;
+    std::size_t m_maskHeight = 0;
+    float m_maskThresh = 0.5;
+    int64_t m_imageWidth = 0;
+    int64_t m_imageHeight = 0;
+
+    // decoded masks keep their capacity from one inference to the next
+    mutable std::vector<InstanceMask> m_decodedMasks;
+    mutable std::vector<uint8_t> m_isDecoded;
+};
+
 class MaskRCNN : public ImageRecognitionOrtSessionHandlerBase
 {
  public:
@@ -24,6 +100,8 @@ class MaskRCNN : public ImageRecognitionOrtSessionHandlerBase
 
     static constexpr int64_t IMG_CHANNEL = 3;
 
+    using InputNormalization = IdentityNormalization;
+
     MaskRCNN(const uint16_t numClasses,                           //
              const std::string& modelPath,                        //
              const std::optional<size_t>& gpuIdx = std::nullopt,  //
@@ -42,5 +120,33 @@ class MaskRCNN : public ImageRecognitionOrtSessionHandlerBase
                     const int64_t targetImgWidth,   //
                     const int64_t targetImgHeight,  //
                     const int numChannels) const;
+
+    // order of the model outputs
+    static constexpr std::size_t BOXES_OUTPUT = 0;
+    static constexpr std::size_t LABELS_OUTPUT = 1;
+    static constexpr std::size_t SCORES_OUTPUT = 2;
+    static constexpr std::size_t MASKS_OUTPUT = 3;
+
+    /**
+     *  @brief skip the mask head in the next inferences when only boxes are needed
+     */
+    void enableMasks(bool enabled);
+
+    /**
+     *  @brief select the detections scoring above confThresh, only the topN best of them when topN is not 0, without
+     *  reading any mask
+     *
+     *  @param inferenceOutput boxes in network input pixels, labels, scores and masks of one image
+     *  @param ratio scale of the network input over the original image
+     *  @param result cleared, then holds the selected detections in original image pixels
+     */
+    void selectDetections(const std::vector<DataOutputType>& inferenceOutput,  //
+                          float ratio,                                         //
+                          int64_t imageWidth,                                  //
+                          int64_t imageHeight,                                 //
+                          float confThresh,                                    //
+                          MaskRCNNResult* result,                              //
+                          std::size_t topN = 0,                                //
+                          float maskThresh = 0.5) const;
 };
 }  // namespace Ort
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <iostream>
 #include <memory>
+#include <string>
 
 #include <opencv2/opencv.hpp>
 
@@ -17,14 +18,15 @@
 #include "Utility.hpp"
 
 static constexpr float CONFIDENCE_THRESHOLD = 0.5;
-static const std::vector<cv::Scalar> COLORS = toCvScalarColors(Ort::MSCOCO_COLOR_CHART);
+
+// masks are only decoded for the best instances
+static constexpr std::size_t MAX_INSTANCES = 20;
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::MaskRCNN& osh, const cv::Mat& inputImg, int newW, int newH, int paddedW, int paddedH,
-                        float ratio, float* dst, const float confThresh = 0.5,
-                        const cv::Scalar& meanVal = cv::Scalar(102.9801, 115.9465, 122.7717),
-                        bool visualizeMask = true);
+void processOneFrame(const Ort::MaskRCNN& osh, const cv::Mat& scaledImg, int imageWidth, int imageHeight, int paddedW,
+                     int paddedH, float ratio, float* dst, Ort::MaskRCNNResult* result, const float confThresh = 0.5,
+                     const cv::Scalar& meanVal = cv::Scalar(102.9801, 115.9465, 122.7717));
 }  // namespace
 
 int main(int argc, char* argv[])
@@ -54,28 +56,51 @@ int main(int argc, char* argv[])
                       std::vector<std::vector<int64_t>>{{Ort::MaskRCNN::IMG_CHANNEL, paddedH, paddedW}});
 
     osh.initClassNames(Ort::MSCOCO_CLASSES);
-
-    std::vector<float> dst(Ort::MaskRCNN::IMG_CHANNEL * paddedH * paddedW);
-
-    auto resultImg = ::processOneFrame(osh, img, newW, newH, paddedW, paddedH, ratio, dst.data(), CONFIDENCE_THRESHOLD);
-    cv::imwrite("result.jpg", resultImg);
+    const Ort::Renderer renderer(osh.classNames(), Ort::MSCOCO_COLOR_CHART);
+
+    auto inputBuffers = osh.allocateInputBuffers();
+
+    // the full image is kept for drawing: the network input is resized from it rather than decoding the file again
+    const cv::Mat scaledImg = ::resizeImage(img, newW, newH);
+
+    Ort::MaskRCNNResult result;
+    ::processOneFrame(osh, scaledImg, img.cols, img.rows, paddedW, paddedH, ratio, inputBuffers[0].data(), &result,
+                      CONFIDENCE_THRESHOLD);
+    const Ort::DetectionBatch& detections = result.detections();
+
+    cv::Mat instanceIds(img.rows, img.cols, CV_16UC1);
+    result.pasteMasks(instanceIds.ptr<uint16_t>());
+    // the masks are encoded below from instanceIds, not from the drawn image
+    renderer.drawMasks(instanceIds.ptr<uint16_t>(), detections, 0, img.data, img.cols, img.rows, img.step);
+    renderer.drawDetections(detections, 0, img.data, img.cols, img.rows, img.step);
+    cv::imwrite("result.jpg", img);
+
+    // compact masks for downstream consumers, as in COCO json results
+    Ort::RleCodec rleCodec;
+    const auto& rleMasks =
+        rleCodec.encode(instanceIds.ptr<uint16_t>(), instanceIds.cols, instanceIds.rows, detections.size(), 1);
+    std::string rleString;
+    for (std::size_t i = 0; i < rleMasks.size(); ++i) {
+        rleMasks[i].toString(&rleString);
+        std::cout << "[INFO] - " << osh.classNames()[detections.classIdx(i)] << " " << detections.score(i)
+                  << ", area: " << rleMasks[i].area() << ", rle: " << rleString << std::endl;
+    }
 
     return EXIT_SUCCESS;
 }
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::MaskRCNN& osh, const cv::Mat& inputImg, int newW, int newH, int paddedW, int paddedH,
-                        float ratio, float* dst, float confThresh, const cv::Scalar& meanVal, bool visualizeMask)
+void processOneFrame(const Ort::MaskRCNN& osh, const cv::Mat& scaledImg, int imageWidth, int imageHeight, int paddedW,
+                     int paddedH, float ratio, float* dst, Ort::MaskRCNNResult* result, float confThresh,
+                     const cv::Scalar& meanVal)
 {
     cv::Mat tmpImg;
-    cv::resize(inputImg, tmpImg, cv::Size(newW, newH));
-
-    tmpImg.convertTo(tmpImg, CV_32FC3);
+    scaledImg.convertTo(tmpImg, CV_32FC3);
     tmpImg -= meanVal;
 
     cv::Mat paddedImg(paddedH, paddedW, CV_32FC3, cv::Scalar(0, 0, 0));
-    tmpImg.copyTo(paddedImg(cv::Rect(0, 0, newW, newH)));
+    tmpImg.copyTo(paddedImg(cv::Rect(0, 0, scaledImg.cols, scaledImg.rows)));
 
     osh.preprocess(dst, paddedImg.ptr<float>(), paddedW, paddedH, 3);
     // or
@@ -83,46 +108,7 @@ cv::Mat processOneFrame(const Ort::MaskRCNN& osh, const cv::Mat& inputImg, int n
 
     // boxes, labels, scores, masks
     auto inferenceOutput = osh({dst});
-
     assert(inferenceOutput[1].second.size() == 1);
-    size_t nBoxes = inferenceOutput[1].second[0];
-
-    std::vector<std::array<float, 4>> bboxes;
-    std::vector<uint64_t> classIndices;
-    std::vector<cv::Mat> masks;
-
-    bboxes.reserve(nBoxes);
-    classIndices.reserve(nBoxes);
-    masks.reserve(nBoxes);
-
-    for (size_t i = 0; i < nBoxes; ++i) {
-        if (inferenceOutput[2].first[i] > confThresh) {
-            DEBUG_LOG("%f", inferenceOutput[2].first[i]);
-
-            float xmin = inferenceOutput[0].first[i * 4 + 0] / ratio;
-            float ymin = inferenceOutput[0].first[i * 4 + 1] / ratio;
-            float xmax = inferenceOutput[0].first[i * 4 + 2] / ratio;
-            float ymax = inferenceOutput[0].first[i * 4 + 3] / ratio;
-
-            xmin = std::max<float>(xmin, 0);
-            ymin = std::max<float>(ymin, 0);
-            xmax = std::min<float>(xmax, inputImg.cols - 1);
-            ymax = std::min<float>(ymax, inputImg.rows - 1);
-
-            bboxes.emplace_back(std::array<float, 4>{xmin, ymin, xmax, ymax});
-            classIndices.emplace_back(reinterpret_cast<int64_t*>(inferenceOutput[1].first)[i]);
-
-            cv::Mat curMask(28, 28, CV_32FC1);
-            memcpy(curMask.data, inferenceOutput[3].first + i * 28 * 28, 28 * 28 * sizeof(float));
-            masks.emplace_back(curMask);
-        }
-    }
-
-    if (bboxes.size() == 0) {
-        return inputImg;
-    }
-
-    return visualizeMask ? ::visualizeOneImageWithMask(inputImg, bboxes, classIndices, masks, COLORS, osh.classNames())
-                         : ::visualizeOneImage(inputImg, bboxes, classIndices, COLORS, osh.classNames());
+    osh.selectDetections(inferenceOutput, ratio, imageWidth, imageHeight, confThresh, result, MAX_INSTANCES);
 }
 }  // namespace
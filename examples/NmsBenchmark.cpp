@@ -0,0 +1,274 @@
+/**
+ * @file    NmsBenchmark.cpp
+ *
+ * @author  btran
+ *
+ */
+
+/**
+ *   @brief compare Ort::NmsEngine with the former deque based Ort::nms on synthetic detector outputs, and time the
+ *   multi class, soft and matrix nms variants
+ *   DO BUILD with RELEASE mode to get meaningful timings
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <ort_utility/ort_utility.hpp>
+
+namespace
+{
+static constexpr float OVERLAP_THRESHOLD = 0.45;
+static constexpr int IMG_W = 1920;
+static constexpr int IMG_H = 1080;
+static constexpr uint64_t NUM_CLASSES = 80;
+
+// the implementation Ort::nms had before NmsEngine, kept as reference
+std::vector<uint64_t> dequeNms(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                               const float overlapThresh)
+{
+    uint64_t boxesLength = bboxes.size();
+
+    std::vector<uint64_t> keepIndices;
+    keepIndices.reserve(boxesLength);
+
+    std::deque<uint64_t> sortedIndices(boxesLength);
+    std::iota(sortedIndices.begin(), sortedIndices.end(), 0);
+    std::stable_sort(std::begin(sortedIndices), std::end(sortedIndices),
+                     [&scores](size_t i1, size_t i2) { return scores[i1] < scores[i2]; });
+
+    std::vector<float> areas;
+    areas.reserve(boxesLength);
+    std::transform(std::begin(bboxes), std::end(bboxes), std::back_inserter(areas),
+                   [](const auto& elem) { return (elem[2] - elem[0]) * (elem[3] - elem[1]); });
+
+    while (!sortedIndices.empty()) {
+        uint64_t currentIdx = sortedIndices.back();
+        keepIndices.emplace_back(currentIdx);
+
+        if (sortedIndices.size() == 1) {
+            break;
+        }
+
+        sortedIndices.pop_back();
+
+        const auto& curBbox = bboxes[currentIdx];
+        const float curArea = areas[currentIdx];
+
+        std::deque<uint64_t> newSortedIndices;
+
+        for (const uint64_t elem : sortedIndices) {
+            const auto& bbox = bboxes[elem];
+            float tmpW = std::max<float>(std::min(curBbox[2], bbox[2]) - std::max(curBbox[0], bbox[0]), 0.0);
+            float tmpH = std::max<float>(std::min(curBbox[3], bbox[3]) - std::max(curBbox[1], bbox[1]), 0.0);
+
+            const float intersection = tmpW * tmpH;
+            const float iou = intersection / (areas[elem] + curArea - intersection);
+
+            if (iou <= overlapThresh) {
+                newSortedIndices.emplace_back(elem);
+            }
+        }
+
+        sortedIndices = newSortedIndices;
+    }
+
+    return keepIndices;
+}
+
+/**
+ *  @brief candidates clustered around a few objects, as a detector outputs them before nms
+ */
+void generateCandidates(std::size_t numCandidates, std::mt19937* gen, std::vector<std::array<float, 4>>* bboxes,
+                        std::vector<float>* scores)
+{
+    const std::size_t numObjects = std::max<std::size_t>(numCandidates / 50, 1);
+    std::uniform_real_distribution<float> centerX(0, IMG_W);
+    std::uniform_real_distribution<float> centerY(0, IMG_H);
+    std::uniform_real_distribution<float> objectSize(16, 256);
+    std::normal_distribution<float> jitter(0, 0.1);
+    std::uniform_real_distribution<float> score(0.01, 1);
+
+    std::vector<std::array<float, 4>> objects(numObjects);
+    for (auto& object : objects) {
+        object = {centerX(*gen), centerY(*gen), objectSize(*gen), objectSize(*gen)};
+    }
+
+    bboxes->resize(numCandidates);
+    scores->resize(numCandidates);
+    for (std::size_t i = 0; i < numCandidates; ++i) {
+        const auto& object = objects[i % numObjects];
+        const float xcenter = object[0] + jitter(*gen) * object[2];
+        const float ycenter = object[1] + jitter(*gen) * object[3];
+        const float width = object[2] * (1 + jitter(*gen));
+        const float height = object[3] * (1 + jitter(*gen));
+        (*bboxes)[i] = {xcenter - width / 2, ycenter - height / 2, xcenter + width / 2, ycenter + height / 2};
+        (*scores)[i] = score(*gen);
+    }
+}
+
+// what callers had to write before MultiClassNmsEngine: one class agnostic nms per class
+std::vector<uint64_t> perClassNms(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                                  const std::vector<uint64_t>& classIndices, const float overlapThresh)
+{
+    std::vector<uint64_t> keepIndices;
+    for (uint64_t classIdx = 0; classIdx < NUM_CLASSES; ++classIdx) {
+        std::vector<std::array<float, 4>> classBboxes;
+        std::vector<float> classScores;
+        std::vector<uint64_t> classBoxIndices;
+        for (std::size_t i = 0; i < bboxes.size(); ++i) {
+            if (classIndices[i] == classIdx) {
+                classBboxes.emplace_back(bboxes[i]);
+                classScores.emplace_back(scores[i]);
+                classBoxIndices.emplace_back(i);
+            }
+        }
+        for (const uint64_t idx : ::dequeNms(classBboxes, classScores, overlapThresh)) {
+            keepIndices.emplace_back(classBoxIndices[idx]);
+        }
+    }
+
+    std::stable_sort(keepIndices.begin(), keepIndices.end(), [&scores](uint64_t lhs, uint64_t rhs) {
+        return scores[lhs] > scores[rhs] || (scores[lhs] == scores[rhs] && lhs > rhs);
+    });
+
+    return keepIndices;
+}
+
+template <typename Func> double measureMilliseconds(Func&& func, int numIterations)
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numIterations; ++i) {
+        func();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count() / numIterations;
+}
+}  // namespace
+
+int main()
+{
+    std::mt19937 gen(2021);
+    std::vector<std::array<float, 4>> bboxes;
+    std::vector<float> scores;
+    std::vector<uint64_t> classIndices;
+    Ort::NmsEngine engine;
+    Ort::MultiClassNmsEngine multiClassEngine;
+
+    std::cout << std::setw(12) << "candidates" << std::setw(8) << "kept" << std::setw(14) << "deque [ms]"
+              << std::setw(14) << "engine [ms]" << std::setw(10) << "speedup" << std::endl;
+
+    for (std::size_t numCandidates : {100, 500, 1000, 5000, 10000, 20000, 50000}) {
+        ::generateCandidates(numCandidates, &gen, &bboxes, &scores);
+        const int numIterations = std::max<int>(200000 / numCandidates, 3);
+
+        const auto expected = ::dequeNms(bboxes, scores, OVERLAP_THRESHOLD);
+        const auto kept = engine.run(bboxes, scores, OVERLAP_THRESHOLD);
+        if (kept != expected) {
+            std::cerr << "results differ for " << numCandidates << " candidates" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const double dequeMs =
+            ::measureMilliseconds([&] { ::dequeNms(bboxes, scores, OVERLAP_THRESHOLD); }, numIterations);
+        const double engineMs =
+            ::measureMilliseconds([&] { engine.run(bboxes, scores, OVERLAP_THRESHOLD); }, numIterations);
+
+        std::cout << std::setw(12) << numCandidates << std::setw(8) << kept.size() << std::setw(14) << std::fixed
+                  << std::setprecision(3) << dequeMs << std::setw(14) << engineMs << std::setw(9)
+                  << std::setprecision(1) << dequeMs / engineMs << "x" << std::endl;
+    }
+
+    std::cout << "\n" << NUM_CLASSES << " classes" << std::endl;
+    std::cout << std::setw(12) << "candidates" << std::setw(8) << "kept" << std::setw(16) << "per class [ms]"
+              << std::setw(14) << "engine [ms]" << std::setw(10) << "speedup" << std::endl;
+
+    std::uniform_int_distribution<uint64_t> classDist(0, NUM_CLASSES - 1);
+    for (std::size_t numCandidates : {1000, 5000, 10000, 20000, 50000}) {
+        ::generateCandidates(numCandidates, &gen, &bboxes, &scores);
+        classIndices.resize(numCandidates);
+        for (auto& classIdx : classIndices) {
+            classIdx = classDist(gen);
+        }
+        const int numIterations = std::max<int>(200000 / numCandidates, 3);
+
+        const auto expected = ::perClassNms(bboxes, scores, classIndices, OVERLAP_THRESHOLD);
+        const auto& kept = multiClassEngine.run(bboxes, scores, classIndices, OVERLAP_THRESHOLD);
+        if (kept.indices != expected) {
+            std::cerr << "multi class results differ for " << numCandidates << " candidates" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const double perClassMs = ::measureMilliseconds(
+            [&] { ::perClassNms(bboxes, scores, classIndices, OVERLAP_THRESHOLD); }, numIterations);
+        const double engineMs = ::measureMilliseconds(
+            [&] { multiClassEngine.run(bboxes, scores, classIndices, OVERLAP_THRESHOLD); }, numIterations);
+
+        std::cout << std::setw(12) << numCandidates << std::setw(8) << kept.indices.size() << std::setw(16)
+                  << std::fixed << std::setprecision(3) << perClassMs << std::setw(14) << engineMs << std::setw(9)
+                  << std::setprecision(1) << perClassMs / engineMs << "x" << std::endl;
+    }
+
+    std::cout << "\nnms variants [ms]" << std::endl;
+    std::cout << std::setw(12) << "candidates" << std::setw(10) << "greedy" << std::setw(14) << "soft linear"
+              << std::setw(14) << "soft gauss" << std::setw(14) << "matrix lin" << std::setw(14) << "matrix gauss"
+              << std::endl;
+
+    Ort::SoftNmsEngine softEngine;
+    Ort::MatrixNmsEngine matrixEngine;
+    Ort::NmsParams linearParams;
+    linearParams.decay = Ort::DecayFunction::LINEAR;
+    Ort::NmsParams gaussianParams;
+    gaussianParams.decay = Ort::DecayFunction::GAUSSIAN;
+
+    for (std::size_t numCandidates : {500, 1000, 2000, 5000}) {
+        ::generateCandidates(numCandidates, &gen, &bboxes, &scores);
+        const int numIterations = std::max<int>(20000 / numCandidates, 3);
+
+        std::cout << std::setw(12) << numCandidates << std::fixed << std::setprecision(3) << std::setw(10)
+                  << ::measureMilliseconds([&] { engine.run(bboxes, scores, OVERLAP_THRESHOLD); }, numIterations)
+                  << std::setw(14)
+                  << ::measureMilliseconds([&] { softEngine.run(bboxes, scores, linearParams); }, numIterations)
+                  << std::setw(14)
+                  << ::measureMilliseconds([&] { softEngine.run(bboxes, scores, gaussianParams); }, numIterations)
+                  << std::setw(14)
+                  << ::measureMilliseconds([&] { matrixEngine.run(bboxes, scores, linearParams); }, numIterations)
+                  << std::setw(14)
+                  << ::measureMilliseconds([&] { matrixEngine.run(bboxes, scores, gaussianParams); }, numIterations)
+                  << std::endl;
+    }
+
+    std::cout << "\nthread scaling [ms], " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(24) << "matrix, 5000 boxes" << std::setw(32)
+              << "multi class, 50000 boxes" << std::endl;
+
+    std::vector<std::array<float, 4>> matrixBboxes;
+    std::vector<float> matrixScores;
+    ::generateCandidates(5000, &gen, &matrixBboxes, &matrixScores);
+    ::generateCandidates(50000, &gen, &bboxes, &scores);
+    classIndices.resize(bboxes.size());
+    for (auto& classIdx : classIndices) {
+        classIdx = classDist(gen);
+    }
+
+    for (std::size_t numThreads : {1, 2, 4, 8, 16}) {
+        Ort::MatrixNmsEngine threadedMatrixEngine(numThreads);
+        Ort::MultiClassNmsEngine threadedMultiClassEngine(numThreads);
+
+        std::cout << std::setw(10) << numThreads << std::fixed << std::setprecision(3) << std::setw(24)
+                  << ::measureMilliseconds(
+                         [&] { threadedMatrixEngine.run(matrixBboxes, matrixScores, gaussianParams); }, 5)
+                  << std::setw(32)
+                  << ::measureMilliseconds(
+                         [&] { threadedMultiClassEngine.run(bboxes, scores, classIndices, OVERLAP_THRESHOLD); }, 5)
+                  << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -14,11 +14,6 @@
 
 #include <ort_utility/ort_utility.hpp>
 
-namespace
-{
-static constexpr int64_t DUMMY_NUM_CLASSES = 2021;
-}  // namespace
-
 int main(int argc, char* argv[])
 {
     if (argc != 2) {
@@ -27,7 +22,7 @@ int main(int argc, char* argv[])
     }
 
     const std::string ONNX_MODEL_PATH = argv[1];
-    Ort::ObjectDetectionOrtSessionHandler osh(DUMMY_NUM_CLASSES, ONNX_MODEL_PATH, 0);
+    Ort::OrtSessionHandler osh(ONNX_MODEL_PATH, 0);
 
     return EXIT_SUCCESS;
 }
@@ -5,6 +5,8 @@
  *
  */
 
+#include <cassert>
+
 #include "SemanticSegmentationPaddleSegBisenetv2.hpp"
 
 namespace Ort
@@ -13,25 +15,33 @@ SemanticSegmentationPaddleSegBisenetv2::SemanticSegmentationPaddleSegBisenetv2(
     const uint16_t numClasses,     //
     const std::string& modelPath,  //
     const std::optional<size_t>& gpuIdx, const std::optional<std::vector<std::vector<int64_t>>>& inputShapes)
-    : ImageRecognitionOrtSessionHandlerBase(numClasses, modelPath, gpuIdx, inputShapes)
+    : SemanticSegmentationOrtSessionHandler(numClasses, modelPath, gpuIdx, inputShapes)
 {
 }
 
-void SemanticSegmentationPaddleSegBisenetv2::preprocess(float* dst,                         //
-                                                        const unsigned char* src,           //
-                                                        int64_t targetImgWidth,             //
-                                                        int64_t targetImgHeight,            //
-                                                        int numChannels,                    //
-                                                        const std::vector<float>& meanVal,  //
-                                                        const std::vector<float>& stdVal) const
+void SemanticSegmentationPaddleSegBisenetv2::preprocess(float* dst,                 //
+                                                        const unsigned char* src,   //
+                                                        int64_t targetImgWidth,     //
+                                                        int64_t targetImgHeight,    //
+                                                        int numChannels,            //
+                                                        const std::vector<float>&,  //
+                                                        const std::vector<float>&) const
 {
-    for (int i = 0; i < targetImgHeight; ++i) {
-        for (int j = 0; j < targetImgWidth; ++j) {
-            for (int c = 0; c < numChannels; ++c) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                    (src[i * targetImgWidth * numChannels + j * numChannels + c] / 255.0 - meanVal[c]) / stdVal[c];
-            }
-        }
+    assert(numChannels == IMG_CHANNEL);
+    this->preprocessInput<IMG_CHANNEL, Layout::HWC, ChannelOrder::RGB, InputNormalization>(
+        dst, src, targetImgWidth, targetImgHeight);
+}
+
+void SemanticSegmentationPaddleSegBisenetv2::postprocess(const std::vector<DataOutputType>& inferenceOutput,  //
+                                                         uint8_t* labels,                                     //
+                                                         cv::Mat* frame,                                      //
+                                                         const float alpha) const
+{
+    this->narrowLabels(inferenceOutput[0], 0, labels);
+
+    if (frame != nullptr) {
+        assert(frame->type() == CV_8UC3);
+        this->overlayLabels(labels, IMG_W, IMG_H, alpha, frame->data, frame->cols, frame->rows, frame->step);
     }
 }
 }  // namespace Ort
@@ -15,25 +15,44 @@
 
 namespace Ort
 {
-class SemanticSegmentationPaddleSegBisenetv2 : public ImageRecognitionOrtSessionHandlerBase
+class SemanticSegmentationPaddleSegBisenetv2 : public SemanticSegmentationOrtSessionHandler
 {
  public:
     static constexpr int64_t IMG_H = 1024;
     static constexpr int64_t IMG_W = 1024;
     static constexpr int64_t IMG_CHANNEL = 3;
 
+    // (x / 255 - 0.5) / 0.5 with the mean and std of the PaddleSeg config
+    using InputNormalization = ConstantNormalization<std::ratio<2, 255>, std::ratio<-1>>;
+
     SemanticSegmentationPaddleSegBisenetv2(
         const uint16_t numClasses,                           //
         const std::string& modelPath,                        //
         const std::optional<size_t>& gpuIdx = std::nullopt,  //
         const std::optional<std::vector<std::vector<int64_t>>>& inputShapes = std::nullopt);
 
-    void preprocess(float* dst,                                           //
-                    const unsigned char* src,                             //
-                    int64_t targetImgWidth,                               //
-                    int64_t targetImgHeight,                              //
-                    int numChannels,                                      //
-                    const std::vector<float>& meanVal = {0.5, 0.5, 0.5},  //
-                    const std::vector<float>& stdVal = {0.5, 0.5, 0.5}) const;
+    /**
+     *  @brief normalize a BGR image; the swap to the RGB order the model expects is done on the fly
+     *
+     *  the normalization of the model is fixed: meanVal and stdVal are ignored
+     */
+    void preprocess(float* dst,                              //
+                    const unsigned char* src,                //
+                    int64_t targetImgWidth,                  //
+                    int64_t targetImgHeight,                 //
+                    int numChannels,                         //
+                    const std::vector<float>& meanVal = {},  //
+                    const std::vector<float>& stdVal = {}) const override;
+
+    /**
+     *  @brief IMG_H x IMG_W uint8 labels of the first image, narrowed from the int64 argmax the model exports
+     *
+     *  @param frame when given, BGR frame of any size the colorized labels are blended into in place, see
+     *  overlayLabels()
+     */
+    void postprocess(const std::vector<DataOutputType>& inferenceOutput,  //
+                     uint8_t* labels,                                     //
+                     cv::Mat* frame = nullptr,                            //
+                     float alpha = 0.4) const;
 };
 };  // namespace Ort
@@ -5,6 +5,9 @@
  *
  */
 
+#include <memory>
+#include <string>
+
 #include <ort_utility/ort_utility.hpp>
 
 #include "SemanticSegmentationPaddleSegBisenetv2.hpp"
@@ -12,15 +15,28 @@
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::SemanticSegmentationPaddleSegBisenetv2& osh, const cv::Mat& inputImg, float* dst,
-                        float alpha = 0.4);
+// scaledImg: inputImg at the network input size, or empty to resize it here
+cv::Mat processOneFrame(const Ort::SemanticSegmentationPaddleSegBisenetv2& osh, const cv::Mat& inputImg,
+                        const cv::Mat& scaledImg, float* dst, std::vector<uint8_t>* labels, float alpha = 0.4);
+cv::Mat processOneFrameTiled(Ort::SemanticSegmentationPaddleSegBisenetv2* osh, const std::string& modelPath,
+                             int numSessions, const cv::Mat& inputImg, float alpha = 0.4);
+
+// pixels shared by neighbour tiles in the tiled mode
+constexpr int64_t TILE_OVERLAP = 128;
+
 static const std::vector<cv::Scalar> COLORS = toCvScalarColors(Ort::CITY_SCAPES_COLOR_CHART);
 }  // namespace
 
 int main(int argc, char* argv[])
 {
-    if (argc != 3) {
-        std::cerr << "Usage: [apps] [path/to/onnx/semantic/segmentation] [path/to/image]" << std::endl;
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: [apps] [path/to/onnx/semantic/segmentation] [path/to/image/or/video] "
+                     "[optional/num/sessions]"
+                  << std::endl;
+        std::cerr << "with a number of sessions, the image is segmented at full resolution in overlapping tiles"
+                  << std::endl;
+        std::cerr << "videos are segmented on keyframes, the labels of the frames in between following their motion"
+                  << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -28,9 +44,10 @@ int main(int argc, char* argv[])
     const std::string IMAGE_PATH = argv[2];
 
     cv::Mat img = cv::imread(IMAGE_PATH);
+    cv::VideoCapture video;
 
-    if (img.empty()) {
-        std::cerr << "Failed to read input image" << std::endl;
+    if (img.empty() && !video.open(IMAGE_PATH)) {
+        std::cerr << "Failed to read input image or video" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -41,11 +58,46 @@ int main(int argc, char* argv[])
                                            Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W}});
 
     osh.initClassNames(Ort::CITY_SCAPES_CLASSES);
-    std::vector<float> dst(Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_CHANNEL *
-                           Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H *
-                           Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W);
+    osh.initColors(Ort::CITY_SCAPES_COLOR_CHART);
+    auto inputBuffers = osh.allocateInputBuffers();
+
+    std::vector<uint8_t> labels(Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H *
+                                Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W);
+    if (img.empty()) {
+        Ort::KeyframeSegmentation keyframes;
+        cv::VideoWriter writer;
+        cv::Mat frame;
+        while (video.read(frame)) {
+            cv::Mat result;
+            if (keyframes.nextFrame(frame.data, frame.cols, frame.rows, frame.channels(), frame.step)) {
+                result = processOneFrame(osh, frame, cv::Mat(), inputBuffers[0].data(), &labels);
+                keyframes.setKeyframeLabels(labels.data(), Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
+                                            Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H);
+            } else {
+                result = frame.clone();
+                osh.overlayLabels(keyframes.labels(), keyframes.labelWidth(), keyframes.labelHeight(), 0.4,
+                                  result.data, result.cols, result.rows, result.step);
+            }
+            if (!writer.isOpened()) {
+                writer.open("result.avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), video.get(cv::CAP_PROP_FPS),
+                            frame.size());
+            }
+            writer.write(result);
+        }
+        std::cout << "segmented " << keyframes.numKeyframes() << " keyframes, propagated "
+                  << keyframes.numPropagated() << " frames" << std::endl;
+        return EXIT_SUCCESS;
+    }
 
-    auto result = processOneFrame(osh, img, dst.data());
+    cv::Mat result;
+    if (argc == 4) {
+        result = processOneFrameTiled(&osh, ONNX_MODEL_PATH, std::stoi(argv[3]), img);
+    } else {
+        // the full image is kept for drawing: the network input is resized from it rather than decoding the file again
+        const cv::Mat scaledImg = ::resizeImage(img, Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
+                                                Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H);
+        result = processOneFrame(osh, img, scaledImg, inputBuffers[0].data(), &labels);
+    }
     cv::Mat legend = drawColorChart(Ort::CITY_SCAPES_CLASSES, COLORS);
     cv::imshow("legend", legend);
     cv::imshow("overlaid result", result);
@@ -56,36 +108,52 @@ int main(int argc, char* argv[])
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::SemanticSegmentationPaddleSegBisenetv2& osh, const cv::Mat& inputImg, float* dst,
-                        float alpha)
+cv::Mat processOneFrame(const Ort::SemanticSegmentationPaddleSegBisenetv2& osh, const cv::Mat& inputImg,
+                        const cv::Mat& scaledImg, float* dst, std::vector<uint8_t>* labels, float alpha)
 {
-    int origW = inputImg.cols, origH = inputImg.rows;
-    std::vector<float> originImageSize{static_cast<float>(origH), static_cast<float>(origW)};
-    cv::Mat scaledImg = inputImg.clone();
-    cv::resize(inputImg, scaledImg,
-               cv::Size(Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
-                        Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H),
-               0, 0, cv::INTER_CUBIC);
-    cv::cvtColor(scaledImg, scaledImg, cv::COLOR_BGR2RGB);
-    osh.preprocess(dst, scaledImg.data, Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
+    cv::Mat networkImg = scaledImg;
+    if (networkImg.empty()) {
+        cv::resize(inputImg, networkImg,
+                   cv::Size(Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
+                            Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H),
+                   0, 0, cv::INTER_CUBIC);
+    }
+    osh.preprocess(dst, networkImg.data, Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
                    Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H, 3);
     auto inferenceOutput = osh({dst});
 
-    // tips: when you have done all the tricks but still get the wrong output result,
-    // try checking the type of inferenceOutput
-    int64_t* data = reinterpret_cast<int64_t*>(inferenceOutput[0].first);
-    cv::Mat segm(Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H, Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
-                 CV_8UC(3));
-    for (int i = 0; i < Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H; ++i) {
-        cv::Vec3b* ptrSegm = segm.ptr<cv::Vec3b>(i);
-        for (int j = 0; j < Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W; ++j) {
-            const auto& color = COLORS[data[i * Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W + j]];
-            ptrSegm[j] = cv::Vec3b(color[0], color[1], color[2]);
-        }
+    // labels are upscaled, colorized and blended straight into the copy of the frame
+    cv::Mat result = inputImg.clone();
+    osh.postprocess(inferenceOutput, labels->data(), &result, alpha);
+    return result;
+}
+
+cv::Mat processOneFrameTiled(Ort::SemanticSegmentationPaddleSegBisenetv2* osh, const std::string& modelPath,
+                             int numSessions, const cv::Mat& inputImg, float alpha)
+{
+    // osh plus numSessions - 1 sessions of the same model, running tiles in parallel
+    std::vector<std::unique_ptr<Ort::SemanticSegmentationPaddleSegBisenetv2>> extraSessions;
+    std::vector<Ort::SemanticSegmentationOrtSessionHandler*> sessions{osh};
+    for (int i = 1; i < numSessions; ++i) {
+        extraSessions.emplace_back(std::make_unique<Ort::SemanticSegmentationPaddleSegBisenetv2>(
+            Ort::CITY_SCAPES_NUM_CLASSES, modelPath, 0,
+            std::vector<std::vector<int64_t>>{{1, Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_CHANNEL,
+                                               Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H,
+                                               Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W}}));
+        sessions.emplace_back(extraSessions.back().get());
     }
 
-    cv::resize(segm, segm, inputImg.size(), 0, 0, cv::INTER_NEAREST);
-    segm = (1 - alpha) * inputImg + alpha * segm;
-    return segm;
+    // one tile per session in flight
+    Ort::TiledSegmentation tiler(sessions, Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_W,
+                                 Ort::SemanticSegmentationPaddleSegBisenetv2::IMG_H, TILE_OVERLAP, 1, sessions.size());
+
+    std::vector<uint8_t> labels(inputImg.rows * inputImg.cols);
+    tiler.segment(inputImg.data, inputImg.cols, inputImg.rows, inputImg.step, labels.data());
+    std::cout << "segmented " << tiler.numTiles() << " tiles on " << sessions.size() << " sessions" << std::endl;
+
+    cv::Mat result = inputImg.clone();
+    osh->overlayLabels(labels.data(), inputImg.cols, inputImg.rows, alpha, result.data, result.cols, result.rows,
+                       result.step);
+    return result;
 }
 }  // namespace
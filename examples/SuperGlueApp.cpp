@@ -12,9 +12,12 @@ namespace
 {
 using KeyPointAndDesc = std::pair<std::vector<cv::KeyPoint>, cv::Mat>;
 
-KeyPointAndDesc processOneFrameSuperPoint(const Ort::SuperPoint& superPointOsh, const cv::Mat& inputImg, float* dst,
-                                          int borderRemove = 4, float confidenceThresh = 0.015,
-                                          bool alignCorners = true, int distThresh = 2);
+// scaledImg: gray image at the model input size, keypoints are mapped back to origSize
+KeyPointAndDesc processOneFrameSuperPoint(const Ort::SuperPoint& superPointOsh, const cv::Mat& scaledImg,
+                                          const cv::Size& origSize, float* dst,
+                                          Ort::CellHeatmapDecoder* heatmapDecoder, int borderRemove = 4,
+                                          float confidenceThresh = 0.015, bool alignCorners = true,
+                                          int distThresh = 2);
 
 void normalizeDescriptors(cv::Mat* descriptors);
 }  // namespace
@@ -45,16 +48,20 @@ int main(int argc, char* argv[])
             throw std::runtime_error("failed to open " + IMAGE_PATHS[i]);
         }
     }
-    std::transform(IMAGE_PATHS.begin(), IMAGE_PATHS.end(), std::back_inserter(grays),
-                   [](const auto& imagePath) { return cv::imread(imagePath, 0); });
+    // the color images are kept for drawing, so derive the gray inputs from them instead of decoding every file twice
+    for (int i = 0; i < 2; ++i) {
+        grays.emplace_back(::resizeImage(images[i], Ort::SuperPoint::IMG_W, Ort::SuperPoint::IMG_H, 1));
+    }
 
-    std::vector<float> dst(Ort::SuperPoint::IMG_CHANNEL * Ort::SuperPoint::IMG_H * Ort::SuperPoint::IMG_W);
+    auto inputBuffers = superPointOsh.allocateInputBuffers();
+    float* dst = inputBuffers[0].data();
+    Ort::CellHeatmapDecoder heatmapDecoder;
 
     std::vector<KeyPointAndDesc> superPointResults;
-    std::transform(grays.begin(), grays.end(), std::back_inserter(superPointResults),
-                   [&superPointOsh, &dst](const auto& gray) {
-                       return processOneFrameSuperPoint(superPointOsh, gray, dst.data());
-                   });
+    for (int i = 0; i < 2; ++i) {
+        superPointResults.emplace_back(
+            processOneFrameSuperPoint(superPointOsh, grays[i], images[i].size(), dst, &heatmapDecoder));
+    }
 
     for (auto& curKeyPointAndDesc : superPointResults) {
         normalizeDescriptors(&curKeyPointAndDesc.second);
@@ -145,17 +152,18 @@ void normalizeDescriptors(cv::Mat* descriptors)
     }
 }
 
-KeyPointAndDesc processOneFrameSuperPoint(const Ort::SuperPoint& superPointOsh, const cv::Mat& inputImg, float* dst,
-                                          int borderRemove, float confidenceThresh, bool alignCorners, int distThresh)
+KeyPointAndDesc processOneFrameSuperPoint(const Ort::SuperPoint& superPointOsh, const cv::Mat& scaledImg,
+                                          const cv::Size& origSize, float* dst,
+                                          Ort::CellHeatmapDecoder* heatmapDecoder, int borderRemove,
+                                          float confidenceThresh, bool alignCorners, int distThresh)
 {
-    int origW = inputImg.cols, origH = inputImg.rows;
-    cv::Mat scaledImg;
-    cv::resize(inputImg, scaledImg, cv::Size(Ort::SuperPoint::IMG_W, Ort::SuperPoint::IMG_H), 0, 0, cv::INTER_CUBIC);
+    const int origW = origSize.width, origH = origSize.height;
     superPointOsh.preprocess(dst, scaledImg.data, Ort::SuperPoint::IMG_W, Ort::SuperPoint::IMG_H,
                              Ort::SuperPoint::IMG_CHANNEL);
     auto inferenceOutput = superPointOsh({dst});
 
-    std::vector<cv::KeyPoint> keyPoints = superPointOsh.getKeyPoints(inferenceOutput, borderRemove, confidenceThresh);
+    std::vector<cv::KeyPoint> keyPoints =
+        superPointOsh.getKeyPoints(inferenceOutput, borderRemove, confidenceThresh, heatmapDecoder);
 
     std::vector<int> descriptorShape(inferenceOutput[1].second.begin(), inferenceOutput[1].second.end());
     cv::Mat coarseDescriptorMat(descriptorShape.size(), descriptorShape.data(), CV_32F,
@@ -5,6 +5,9 @@
  *
  */
 
+#include <cassert>
+#include <stdexcept>
+
 #include "SuperPoint.hpp"
 #include "Utility.hpp"
 
@@ -13,14 +16,9 @@ namespace Ort
 void SuperPoint::preprocess(float* dst, const unsigned char* src, const int64_t targetImgWidth,
                             const int64_t targetImgHeight, const int numChannels) const
 {
-    for (int i = 0; i < targetImgHeight; ++i) {
-        for (int j = 0; j < targetImgWidth; ++j) {
-            for (int c = 0; c < numChannels; ++c) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                    (src[i * targetImgWidth * numChannels + j * numChannels + c] / 255.0);
-            }
-        }
-    }
+    assert(numChannels == IMG_CHANNEL);
+    this->preprocessInput<IMG_CHANNEL, Layout::HWC, ChannelOrder::BGR, InputNormalization>(
+        dst, src, targetImgWidth, targetImgHeight);
 }
 
 std::vector<int> SuperPoint::nmsFast(const std::vector<cv::KeyPoint>& keyPoints, int height, int width,
@@ -65,42 +63,24 @@ std::vector<int> SuperPoint::nmsFast(const std::vector<cv::KeyPoint>& keyPoints,
 
 std::vector<cv::KeyPoint>
 SuperPoint::getKeyPoints(const std::vector<Ort::OrtSessionHandler::DataOutputType>& inferenceOutput, int borderRemove,
-                         float confidenceThresh) const
+                         float confidenceThresh, CellHeatmapDecoder* heatmapDecoder) const
 {
-    std::vector<int> detectorShape(inferenceOutput[0].second.begin() + 1, inferenceOutput[0].second.end());
-
-    cv::Mat detectorMat(detectorShape.size(), detectorShape.data(), CV_32F,
-                        inferenceOutput[0].first);  // 65 x H/8 x W/8
-    cv::Mat buffer;
-
-    transposeNDWrapper(detectorMat, {1, 2, 0}, buffer);
-    buffer.copyTo(detectorMat);  // H/8 x W/8 x 65
-
-    for (int i = 0; i < detectorShape[1]; ++i) {
-        for (int j = 0; j < detectorShape[2]; ++j) {
-            Ort::softmax(detectorMat.ptr<float>(i, j), detectorShape[0]);
-        }
+    // 65 x H/8 x W/8 logits, the softmax and the keypoints are computed straight from them
+    const auto& detectorShape = inferenceOutput[0].second;
+    if (detectorShape.size() != 4 || detectorShape[1] != static_cast<int64_t>(CELL_SIZE * CELL_SIZE + 1)) {
+        throw std::runtime_error("unexpected detector shape");
     }
-    detectorMat = detectorMat({cv::Range::all(), cv::Range::all(), cv::Range(0, detectorShape[0] - 1)})
-                      .clone();                                                        // H/8 x W/8 x 64
-    detectorMat = detectorMat.reshape(1, {detectorShape[1], detectorShape[2], 8, 8});  // H/8 x W/8 x 8 x 8
-    transposeNDWrapper(detectorMat, {0, 2, 1, 3}, buffer);
-    buffer.copyTo(detectorMat);  // H/8 x 8 x W/8 x 8
-
-    detectorMat = detectorMat.reshape(1, {detectorShape[1] * 8, detectorShape[2] * 8});  // H x W
+    const auto& points = heatmapDecoder->decode(inferenceOutput[0].first, CELL_SIZE, detectorShape[2],
+                                                detectorShape[3], confidenceThresh, borderRemove);
 
     std::vector<cv::KeyPoint> keyPoints;
-    for (int i = borderRemove; i < detectorMat.rows - borderRemove; ++i) {
-        auto rowPtr = detectorMat.ptr<float>(i);
-        for (int j = borderRemove; j < detectorMat.cols - borderRemove; ++j) {
-            if (rowPtr[j] > confidenceThresh) {
-                cv::KeyPoint keyPoint;
-                keyPoint.pt.x = j;
-                keyPoint.pt.y = i;
-                keyPoint.response = rowPtr[j];
-                keyPoints.emplace_back(keyPoint);
-            }
-        }
+    keyPoints.reserve(points.size());
+    for (const auto& point : points) {
+        cv::KeyPoint keyPoint;
+        keyPoint.pt.x = point.x;
+        keyPoint.pt.y = point.y;
+        keyPoint.response = point.score;
+        keyPoints.emplace_back(keyPoint);
     }
 
     return keyPoints;
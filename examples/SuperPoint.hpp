@@ -20,6 +20,10 @@ class SuperPoint : public OrtSessionHandler
     static constexpr int64_t IMG_W = 640;
     static constexpr int64_t IMG_CHANNEL = 1;
 
+    // the detector scores cells of CELL_SIZE x CELL_SIZE pixels
+    static constexpr std::size_t CELL_SIZE = 8;
+    using InputNormalization = UnitScaleNormalization;
+
     using OrtSessionHandler::OrtSessionHandler;
 
     void preprocess(float* dst,                     //
@@ -34,10 +38,12 @@ class SuperPoint : public OrtSessionHandler
     /**
      *  @brief detect super point
      *
+     *  @param heatmapDecoder buffers of the decoding, owned by the caller: one per thread calling getKeyPoints
      *  @return vector of detected key points
      */
     std::vector<cv::KeyPoint> getKeyPoints(const std::vector<Ort::OrtSessionHandler::DataOutputType>& inferenceOutput,
-                                           int borderRemove, float confidenceThresh) const;
+                                           int borderRemove, float confidenceThresh,
+                                           CellHeatmapDecoder* heatmapDecoder) const;
 
     /**
      *  @brief estimate super point's keypoint descriptor
@@ -13,7 +13,9 @@ namespace
 {
 using KeyPointAndDesc = std::pair<std::vector<cv::KeyPoint>, cv::Mat>;
 
-KeyPointAndDesc processOneFrame(const Ort::SuperPoint& osh, const cv::Mat& inputImg, float* dst, int borderRemove = 4,
+// scaledImg: gray image at the model input size, keypoints are mapped back to origSize
+KeyPointAndDesc processOneFrame(const Ort::SuperPoint& osh, const cv::Mat& scaledImg, const cv::Size& origSize,
+                                float* dst, Ort::CellHeatmapDecoder* heatmapDecoder, int borderRemove = 4,
                                 float confidenceThresh = 0.015, bool alignCorners = true, int distThresh = 2);
 
 }  // namespace
@@ -41,14 +43,19 @@ int main(int argc, char* argv[])
             throw std::runtime_error("failed to open " + IMAGE_PATHS[i]);
         }
     }
-    std::transform(IMAGE_PATHS.begin(), IMAGE_PATHS.end(), std::back_inserter(grays),
-                   [](const auto& imagePath) { return cv::imread(imagePath, 0); });
+    // the color images are kept for drawing, so derive the gray inputs from them instead of decoding every file twice
+    for (int i = 0; i < 2; ++i) {
+        grays.emplace_back(::resizeImage(images[i], Ort::SuperPoint::IMG_W, Ort::SuperPoint::IMG_H, 1));
+    }
 
-    std::vector<float> dst(Ort::SuperPoint::IMG_CHANNEL * Ort::SuperPoint::IMG_H * Ort::SuperPoint::IMG_W);
+    auto inputBuffers = osh.allocateInputBuffers();
+    float* dst = inputBuffers[0].data();
+    Ort::CellHeatmapDecoder heatmapDecoder;
 
     std::vector<KeyPointAndDesc> results;
-    std::transform(grays.begin(), grays.end(), std::back_inserter(results),
-                   [&osh, &dst](const auto& gray) { return processOneFrame(osh, gray, dst.data()); });
+    for (int i = 0; i < 2; ++i) {
+        results.emplace_back(processOneFrame(osh, grays[i], images[i].size(), dst, &heatmapDecoder));
+    }
 
     cv::BFMatcher matcher(cv::NORM_L2, true /* crossCheck */);
     std::vector<cv::DMatch> knnMatches;
@@ -67,16 +74,16 @@ int main(int argc, char* argv[])
 
 namespace
 {
-KeyPointAndDesc processOneFrame(const Ort::SuperPoint& osh, const cv::Mat& inputImg, float* dst, int borderRemove,
+KeyPointAndDesc processOneFrame(const Ort::SuperPoint& osh, const cv::Mat& scaledImg, const cv::Size& origSize,
+                                float* dst, Ort::CellHeatmapDecoder* heatmapDecoder, int borderRemove,
                                 float confidenceThresh, bool alignCorners, int distThresh)
 {
-    int origW = inputImg.cols, origH = inputImg.rows;
-    cv::Mat scaledImg;
-    cv::resize(inputImg, scaledImg, cv::Size(Ort::SuperPoint::IMG_W, Ort::SuperPoint::IMG_H), 0, 0, cv::INTER_CUBIC);
+    const int origW = origSize.width, origH = origSize.height;
     osh.preprocess(dst, scaledImg.data, Ort::SuperPoint::IMG_W, Ort::SuperPoint::IMG_H, Ort::SuperPoint::IMG_CHANNEL);
     auto inferenceOutput = osh({dst});
 
-    std::vector<cv::KeyPoint> keyPoints = osh.getKeyPoints(inferenceOutput, borderRemove, confidenceThresh);
+    std::vector<cv::KeyPoint> keyPoints =
+        osh.getKeyPoints(inferenceOutput, borderRemove, confidenceThresh, heatmapDecoder);
 
     std::vector<int> descriptorShape(inferenceOutput[1].second.begin(), inferenceOutput[1].second.end());
     cv::Mat coarseDescriptorMat(descriptorShape.size(), descriptorShape.data(), CV_32F,
@@ -19,6 +19,8 @@
 
 #include <ort_utility/ort_utility.hpp>
 
+#include "Utility.hpp"
+
 static constexpr int64_t IMG_WIDTH = 224;
 static constexpr int64_t IMG_HEIGHT = 224;
 static constexpr int64_t IMG_CHANNEL = 3;
@@ -34,23 +36,25 @@ int main(int argc, char* argv[])
     const std::string ONNX_MODEL_PATH = argv[1];
     const std::string IMAGE_PATH = argv[2];
 
-    Ort::ImageClassificationOrtSessionHandler osh(Ort::IMAGENET_NUM_CLASSES, ONNX_MODEL_PATH, 0);
+    Ort::ImageClassificationOrtSessionHandler osh(
+        Ort::IMAGENET_NUM_CLASSES, ONNX_MODEL_PATH, 0,
+        std::vector<std::vector<int64_t>>{{1, IMG_CHANNEL, IMG_HEIGHT, IMG_WIDTH}});
     osh.initClassNames(Ort::IMAGENET_CLASSES);
 
-    cv::Mat img = cv::imread(IMAGE_PATH);
+    cv::Mat img = ::readResizedImage(IMAGE_PATH, IMG_WIDTH, IMG_HEIGHT, IMG_CHANNEL);
 
     if (img.empty()) {
         std::cerr << "Failed to read input image" << std::endl;
         return EXIT_FAILURE;
     }
 
-    cv::resize(img, img, cv::Size(IMG_WIDTH, IMG_HEIGHT));
-    float* dst = new float[IMG_WIDTH * IMG_HEIGHT * IMG_CHANNEL];
+    auto inputBuffers = osh.allocateInputBuffers();
+    float* dst = inputBuffers[0].data();
     osh.preprocess(dst, img.data, IMG_WIDTH, IMG_HEIGHT, IMG_CHANNEL, Ort::IMAGENET_MEAN, Ort::IMAGENET_STD);
 
     std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < TEST_TIMES; ++i) {
-        auto inferenceOutput = osh({reinterpret_cast<float*>(dst)});
+        auto inferenceOutput = osh({dst});
 
         const int TOP_K = 5;
         // osh.topK({inferenceOutput[0].first}, TOP_K);
@@ -60,7 +64,5 @@ int main(int argc, char* argv[])
     auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
     std::cout << elapsedTime.count() / 1000. << "[sec]" << std::endl;
 
-    delete[] dst;
-
     return 0;
 }
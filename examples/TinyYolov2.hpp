@@ -14,14 +14,32 @@
 #include <algorithm>
 #include <cstring>
 #include <string>
-#include <tuple>
 #include <vector>
 
 #include <ort_utility/ort_utility.hpp>
 
 namespace Ort
 {
-class TinyYolov2 : public ImageRecognitionOrtSessionHandlerBase
+// one 13 x 13 grid for a 416 x 416 input, 5 anchors per cell, softmax over classes
+struct TinyYolov2HeadConfig {
+    static constexpr YoloHead HEAD = YoloHead::ANCHOR_BASED;
+    static constexpr YoloLayout LAYOUT = YoloLayout::PLANAR;
+
+    // the pascal voc model
+    static constexpr std::size_t NUM_CLASSES = 20;
+
+    static constexpr std::array<int64_t, 1> STRIDES = {32};
+
+    // in grid cells of 32 pixels: 1.08 x 1.19, 3.42 x 4.41, 6.63 x 11.38, 9.42 x 5.11, 16.62 x 10.52
+    static constexpr std::array<std::array<float, 2>, 5> ANCHORS = {
+        {{34.56f, 38.08f}, {109.44f, 141.12f}, {212.16f, 364.16f}, {301.44f, 163.52f}, {531.84f, 336.64f}}};
+
+    static constexpr YoloActivation XY_ACTIVATION = YoloActivation::SIGMOID;
+    static constexpr YoloActivation OBJECTNESS_ACTIVATION = YoloActivation::SIGMOID;
+    static constexpr YoloActivation CLASS_ACTIVATION = YoloActivation::SOFTMAX;
+};
+
+class TinyYolov2 : public ObjectDetectionOrtSessionHandler
 {
  public:
     static constexpr int64_t IMG_WIDTH = 416;
@@ -30,13 +48,7 @@ class TinyYolov2 : public ImageRecognitionOrtSessionHandlerBase
 
     static constexpr int64_t IMG_CHANNEL = 3;
 
-    static constexpr int64_t FEATURE_MAP_SIZE = 13 * 13;
-
-    static constexpr int64_t NUM_BOXES = 1 * 13 * 13 * 125;
-
-    static constexpr int64_t NUM_ANCHORS = 5;
-
-    static constexpr float ANCHORS[10] = {1.08, 1.19, 3.42, 4.41, 6.63, 11.38, 9.42, 5.11, 16.62, 10.52};
+    using InputNormalization = IdentityNormalization;
 
     TinyYolov2(const uint16_t numClasses,                           //
                const std::string& modelPath,                        //
@@ -51,7 +63,18 @@ class TinyYolov2 : public ImageRecognitionOrtSessionHandlerBase
                     const int64_t targetImgHeight,  //
                     const int numChannels) const;
 
-    std::tuple<std::vector<std::array<float, 4>>, std::vector<float>, std::vector<uint64_t>>
-    postProcess(const std::vector<DataOutputType>& inferenceOutput, const float confidenceThresh = 0.5) const;
+ protected:
+    /**
+     *  @brief the grid size is taken from the output shape
+     *
+     *  scores are the confidences: objectness times class probability
+     */
+    void decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                std::size_t imageIdx,                                //
+                float confThresh,                                    //
+                DetectionBatch* detections) const override;
+
+ private:
+    YoloDecoder<TinyYolov2HeadConfig> m_decoder;
 };
 }  // namespace Ort
@@ -17,11 +17,11 @@
 
 static constexpr float CONFIDENCE_THRESHOLD = 0.5;
 static constexpr float NMS_THRESHOLD = 0.6;
-static const std::vector<cv::Scalar> COLORS = toCvScalarColors(Ort::VOC_COLOR_CHART);
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::TinyYolov2& osh, const cv::Mat& inputImg, float* dst);
+void processOneFrame(const Ort::TinyYolov2& osh, const cv::Mat& inputImg, int64_t imageWidth, int64_t imageHeight,
+                     float* dst, Ort::DetectionBatch* detections);
 }  // namespace
 
 int main(int argc, char* argv[])
@@ -41,7 +41,13 @@ int main(int argc, char* argv[])
                                                            Ort::TinyYolov2::IMG_HEIGHT}});
 
     osh.initClassNames(Ort::VOC_CLASSES);
-    std::array<float, Ort::TinyYolov2::IMG_WIDTH * Ort::TinyYolov2::IMG_HEIGHT * Ort::TinyYolov2::IMG_CHANNEL> dst;
+    const Ort::Renderer renderer(osh.classNames(), Ort::VOC_COLOR_CHART);
+
+    Ort::NmsParams nmsParams;
+    nmsParams.overlapThresh = NMS_THRESHOLD;
+    osh.setNmsParams(nmsParams);
+
+    auto inputBuffers = osh.allocateInputBuffers();
 
     cv::Mat img = cv::imread(IMAGE_PATH);
 
@@ -50,69 +56,30 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    auto resultImg = ::processOneFrame(osh, img, dst.data());
+    // the full image is kept for drawing: the network input is resized from it rather than decoding the file again
+    const cv::Mat inputImg = ::resizeImage(img, Ort::TinyYolov2::IMG_WIDTH, Ort::TinyYolov2::IMG_HEIGHT);
+
+    Ort::DetectionBatch detections;
+    ::processOneFrame(osh, inputImg, img.cols, img.rows, inputBuffers[0].data(), &detections);
+    renderer.drawDetections(detections, 0, img.data, img.cols, img.rows, img.step);
 
     const std::string output_filename = "output/result.jpg";
     std::cout << "[INFO] - Writing to output/result.jpg..." << std::endl;
-    cv::imwrite(output_filename, resultImg);
+    cv::imwrite(output_filename, img);
 
     return EXIT_SUCCESS;
 }
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::TinyYolov2& osh, const cv::Mat& inputImg, float* dst)
+void processOneFrame(const Ort::TinyYolov2& osh, const cv::Mat& inputImg, const int64_t imageWidth,
+                     const int64_t imageHeight, float* dst, Ort::DetectionBatch* detections)
 {
-    cv::Mat result;
-    cv::resize(inputImg, result, cv::Size(Ort::TinyYolov2::IMG_WIDTH, Ort::TinyYolov2::IMG_HEIGHT));
-
-    osh.preprocess(dst, result.data, Ort::TinyYolov2::IMG_WIDTH, Ort::TinyYolov2::IMG_HEIGHT,
+    osh.preprocess(dst, inputImg.data, Ort::TinyYolov2::IMG_WIDTH, Ort::TinyYolov2::IMG_HEIGHT,
                    Ort::TinyYolov2::IMG_CHANNEL);
     auto inferenceOutput = osh({dst});
     assert(inferenceOutput.size() == 1);
 
-    auto processedResult = osh.postProcess(inferenceOutput, CONFIDENCE_THRESHOLD);
-    std::vector<std::array<float, 4>> bboxes;
-    std::vector<float> scores;
-    std::vector<uint64_t> classIndices;
-    std::tie(bboxes, scores, classIndices) = processedResult;
-
-    if (bboxes.size() == 0) {
-        return result;
-    }
-
-    auto afterNmsIndices = Ort::nms(bboxes, scores, NMS_THRESHOLD);
-
-    std::vector<std::array<float, 4>> afterNmsBboxes;
-    std::vector<uint64_t> afterNmsClassIndices;
-
-    afterNmsBboxes.reserve(afterNmsIndices.size());
-    afterNmsClassIndices.reserve(afterNmsIndices.size());
-
-    for (const auto idx : afterNmsIndices) {
-        afterNmsBboxes.emplace_back(bboxes[idx]);
-        afterNmsClassIndices.emplace_back(classIndices[idx]);
-    }
-
-    const float original_width = Ort::TinyYolov2::IMG_WIDTH;
-    const float original_height = Ort::TinyYolov2::IMG_HEIGHT;
-
-    const float new_width = static_cast<float>(inputImg.cols);
-    const float new_height = static_cast<float>(inputImg.rows);
-
-    // Scaling factors for width and height
-    float width_ratio = new_width / original_width;
-    float height_ratio = new_height / original_height;
-
-    for (auto& bbox : afterNmsBboxes) {
-        bbox[0] *= width_ratio;   // x1
-        bbox[1] *= height_ratio;  // y1
-        bbox[2] *= width_ratio;   // x2
-        bbox[3] *= height_ratio;  // y2
-    }
-
-    result = ::visualizeOneImage(inputImg, afterNmsBboxes, afterNmsClassIndices, COLORS, osh.classNames());
-
-    return result;
+    osh.detect(inferenceOutput, {{imageWidth, imageHeight}}, CONFIDENCE_THRESHOLD, detections);
 }
 }  // namespace
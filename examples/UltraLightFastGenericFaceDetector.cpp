@@ -5,15 +5,29 @@
  *
  */
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 #include "UltraLightFastGenericFaceDetector.hpp"
 
+namespace
+{
+// Ref: https://github.com/Linzaer/Ultra-Light-Fast-Generic-Face-Detector-1MB/blob/master/vision/ssd/config/fd_config.py
+constexpr int STRIDES[] = {8, 16, 32, 64};
+const std::vector<std::vector<float>> MIN_BOXES = {{10, 16, 24}, {32, 48}, {64, 96}, {128, 192, 256}};
+constexpr float CENTER_VARIANCE = 0.1;
+constexpr float SIZE_VARIANCE = 0.2;
+}  // namespace
+
 namespace Ort
 {
 UltraLightFastGenericFaceDetector::UltraLightFastGenericFaceDetector(
     const std::string& modelPath, const std::optional<size_t>& gpuIdx,
     const std::optional<std::vector<std::vector<int64_t>>>& inputShapes)
-    : ImageRecognitionOrtSessionHandlerBase(1 /* num classes */, modelPath, gpuIdx, inputShapes)
+    : ObjectDetectionOrtSessionHandler(1 /* num classes */, modelPath, gpuIdx, inputShapes)
 {
+    this->updateInputSize(IMG_W, IMG_H);
 }
 
 UltraLightFastGenericFaceDetector::~UltraLightFastGenericFaceDetector()
@@ -27,11 +41,77 @@ void UltraLightFastGenericFaceDetector::preprocess(float* dst,
                                                    const int64_t targetImgHeight,  //
                                                    const int numChannels) const
 {
-    for (int c = 0; c < numChannels; ++c) {
-        for (int i = 0; i < targetImgHeight; ++i) {
-            for (int j = 0; j < targetImgWidth; ++j) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                    (src[i * targetImgWidth * numChannels + j * numChannels + c] - 127.) / 128.;
+    assert(numChannels == IMG_CHANNEL);
+    this->preprocessInput<IMG_CHANNEL, Layout::HWC, ChannelOrder::BGR, InputNormalization>(
+        dst, src, targetImgWidth, targetImgHeight);
+}
+
+void UltraLightFastGenericFaceDetector::updateInputSize(const int64_t width, const int64_t height)
+{
+    ObjectDetectionOrtSessionHandler::updateInputSize(width, height);
+    this->generatePriors();
+}
+
+void UltraLightFastGenericFaceDetector::decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                                               const std::size_t imageIdx,                          //
+                                               const float confThresh,                              //
+                                               DetectionBatch* detections) const
+{
+    // confidences: batchSize x numAnchors x 2 (background, face), boxes: batchSize x numAnchors x 4
+    const std::size_t numAnchors = inferenceOutput[0].second[1];
+    const float* confidences = inferenceOutput[0].first + imageIdx * numAnchors * 2;
+    const float* boxes = inferenceOutput[1].first + imageIdx * numAnchors * 4;
+    if (m_boxEncoding == BoxEncoding::PRIOR_OFFSETS && numAnchors != m_priors.size()) {
+        throw std::runtime_error("number of anchors does not match the prior boxes of the input size");
+    }
+
+    m_faceIndices.resize(numAnchors);
+    const std::size_t numFaces =
+        Ort::findAboveThreshold(confidences + 1, numAnchors, 2, confThresh, m_faceIndices.data());
+
+    // boxes are normalized, in network input coordinates until rescale()
+    const float inputWidth = m_inputImageWidth;
+    const float inputHeight = m_inputImageHeight;
+    for (std::size_t i = 0; i < numFaces; ++i) {
+        const uint64_t anchorIdx = m_faceIndices[i];
+        const float* box = boxes + 4 * anchorIdx;
+        const float score = confidences[2 * anchorIdx + 1];
+
+        if (m_boxEncoding == BoxEncoding::CORNERS) {
+            detections->push(box[0] * inputWidth, box[1] * inputHeight, box[2] * inputWidth, box[3] * inputHeight,
+                             score, 0);
+            continue;
+        }
+
+        const auto& prior = m_priors[anchorIdx];
+        const float xcenter = box[0] * CENTER_VARIANCE * prior[2] + prior[0];
+        const float ycenter = box[1] * CENTER_VARIANCE * prior[3] + prior[1];
+        const float width = std::exp(box[2] * SIZE_VARIANCE) * prior[2];
+        const float height = std::exp(box[3] * SIZE_VARIANCE) * prior[3];
+        detections->push((xcenter - width / 2) * inputWidth, (ycenter - height / 2) * inputHeight,
+                         (xcenter + width / 2) * inputWidth, (ycenter + height / 2) * inputHeight, score, 0);
+    }
+}
+
+// Ref: https://github.com/Linzaer/Ultra-Light-Fast-Generic-Face-Detector-1MB/blob/master/vision/utils/box_utils.py#L9
+void UltraLightFastGenericFaceDetector::generatePriors()
+{
+    m_priors.clear();
+    for (std::size_t index = 0; index < MIN_BOXES.size(); ++index) {
+        const float scaleW = static_cast<float>(m_inputImageWidth) / STRIDES[index];
+        const float scaleH = static_cast<float>(m_inputImageHeight) / STRIDES[index];
+        const int featureMapW = std::ceil(scaleW);
+        const int featureMapH = std::ceil(scaleH);
+
+        for (int j = 0; j < featureMapH; ++j) {
+            for (int i = 0; i < featureMapW; ++i) {
+                const float xcenter = std::min((i + 0.5f) / scaleW, 1.f);
+                const float ycenter = std::min((j + 0.5f) / scaleH, 1.f);
+                for (const float minBox : MIN_BOXES[index]) {
+                    m_priors.emplace_back(std::array<float, 4>{xcenter, ycenter,
+                                                               std::min(minBox / m_inputImageWidth, 1.f),
+                                                               std::min(minBox / m_inputImageHeight, 1.f)});
+                }
             }
         }
     }
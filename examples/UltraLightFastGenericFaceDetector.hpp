@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <array>
 #include <optional>
 #include <string>
 #include <vector>
@@ -15,7 +16,7 @@
 
 namespace Ort
 {
-class UltraLightFastGenericFaceDetector : public ImageRecognitionOrtSessionHandlerBase
+class UltraLightFastGenericFaceDetector : public ObjectDetectionOrtSessionHandler
 {
  public:
     static constexpr int64_t IMG_H = 480;
@@ -24,16 +25,59 @@ class UltraLightFastGenericFaceDetector : public ImageRecognitionOrtSessionHandl
 
     static constexpr int64_t IMG_CHANNEL = 3;
 
+    // (x - 127) / 128
+    using InputNormalization = ConstantNormalization<std::ratio<1, 128>, std::ratio<-127, 128>>;
+
     explicit UltraLightFastGenericFaceDetector(
         const std::string& modelPath, const std::optional<size_t>& gpuIdx = std::nullopt,
         const std::optional<std::vector<std::vector<std::int64_t>>>& inputShapes = std::nullopt);
 
     ~UltraLightFastGenericFaceDetector();
 
+    // how the box output tensor encodes the boxes
+    enum class BoxEncoding {
+        // normalized [xmin, ymin, xmax, ymax], for models exported with their box decoding
+        CORNERS,
+        // raw regressions against the prior boxes, for models exported without it
+        PRIOR_OFFSETS
+    };
+
     void preprocess(float* dst,                     //
                     const unsigned char* src,       //
                     const int64_t targetImgWidth,   //
                     const int64_t targetImgHeight,  //
                     const int numChannels) const;
+
+    void setBoxEncoding(const BoxEncoding boxEncoding)
+    {
+        m_boxEncoding = boxEncoding;
+    }
+
+    /**
+     *  @brief update the network input size, the prior boxes depend on it
+     */
+    void updateInputSize(int64_t width, int64_t height) override;
+
+ protected:
+    /**
+     *  @brief faces scoring above confThresh
+     *
+     *  the face scores are compared against the threshold with simd first; boxes are only read for the survivors
+     */
+    void decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                std::size_t imageIdx,                                //
+                float confThresh,                                    //
+                DetectionBatch* detections) const override;
+
+ private:
+    void generatePriors();
+
+ private:
+    BoxEncoding m_boxEncoding = BoxEncoding::CORNERS;
+
+    // normalized [xcenter, ycenter, width, height], one per anchor
+    std::vector<std::array<float, 4>> m_priors;
+
+    mutable std::vector<uint64_t> m_faceIndices;
 };
 }  // namespace Ort
@@ -16,12 +16,12 @@ static const std::vector<std::array<int, 3>> FACE_COLOR_CHART =
 
 static constexpr float CONFIDENCE_THRESHOLD = 0.7;
 static constexpr float NMS_THRESHOLD = 0.3;
-static const std::vector<cv::Scalar> COLORS = toCvScalarColors(FACE_COLOR_CHART);
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::UltraLightFastGenericFaceDetector& osh, const cv::Mat& inputImg, float* dst,
-                        const float confThresh = CONFIDENCE_THRESHOLD, const float nmsThresh = NMS_THRESHOLD);
+void processOneFrame(const Ort::UltraLightFastGenericFaceDetector& osh, const cv::Mat& inputImg, int64_t imageWidth,
+                     int64_t imageHeight, float* dst, Ort::DetectionBatch* detections,
+                     const float confThresh = CONFIDENCE_THRESHOLD);
 }  // namespace
 
 int main(int argc, char* argv[])
@@ -48,75 +48,33 @@ int main(int argc, char* argv[])
                                            Ort::UltraLightFastGenericFaceDetector::IMG_W}});
 
     osh.initClassNames(FACE_CLASSES);
+    const Ort::Renderer renderer(osh.classNames(), FACE_COLOR_CHART);
 
-    std::vector<float> dst(Ort::UltraLightFastGenericFaceDetector::IMG_CHANNEL *
-                           Ort::UltraLightFastGenericFaceDetector::IMG_H *
-                           Ort::UltraLightFastGenericFaceDetector::IMG_W);
-    auto result = processOneFrame(osh, img, dst.data());
-    cv::imwrite("result.jpg", result);
+    Ort::NmsParams nmsParams;
+    nmsParams.overlapThresh = NMS_THRESHOLD;
+    osh.setNmsParams(nmsParams);
+
+    auto inputBuffers = osh.allocateInputBuffers();
+    // the full image is kept for drawing: the network input is resized from it rather than decoding the file again
+    const cv::Mat inputImg = ::resizeImage(img, osh.IMG_W, osh.IMG_H);
+
+    Ort::DetectionBatch detections;
+    processOneFrame(osh, inputImg, img.cols, img.rows, inputBuffers[0].data(), &detections);
+    renderer.drawDetections(detections, 0, img.data, img.cols, img.rows, img.step);
+    cv::imwrite("result.jpg", img);
 
     return 0;
 }
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::UltraLightFastGenericFaceDetector& osh, const cv::Mat& inputImg, float* dst,
-                        const float confThresh, const float nmsThresh)
+void processOneFrame(const Ort::UltraLightFastGenericFaceDetector& osh, const cv::Mat& inputImg,
+                     const int64_t imageWidth, const int64_t imageHeight, float* dst, Ort::DetectionBatch* detections,
+                     const float confThresh)
 {
-    int origH = inputImg.rows;
-    int origW = inputImg.cols;
-
-    cv::Mat processedImg;
-    cv::resize(inputImg, processedImg, cv::Size(osh.IMG_W, osh.IMG_H));
-
-    osh.preprocess(dst, processedImg.data, osh.IMG_W, osh.IMG_H, 3);
+    osh.preprocess(dst, inputImg.data, osh.IMG_W, osh.IMG_H, 3);
     auto inferenceOutput = osh({dst});
 
-    // output includes two tensors:
-    // confidences: 1 x 17640 x 2 (2 represents 2 classes of background and face)
-    // bboxes: 1 x 17640 x 4 (4 represents bbox coordinates)
-
-    int numAnchors = inferenceOutput[0].second[1];
-
-    std::vector<std::array<float, 4>> bboxes;
-    std::vector<float> scores;
-    std::vector<uint64_t> classIndices;
-
-    for (auto indices = std::make_pair(0, 0); indices.first < numAnchors * 2 && indices.second < numAnchors * 4;
-         indices.first += 2, indices.second += 4) {
-        float conf = inferenceOutput[0].first[indices.first + 1];
-        if (conf < confThresh) {
-            continue;
-        }
-        float xmin = inferenceOutput[1].first[indices.second + 0] * origW;
-        float ymin = inferenceOutput[1].first[indices.second + 1] * origH;
-        float xmax = inferenceOutput[1].first[indices.second + 2] * origW;
-        float ymax = inferenceOutput[1].first[indices.second + 3] * origH;
-
-        bboxes.emplace_back(std::array<float, 4>{xmin, ymin, xmax, ymax});
-        scores.emplace_back(conf);
-
-        // only consider face
-        classIndices.emplace_back(0);
-    }
-
-    if (bboxes.size() == 0) {
-        return inputImg;
-    }
-
-    auto afterNmsIndices = Ort::nms(bboxes, scores, nmsThresh);
-
-    std::vector<std::array<float, 4>> afterNmsBboxes;
-    std::vector<uint64_t> afterNmsClassIndices;
-
-    afterNmsBboxes.reserve(afterNmsIndices.size());
-    afterNmsClassIndices.reserve(afterNmsIndices.size());
-
-    for (const auto idx : afterNmsIndices) {
-        afterNmsBboxes.emplace_back(bboxes[idx]);
-        afterNmsClassIndices.emplace_back(classIndices[idx]);
-    }
-
-    return visualizeOneImage(inputImg, afterNmsBboxes, afterNmsClassIndices, COLORS, osh.classNames());
+    osh.detect(inferenceOutput, {{imageWidth, imageHeight}}, confThresh, detections);
 }
 }  // namespace
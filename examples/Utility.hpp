@@ -18,6 +18,8 @@
 
 #include <opencv2/opencv.hpp>
 
+#include <ort_utility/ort_utility.hpp>
+
 namespace
 {
 inline std::vector<cv::Scalar> toCvScalarColors(const std::vector<std::array<int, 3>>& colors)
@@ -30,92 +32,39 @@ inline std::vector<cv::Scalar> toCvScalarColors(const std::vector<std::array<int
     return result;
 }
 
-inline cv::Mat visualizeOneImage(const cv::Mat& img, const std::vector<std::array<float, 4>>& bboxes,
-                                 const std::vector<uint64_t>& classIndices, const std::vector<cv::Scalar>& allColors,
-                                 const std::vector<std::string>& allClassNames = {})
+/**
+ *  @brief an image already decoded at full size, e.g. to draw results on, resized to (targetWidth x targetHeight)
+ *
+ *  @param numChannels 1 for grayscale, 3 for BGR
+ */
+inline cv::Mat resizeImage(const cv::Mat& image, int targetWidth, int targetHeight, int numChannels = 3)
 {
-    assert(bboxes.size() == classIndices.size());
-    if (!allClassNames.empty()) {
-        assert(allClassNames.size() > *std::max_element(classIndices.begin(), classIndices.end()));
-        assert(allColors.size() == allClassNames.size());
-    }
-
-    cv::Mat result = img.clone();
-
-    for (size_t i = 0; i < bboxes.size(); ++i) {
-        const auto& curBbox = bboxes[i];
-        const uint64_t classIdx = classIndices[i];
-        const cv::Scalar& curColor = allColors[classIdx];
-        const std::string curLabel = allClassNames.empty() ? std::to_string(classIdx) : allClassNames[classIdx];
-
-        cv::rectangle(result, cv::Point(curBbox[0], curBbox[1]), cv::Point(curBbox[2], curBbox[3]), curColor, 2);
-
-        int baseLine = 0;
-        cv::Size labelSize = cv::getTextSize(curLabel, cv::FONT_HERSHEY_COMPLEX, 0.35, 1, &baseLine);
-        cv::rectangle(result, cv::Point(curBbox[0], curBbox[1]),
-                      cv::Point(curBbox[0] + labelSize.width, curBbox[1] + static_cast<int>(1.3 * labelSize.height)),
-                      curColor, -1);
-        cv::putText(result, curLabel, cv::Point(curBbox[0], curBbox[1] + labelSize.height), cv::FONT_HERSHEY_COMPLEX,
-                    0.35, cv::Scalar(255, 255, 255));
+    cv::Mat img = image;
+    if (img.channels() != numChannels) {
+        cv::cvtColor(image, img, numChannels == 1 ? cv::COLOR_BGR2GRAY : cv::COLOR_GRAY2BGR);
     }
 
-    return result;
+    cv::Mat resized;
+    cv::resize(img, resized, cv::Size(targetWidth, targetHeight));
+    return resized;
 }
 
-inline cv::Mat visualizeOneImageWithMask(const cv::Mat& img, const std::vector<std::array<float, 4>>& bboxes,
-                                         const std::vector<uint64_t>& classIndices, const std::vector<cv::Mat>& masks,
-                                         const std::vector<cv::Scalar>& allColors,
-                                         const std::vector<std::string>& allClassNames = {},
-                                         const float maskThreshold = 0.5)
+/**
+ *  @brief read an image directly at (targetWidth x targetHeight), when the full size image is not needed
+ *
+ *  jpegs are decoded near the target size in the DCT domain, other formats fall back to cv::imread + cv::resize
+ *
+ *  @param numChannels 1 to decode straight to grayscale, 3 for BGR
+ */
+inline cv::Mat readResizedImage(const std::string& imagePath, int targetWidth, int targetHeight, int numChannels = 3)
 {
-    assert(bboxes.size() == classIndices.size());
-    if (!allClassNames.empty()) {
-        assert(allClassNames.size() > *std::max_element(classIndices.begin(), classIndices.end()));
-        assert(allColors.size() == allClassNames.size());
+    Ort::DecodedImage decoded = Ort::readImage(imagePath, targetWidth, targetHeight, numChannels);
+    if (!decoded.empty()) {
+        return cv::Mat(decoded.height, decoded.width, CV_8UC(decoded.channels), decoded.data.data()).clone();
     }
 
-    cv::Mat result = img.clone();
-
-    for (size_t i = 0; i < bboxes.size(); ++i) {
-        const auto& curBbox = bboxes[i];
-        const uint64_t classIdx = classIndices[i];
-        cv::Mat curMask = masks[i].clone();
-        const cv::Scalar& curColor = allColors[classIdx];
-        const std::string curLabel = allClassNames.empty() ? std::to_string(classIdx) : allClassNames[classIdx];
-
-        cv::rectangle(result, cv::Point(curBbox[0], curBbox[1]), cv::Point(curBbox[2], curBbox[3]), curColor, 2);
-
-        int baseLine = 0;
-        cv::Size labelSize = cv::getTextSize(curLabel, cv::FONT_HERSHEY_COMPLEX, 0.35, 1, &baseLine);
-        cv::rectangle(result, cv::Point(curBbox[0], curBbox[1]),
-                      cv::Point(curBbox[0] + labelSize.width, curBbox[1] + static_cast<int>(1.3 * labelSize.height)),
-                      curColor, -1);
-        cv::putText(result, curLabel, cv::Point(curBbox[0], curBbox[1] + labelSize.height), cv::FONT_HERSHEY_COMPLEX,
-                    0.35, cv::Scalar(255, 255, 255));
-
-        // ---------------------------------------------------------------------//
-        // Visualize masks
-
-        const cv::Rect curBoxRect(cv::Point(curBbox[0], curBbox[1]), cv::Point(curBbox[2], curBbox[3]));
-
-        cv::resize(curMask, curMask, curBoxRect.size());
-
-        cv::Mat finalMask = (curMask > maskThreshold);
-
-        cv::Mat coloredRoi = (0.3 * curColor + 0.7 * result(curBoxRect));
-
-        coloredRoi.convertTo(coloredRoi, CV_8UC3);
-
-        std::vector<cv::Mat> contours;
-        cv::Mat hierarchy;
-        finalMask.convertTo(finalMask, CV_8U);
-
-        cv::findContours(finalMask, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
-        cv::drawContours(coloredRoi, contours, -1, curColor, 5, cv::LINE_8, hierarchy, 100);
-        coloredRoi.copyTo(result(curBoxRect), finalMask);
-    }
-
-    return result;
+    cv::Mat img = cv::imread(imagePath, numChannels == 1 ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+    return img.empty() ? img : ::resizeImage(img, targetWidth, targetHeight, numChannels);
 }
 
 inline cv::Mat drawColorChart(const std::vector<std::string>& classes, const std::vector<cv::Scalar>& colors)
@@ -0,0 +1,254 @@
+/**
+ * @file    VectorMathValidation.cpp
+ *
+ * @author  btran
+ *
+ */
+
+/**
+ *   @brief measure the maximum ulp error of the vectorized exp, sigmoid, softmax, log-sum-exp and of the
+ *   probabilities of the channel argmax against libm in double precision, for every ExpAccuracy, on the instruction
+ *   set selected for this cpu; the labels of the channel argmax must be exact
+ *
+ *   exp and sigmoid are checked on every SAMPLE_STEP-th float of their input range, on every float with the
+ *   "exhaustive" argument (minutes); returns EXIT_FAILURE when an error exceeds the bound of its accuracy
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ort_utility/ort_utility.hpp>
+
+namespace
+{
+// maximum ulp errors accepted
+struct AccuracyBound {
+    Ort::ExpAccuracy accuracy;
+    const char* name;
+    double expUlp;
+    // the division and the rounding of 1 + exp(-x) come on top of the exp error
+    double sigmoidUlp;
+    // softmax and log-sum-exp: the float sum of a row and the scaling come on top of the exp error
+    double rowwiseUlp;
+};
+
+const AccuracyBound ACCURACY_BOUNDS[] = {
+    {Ort::ExpAccuracy::LOW, "LOW", 1280, 1280, 2560},
+    {Ort::ExpAccuracy::MEDIUM, "MEDIUM", 4, 6, 16},
+    {Ort::ExpAccuracy::HIGH, "HIGH", 1, 3, 16},
+};
+
+// a prime step, so that the sampled floats do not share their low mantissa bits
+constexpr std::size_t SAMPLE_STEP = 97;
+
+constexpr std::size_t CHUNK_SIZE = 1 << 16;
+
+// distance between result and the exact value, in units of the spacing of floats around the exact value
+double ulpError(const float result, const double exact)
+{
+    if (std::isnan(exact) || std::isnan(result)) {
+        return std::isnan(exact) && std::isnan(result) ? 0 : std::numeric_limits<double>::infinity();
+    }
+    const float rounded = static_cast<float>(exact);
+    if (std::isinf(rounded)) {
+        return result == rounded ? 0 : std::numeric_limits<double>::infinity();
+    }
+    const double spacing = std::nextafter(std::fabs(rounded), std::numeric_limits<float>::infinity()) -
+                           static_cast<double>(std::fabs(rounded));
+    return std::fabs(result - exact) / spacing;
+}
+
+// every step-th float of [first, last], both finite and of the same sign, visited chunk by chunk
+template <typename Func>
+void forEachFloat(const float first, const float last, const std::size_t step, const Func& func)
+{
+    uint32_t firstBits;
+    uint32_t lastBits;
+    std::memcpy(&firstBits, &first, sizeof(float));
+    std::memcpy(&lastBits, &last, sizeof(float));
+    if (firstBits > lastBits) {
+        std::swap(firstBits, lastBits);
+    }
+
+    std::vector<float> values;
+    values.reserve(CHUNK_SIZE);
+    for (uint64_t bits = firstBits; bits <= lastBits; bits += step) {
+        const uint32_t floatBits = bits;
+        float x;
+        std::memcpy(&x, &floatBits, sizeof(float));
+        values.emplace_back(x);
+        if (values.size() == CHUNK_SIZE) {
+            func(values);
+            values.clear();
+        }
+    }
+    func(values);
+}
+
+double maxExpUlp(const Ort::ExpAccuracy accuracy, const std::size_t step)
+{
+    std::vector<float> results(CHUNK_SIZE);
+    double maxUlp = 0;
+    auto check = [&](const std::vector<float>& values) {
+        Ort::vectorExp(values.data(), results.data(), values.size(), accuracy);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            maxUlp = std::max(maxUlp, ulpError(results[i], std::exp(static_cast<double>(values[i]))));
+        }
+    };
+
+    // results of exp are normal floats on [ln(FLT_MIN), ln(FLT_MAX)]
+    ::forEachFloat(-87.33f, -0.f, step, check);
+    ::forEachFloat(0.f, 88.72f, step, check);
+    return maxUlp;
+}
+
+double maxSigmoidUlp(const Ort::ExpAccuracy accuracy, const std::size_t step)
+{
+    std::vector<float> results(CHUNK_SIZE);
+    double maxUlp = 0;
+    auto check = [&](const std::vector<float>& values) {
+        const Ort::StridedRows rows{1, values.size(), values.size()};
+        Ort::sigmoid(values.data(), results.data(), rows, accuracy);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            maxUlp = std::max(maxUlp, ulpError(results[i], 1 / (1 + std::exp(-static_cast<double>(values[i])))));
+        }
+    };
+
+    ::forEachFloat(-87.f, -0.f, step, check);
+    ::forEachFloat(0.f, 87.f, step, check);
+    return maxUlp;
+}
+
+/**
+ *  @brief random tensors of numRows x rowSize logits in the layout of rows
+ *
+ *  the reference rounds logit - max to float as any float implementation does, then uses exact exp and sums: the
+ *  error of that rounding, up to ulp(|logit - max|) / 2 in the exponent, belongs to the input, not to the kernels
+ *
+ *  @return maximum ulp error of softmax and of log-sum-exp
+ */
+std::pair<double, double> maxRowwiseUlp(const Ort::ExpAccuracy accuracy, const Ort::StridedRows& rows,
+                                        std::mt19937* rng)
+{
+    std::normal_distribution<float> logits(0, 8);
+    const std::size_t tensorSize = (rows.numRows - 1) * rows.rowStride + (rows.rowSize - 1) * rows.elementStride + 1;
+    std::vector<float> src(tensorSize);
+    for (auto& logit : src) {
+        logit = logits(*rng);
+    }
+
+    std::vector<float> probs(tensorSize);
+    std::vector<float> lses(rows.numRows);
+    Ort::softmax(src.data(), probs.data(), rows, accuracy);
+    Ort::logSumExp(src.data(), lses.data(), rows, accuracy);
+
+    double maxSoftmaxUlp = 0;
+    double maxLogSumExpUlp = 0;
+    for (std::size_t i = 0; i < rows.numRows; ++i) {
+        auto at = [&](const std::size_t j) { return i * rows.rowStride + j * rows.elementStride; };
+        float maxLogit = -std::numeric_limits<float>::infinity();
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            maxLogit = std::max(maxLogit, src[at(j)]);
+        }
+        double sum = 0;
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            sum += std::exp(static_cast<double>(src[at(j)] - maxLogit));
+        }
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            const double exact = std::exp(static_cast<double>(src[at(j)] - maxLogit)) / sum;
+            // tiny probabilities are subnormal or flushed
+            if (exact > std::numeric_limits<float>::min()) {
+                maxSoftmaxUlp = std::max(maxSoftmaxUlp, ulpError(probs[at(j)], exact));
+            }
+        }
+        maxLogSumExpUlp = std::max(maxLogSumExpUlp, ulpError(lses[i], maxLogit + std::log(sum)));
+    }
+
+    return {maxSoftmaxUlp, maxLogSumExpUlp};
+}
+
+/**
+ *  @brief random numChannels x planeSize logits, with ties, through argmaxChannels
+ *
+ *  @return maximum ulp error of the probabilities of the labels, infinite if a label is wrong
+ */
+double maxArgmaxChannelsUlp(const Ort::ExpAccuracy accuracy, const std::size_t numChannels,
+                            const std::size_t planeSize, std::mt19937* rng)
+{
+    // logits rounded to halves: equal maximums are common and must go to the first channel
+    std::normal_distribution<float> logits(0, 8);
+    std::vector<float> src(numChannels * planeSize);
+    for (auto& logit : src) {
+        logit = std::round(2 * logits(*rng)) / 2;
+    }
+
+    std::vector<uint8_t> labels(planeSize);
+    std::vector<float> maxProbs(planeSize);
+    Ort::argmaxChannels(src.data(), numChannels, planeSize, planeSize, labels.data(), maxProbs.data(), accuracy);
+
+    double maxUlp = 0;
+    for (std::size_t i = 0; i < planeSize; ++i) {
+        std::size_t best = 0;
+        for (std::size_t c = 1; c < numChannels; ++c) {
+            best = src[c * planeSize + i] > src[best * planeSize + i] ? c : best;
+        }
+        if (labels[i] != best) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double sum = 0;
+        for (std::size_t c = 0; c < numChannels; ++c) {
+            sum += std::exp(static_cast<double>(src[c * planeSize + i] - src[best * planeSize + i]));
+        }
+        maxUlp = std::max(maxUlp, ulpError(maxProbs[i], 1 / sum));
+    }
+    return maxUlp;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const std::size_t step = argc > 1 && std::string(argv[1]) == "exhaustive" ? 1 : SAMPLE_STEP;
+    std::mt19937 rng(2020);
+
+    // contiguous rows, the channels of each pixel of a CHW tensor, and a layout that is gathered
+    const std::vector<std::pair<const char*, Ort::StridedRows>> layouts = {
+        {"rows", Ort::StridedRows{1000, 1000, 1000, 1}},
+        {"chw channels", Ort::StridedRows{60 * 80, 65, 1, 60 * 80}},
+        {"gathered", Ort::StridedRows{100, 21, 3, 400}},
+    };
+
+    bool passed = true;
+    std::cout << std::setw(8) << "accuracy" << std::setw(12) << "exp" << std::setw(12) << "sigmoid";
+    for (const auto& layout : layouts) {
+        std::cout << std::setw(24) << std::string("softmax ") + layout.first << std::setw(20)
+                  << std::string("lse ") + layout.first;
+    }
+    std::cout << std::setw(16) << "argmax chw" << " (max ulp)" << std::endl;
+
+    for (const auto& bound : ACCURACY_BOUNDS) {
+        const double expUlp = ::maxExpUlp(bound.accuracy, step);
+        const double sigmoidUlp = ::maxSigmoidUlp(bound.accuracy, step);
+        passed &= expUlp <= bound.expUlp && sigmoidUlp <= bound.sigmoidUlp;
+        std::cout << std::setw(8) << bound.name << std::setw(12) << expUlp << std::setw(12) << sigmoidUlp;
+
+        for (const auto& layout : layouts) {
+            const auto [softmaxUlp, logSumExpUlp] = ::maxRowwiseUlp(bound.accuracy, layout.second, &rng);
+            passed &= softmaxUlp <= bound.rowwiseUlp && logSumExpUlp <= bound.rowwiseUlp;
+            std::cout << std::setw(24) << softmaxUlp << std::setw(20) << logSumExpUlp;
+        }
+
+        const double argmaxUlp = ::maxArgmaxChannelsUlp(bound.accuracy, 19, 60 * 80 + 5, &rng);
+        passed &= argmaxUlp <= bound.rowwiseUlp;
+        std::cout << std::setw(16) << argmaxUlp << std::endl;
+    }
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -8,27 +8,37 @@
 #pragma once
 
 #include <string>
-#include <tuple>
 #include <vector>
 
-#include <opencv2/opencv.hpp>
-
 #include <ort_utility/ort_utility.hpp>
 
 namespace Ort
 {
-class YoloX : public ImageRecognitionOrtSessionHandlerBase
+// Ref: https://github.com/Megvii-BaseDetection/YOLOX/blob/main/demo/MegEngine/cpp/yolox.cpp#L64
+// the exported model applies the sigmoids itself; other strides, as for the P6 models, need their own config
+struct YoloXHeadConfig {
+    static constexpr YoloHead HEAD = YoloHead::ANCHOR_FREE;
+    static constexpr YoloLayout LAYOUT = YoloLayout::INTERLEAVED;
+
+    // the coco models; a config of 0 classes takes them at runtime instead
+    static constexpr std::size_t NUM_CLASSES = 80;
+
+    static constexpr std::array<int64_t, 3> STRIDES = {8, 16, 32};
+    static constexpr std::array<std::array<float, 2>, 0> ANCHORS = {};
+
+    static constexpr YoloActivation XY_ACTIVATION = YoloActivation::IDENTITY;
+    static constexpr YoloActivation OBJECTNESS_ACTIVATION = YoloActivation::IDENTITY;
+    static constexpr YoloActivation CLASS_ACTIVATION = YoloActivation::IDENTITY;
+};
+
+class YoloX : public ObjectDetectionOrtSessionHandler
 {
  public:
     static constexpr int64_t IMG_H = 640;
     static constexpr int64_t IMG_W = 640;
     static constexpr int64_t IMG_CHANNEL = 3;
 
-    struct Object {
-        cv::Rect_<float> pos;
-        int label;
-        float prob;
-    };
+    using InputNormalization = IdentityNormalization;
 
     YoloX(const uint16_t numClasses,                           //
           const std::string& modelPath,                        //
@@ -43,28 +53,25 @@ class YoloX : public ImageRecognitionOrtSessionHandlerBase
                     const int64_t targetImgHeight,  //
                     const int numChannels) const;
 
-    std::vector<Object> decodeOutputs(const float* prob, float confThresh) const;
-
     /**
-     *  @brief update strides
-     *  this method gives users the flexibility to use other yolox models
+     *  @brief update the network input size, which does not need to be square
      */
-    void updateStrides(const std::vector<int>& strides)
+    void updateInputSize(int64_t width, int64_t height) override
     {
-        if (strides.empty()) {
-            throw std::runtime_error("cannot update empty strides");
-        }
-        m_strides = strides;
+        ObjectDetectionOrtSessionHandler::updateInputSize(width, height);
+        m_decoder.setInputSize(width, height);
     }
 
- private:
-    std::vector<int> m_strides = {8, 16, 32};
-
-    struct GridAndStride;
-
-    std::vector<GridAndStride> genereateGridsAndStrides(int targetSize, const std::vector<int>& strides) const;
+ protected:
+    /**
+     *  @brief decode the anchors whose best class probability exceeds confThresh, one detection per anchor
+     */
+    void decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                std::size_t imageIdx,                                //
+                float confThresh,                                    //
+                DetectionBatch* detections) const override;
 
-    std::vector<Object> generateYoloXProposals(const float* prob, const std::vector<GridAndStride>& gridStrides,
-                                               float confThresh) const;
+ private:
+    YoloDecoder<YoloXHeadConfig> m_decoder;
 };
 }  // namespace Ort
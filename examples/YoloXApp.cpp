@@ -16,17 +16,18 @@ static constexpr int64_t NUM_CLASSES = 80;
 static const std::vector<std::array<int, 3>> COLOR_CHART = Ort::generateColorCharts(NUM_CLASSES);
 
 static constexpr float CONFIDENCE_THRESHOLD = 0.1;
-static const std::vector<cv::Scalar> COLORS = toCvScalarColors(COLOR_CHART);
+static constexpr float NMS_THRESHOLD = 0.45;
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::YoloX& osh, const cv::Mat& inputImg, float* dst, const float confThresh);
+void processOneFrame(const Ort::YoloX& osh, const cv::Mat& inputImg, int64_t imageWidth, int64_t imageHeight,
+                     float* dst, const float confThresh, Ort::DetectionBatch* detections);
 }  // namespace
 
 int main(int argc, char* argv[])
 {
     if (argc != 3) {
-        std::cerr << "Usage: [apps] [path/to/onnx/yolox] [path/to/image]" << std::endl;
+        std::cerr << "Usage: [apps] [path/to/onnx/yolox] [path/to/image/or/video]" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -34,9 +35,10 @@ int main(int argc, char* argv[])
     const std::string IMAGE_PATH = argv[2];
 
     cv::Mat img = cv::imread(IMAGE_PATH);
+    cv::VideoCapture video;
 
-    if (img.empty()) {
-        std::cerr << "Failed to read input image" << std::endl;
+    if (img.empty() && !video.open(IMAGE_PATH)) {
+        std::cerr << "Failed to read input image or video" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -45,65 +47,60 @@ int main(int argc, char* argv[])
         std::vector<std::vector<int64_t>>{{1, Ort::YoloX::IMG_CHANNEL, Ort::YoloX::IMG_H, Ort::YoloX::IMG_W}});
 
     osh.initClassNames(MSCOCO_WITHOUT_BG_CLASSES);
+    const Ort::Renderer renderer(osh.classNames(), COLOR_CHART);
+
+    Ort::NmsParams nmsParams;
+    nmsParams.overlapThresh = NMS_THRESHOLD;
+    nmsParams.classAware = true;
+    osh.setNmsParams(nmsParams);
+
+    auto inputBuffers = osh.allocateInputBuffers();
+    Ort::DetectionBatch detections;
+    if (!img.empty()) {
+        // the full image is kept for drawing: the network input is resized from it rather than decoding the file again
+        const cv::Mat inputImg = ::resizeImage(img, Ort::YoloX::IMG_W, Ort::YoloX::IMG_H);
+        processOneFrame(osh, inputImg, img.cols, img.rows, inputBuffers[0].data(), CONFIDENCE_THRESHOLD, &detections);
+        renderer.drawDetections(detections, 0, img.data, img.cols, img.rows, img.step);
+        cv::imwrite("result.jpg", img);
+        return EXIT_SUCCESS;
+    }
 
-    std::vector<float> dst(Ort::YoloX::IMG_CHANNEL * Ort::YoloX::IMG_H * Ort::YoloX::IMG_W);
-    auto result = processOneFrame(osh, img, dst.data(), CONFIDENCE_THRESHOLD);
-    cv::imwrite("result.jpg", result);
+    // frames of a static scene reuse the detections of the last inferred frame
+    osh.setFrameGate(Ort::FrameGateParams());
+    cv::VideoWriter writer;
+    cv::Mat frame;
+    while (video.read(frame)) {
+        if (osh.needsInference(frame.data, frame.cols, frame.rows, frame.channels(), frame.step)) {
+            processOneFrame(osh, frame, frame.cols, frame.rows, inputBuffers[0].data(), CONFIDENCE_THRESHOLD,
+                            &detections);
+        }
+        // drawn straight into the decoded frame, no copy per frame
+        renderer.drawDetections(detections, 0, frame.data, frame.cols, frame.rows, frame.step);
+        if (!writer.isOpened()) {
+            writer.open("result.avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), video.get(cv::CAP_PROP_FPS),
+                        frame.size());
+        }
+        writer.write(frame);
+    }
+    std::cout << "inferred " << osh.frameGate()->numInferred() << " frames, skipped "
+              << osh.frameGate()->numSkipped() << std::endl;
 
     return EXIT_SUCCESS;
 }
 
 namespace
 {
-cv::Mat processOneFrame(const Ort::YoloX& osh, const cv::Mat& inputImg, float* dst, const float confThresh)
+void processOneFrame(const Ort::YoloX& osh, const cv::Mat& inputImg, const int64_t imageWidth,
+                     const int64_t imageHeight, float* dst, const float confThresh, Ort::DetectionBatch* detections)
 {
-    int origW = inputImg.cols, origH = inputImg.rows;
-    std::vector<float> originImageSize{static_cast<float>(origH), static_cast<float>(origW)};
-    cv::Mat scaledImg;
-    cv::resize(inputImg, scaledImg, cv::Size(Ort::YoloX::IMG_W, Ort::YoloX::IMG_H), 0, 0, cv::INTER_CUBIC);
+    // inputImg is either already at the network input size or a full video frame
+    cv::Mat scaledImg = inputImg;
+    if (inputImg.cols != Ort::YoloX::IMG_W || inputImg.rows != Ort::YoloX::IMG_H) {
+        cv::resize(inputImg, scaledImg, cv::Size(Ort::YoloX::IMG_W, Ort::YoloX::IMG_H), 0, 0, cv::INTER_CUBIC);
+    }
     osh.preprocess(dst, scaledImg.data, Ort::YoloX::IMG_W, Ort::YoloX::IMG_H, 3);
     auto inferenceOutput = osh({dst});
 
-    std::vector<Ort::YoloX::Object> objects = osh.decodeOutputs(inferenceOutput[0].first, confThresh);
-
-    std::vector<std::array<float, 4>> bboxes;
-    std::vector<float> scores;
-    std::vector<uint64_t> classIndices;
-
-    float scaleW = 1. * origW / Ort::YoloX::IMG_W;
-    float scaleH = 1. * origH / Ort::YoloX::IMG_H;
-
-    for (const auto& object : objects) {
-        float xmin = object.pos.x * scaleW;
-        float ymin = object.pos.y * scaleH;
-        float xmax = (object.pos.x + object.pos.width) * scaleW;
-        float ymax = (object.pos.y + object.pos.height) * scaleH;
-
-        xmin = std::max<float>(xmin, 0);
-        ymin = std::max<float>(ymin, 0);
-        xmax = std::min<float>(xmax, inputImg.cols - 1);
-        ymax = std::min<float>(ymax, inputImg.rows - 1);
-
-        bboxes.emplace_back(std::array<float, 4>{xmin, ymin, xmax, ymax});
-        scores.emplace_back(object.prob);
-        classIndices.emplace_back(object.label);
-    }
-
-    auto afterNmsIndices = Ort::nms(bboxes, scores, confThresh);
-
-    std::vector<std::array<float, 4>> afterNmsBboxes;
-    std::vector<uint64_t> afterNmsClassIndices;
-
-    afterNmsBboxes.reserve(afterNmsIndices.size());
-    afterNmsClassIndices.reserve(afterNmsIndices.size());
-
-    for (const auto idx : afterNmsIndices) {
-        afterNmsBboxes.emplace_back(bboxes[idx]);
-        afterNmsClassIndices.emplace_back(classIndices[idx]);
-    }
-
-    return afterNmsBboxes.empty()
-               ? inputImg
-               : visualizeOneImage(inputImg, afterNmsBboxes, afterNmsClassIndices, COLORS, osh.classNames());
+    osh.detect(inferenceOutput, {{imageWidth, imageHeight}}, confThresh, detections);
 }
 }  // namespace
@@ -5,6 +5,8 @@
  *
  */
 
+#include <cassert>
+
 #include "Yolov3.hpp"
 #include <string>
 
@@ -13,8 +15,10 @@ namespace Ort
 Yolov3::Yolov3(const uint16_t numClasses,     //
                const std::string& modelPath,  //
                const std::optional<size_t>& gpuIdx, const std::optional<std::vector<std::vector<int64_t>>>& inputShapes)
-    : ImageRecognitionOrtSessionHandlerBase(numClasses, modelPath, gpuIdx, inputShapes)
+    : ObjectDetectionOrtSessionHandler(numClasses, modelPath, gpuIdx, inputShapes)
 {
+    this->updateInputSize(IMG_W, IMG_H);
+    m_nmsParams.algorithm = NmsAlgorithm::NONE;
 }
 
 Yolov3::~Yolov3()
@@ -27,13 +31,49 @@ void Yolov3::preprocess(float* dst,                     //
                         const int64_t targetImgHeight,  //
                         const int numChannels) const
 {
-    for (int c = 0; c < numChannels; ++c) {
-        for (int i = 0; i < targetImgHeight; ++i) {
-            for (int j = 0; j < targetImgWidth; ++j) {
-                dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                    src[i * targetImgWidth * numChannels + j * numChannels + c] / 255.0;
-            }
+    assert(numChannels == IMG_CHANNEL);
+    this->preprocessInput<IMG_CHANNEL, Layout::HWC, ChannelOrder::BGR, InputNormalization>(
+        dst, src, targetImgWidth, targetImgHeight);
+}
+
+void Yolov3::decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                    const std::size_t imageIdx,                          //
+                    const float confThresh,                              //
+                    DetectionBatch* detections) const
+{
+    // boxes: batchSize x numAnchors x 4, scores: batchSize x numClasses x numAnchors,
+    // selected indices: numSelected x 3 (batch index, class index, anchor index)
+    const int64_t numAnchors = inferenceOutput[0].second[1];
+    const int64_t numSelected = inferenceOutput[2].second[0];
+    DEBUG_LOG("number anchor candidates: %ld", numAnchors);
+    DEBUG_LOG("number output bboxes: %ld", numSelected);
+
+    const float* candidateBboxes = inferenceOutput[0].first + imageIdx * numAnchors * 4;
+    const float* candidateScores = inferenceOutput[1].first + imageIdx * m_numClasses * numAnchors;
+    const int32_t* selectedIndices = reinterpret_cast<const int32_t*>(inferenceOutput[2].first);
+
+    for (int64_t i = 0; i < numSelected; ++i) {
+        const int32_t* selected = selectedIndices + 3 * i;
+        if (selected[0] != static_cast<int32_t>(imageIdx)) {
+            continue;
         }
+
+        const int32_t classIdx = selected[1];
+        const int32_t anchorIdx = selected[2];
+        const float score = candidateScores[classIdx * numAnchors + anchorIdx];
+        if (score < confThresh) {
+            continue;
+        }
+
+        // [ymin, xmin, ymax, xmax]
+        const float* bbox = candidateBboxes + 4 * anchorIdx;
+        detections->push(bbox[1], bbox[0], bbox[3], bbox[2], score, classIdx);
     }
 }
+
+void Yolov3::rescale(const std::size_t imageIdx, const int64_t imageWidth, const int64_t imageHeight,
+                     DetectionBatch* detections) const
+{
+    detections->rescale(imageIdx, 1, 1, imageWidth, imageHeight);
+}
 }  // namespace Ort
@@ -8,7 +8,6 @@
 #pragma once
 
 #include <string>
-#include <tuple>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
@@ -17,7 +16,7 @@
 
 namespace Ort
 {
-class Yolov3 : public ImageRecognitionOrtSessionHandlerBase
+class Yolov3 : public ObjectDetectionOrtSessionHandler
 {
  public:
     static constexpr int64_t IMG_H = 416;
@@ -26,6 +25,8 @@ class Yolov3 : public ImageRecognitionOrtSessionHandlerBase
 
     static constexpr int64_t IMG_CHANNEL = 3;
 
+    using InputNormalization = UnitScaleNormalization;
+
     Yolov3(const uint16_t numClasses,                           //
            const std::string& modelPath,                        //
            const std::optional<size_t>& gpuIdx = std::nullopt,  //
@@ -38,5 +39,22 @@ class Yolov3 : public ImageRecognitionOrtSessionHandlerBase
                     const int64_t targetImgWidth,   //
                     const int64_t targetImgHeight,  //
                     const int numChannels) const;
+
+ protected:
+    /**
+     *  @brief gather the boxes selected by the nms built into the model
+     *
+     *  the model takes the original image size as second input: boxes are already in original image coordinates
+     */
+    void decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                std::size_t imageIdx,                                //
+                float confThresh,                                    //
+                DetectionBatch* detections) const override;
+
+    /**
+     *  @brief only clamp the boxes to the original image
+     */
+    void rescale(std::size_t imageIdx, int64_t imageWidth, int64_t imageHeight,
+                 DetectionBatch* detections) const override;
 };
 }  // namespace Ort
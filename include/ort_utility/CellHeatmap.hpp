@@ -0,0 +1,56 @@
+/**
+ * @file    CellHeatmap.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ort
+{
+struct HeatmapPoint {
+    // pixel of the point in the full resolution heatmap
+    int64_t x;
+    int64_t y;
+
+    // softmax probability of the pixel in its cell
+    float score;
+};
+
+/**
+ *  @brief points of a heatmap predicted per cell of cellSize x cellSize pixels, e.g. by the detector head of
+ *  SuperPoint, read straight from the logits without building the full resolution heatmap
+ *
+ *  each cell has cellSize * cellSize + 1 logits: logit r * cellSize + c scores pixel (r, c) of the cell, the last one
+ *  is the "no point" dustbin, and the score of a pixel is the softmax of its logit over the cell. Rather than a
+ *  softmax, dropping the dustbin and moving channels to pixels, each row of cells gets its log-sum-exps computed side
+ *  by side in the simd lanes: a pixel scores above thresh when its logit is above log-sum-exp + log(thresh), so the
+ *  rows of the channel planes are only compared with one bound per cell, into a bit mask per cell and pixel row, and
+ *  exp is evaluated for the points found. Buffers are reused across calls: keep one decoder per thread.
+ */
+class CellHeatmapDecoder
+{
+ public:
+    /**
+     *  @param logits [cellSize * cellSize + 1, heightInCells, widthInCells]
+     *  @param cellSize at most 32
+     *  @param border points closer than border pixels to the border of the heatmap are dropped
+     *  @return points scoring above thresh, in row major order of their pixels; valid until the next call
+     */
+    const std::vector<HeatmapPoint>& decode(const float* logits, std::size_t cellSize, std::size_t heightInCells,
+                                            std::size_t widthInCells, float thresh, std::size_t border = 0);
+
+ private:
+    std::vector<HeatmapPoint> m_points;
+
+    // per cell of the current row of cells
+    std::vector<float> m_logSumExps;
+    std::vector<float> m_bounds;
+    std::vector<uint32_t> m_pixelMasks;
+};
+}  // namespace Ort
@@ -0,0 +1,166 @@
+/**
+ * @file    DetectionBatch.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Nms.hpp"
+
+namespace Ort
+{
+/**
+ *  @brief detections of a batch of images, stored as structure of arrays
+ *
+ *  clear() keeps the capacity, so a batch reused frame after frame stops allocating once it has seen its largest
+ *  frame. The detections of each image are contiguous, see imageBegin() and imageEnd().
+ */
+class DetectionBatch
+{
+ public:
+    /**
+     *  @brief remove all images and detections, keeping the capacity
+     */
+    void clear();
+
+    /**
+     *  @brief start a new image: the following push() calls add detections to it
+     */
+    void beginImage()
+    {
+        m_imageOffsets.emplace_back(m_imageOffsets.back());
+    }
+
+    void push(float xmin, float ymin, float xmax, float ymax, float score, uint64_t classIdx)
+    {
+        assert(this->numImages() > 0);
+        m_xmins.emplace_back(xmin);
+        m_ymins.emplace_back(ymin);
+        m_xmaxs.emplace_back(xmax);
+        m_ymaxs.emplace_back(ymax);
+        m_scores.emplace_back(score);
+        m_classIndices.emplace_back(classIdx);
+        ++m_imageOffsets.back();
+    }
+
+    std::size_t size() const
+    {
+        return m_scores.size();
+    }
+
+    bool empty() const
+    {
+        return m_scores.empty();
+    }
+
+    std::size_t numImages() const
+    {
+        return m_imageOffsets.size() - 1;
+    }
+
+    // the detections of image imageIdx are [imageBegin(imageIdx), imageEnd(imageIdx))
+    std::size_t imageBegin(std::size_t imageIdx) const
+    {
+        return m_imageOffsets[imageIdx];
+    }
+
+    std::size_t imageEnd(std::size_t imageIdx) const
+    {
+        return m_imageOffsets[imageIdx + 1];
+    }
+
+    std::array<float, 4> bbox(std::size_t i) const
+    {
+        return {m_xmins[i], m_ymins[i], m_xmaxs[i], m_ymaxs[i]};
+    }
+
+    float score(std::size_t i) const
+    {
+        return m_scores[i];
+    }
+
+    uint64_t classIdx(std::size_t i) const
+    {
+        return m_classIndices[i];
+    }
+
+    const float* xmins() const
+    {
+        return m_xmins.data();
+    }
+
+    const float* ymins() const
+    {
+        return m_ymins.data();
+    }
+
+    const float* xmaxs() const
+    {
+        return m_xmaxs.data();
+    }
+
+    const float* ymaxs() const
+    {
+        return m_ymaxs.data();
+    }
+
+    const float* scores() const
+    {
+        return m_scores.data();
+    }
+
+    const uint64_t* classIndices() const
+    {
+        return m_classIndices.data();
+    }
+
+    /**
+     *  @brief run nms on each image and compact the kept detections in place
+     *
+     *  kept detections stay in their original order; soft and matrix nms update their scores
+     */
+    void nms(const NmsParams& params);
+
+    /**
+     *  @brief scale the boxes of one image, then clamp them to [0, imageWidth - 1] x [0, imageHeight - 1]
+     */
+    void rescale(std::size_t imageIdx, float scaleX, float scaleY, float imageWidth, float imageHeight);
+
+ private:
+    // kept: indices local to the image, scores: their new scores or nullptr
+    std::size_t compactImage(std::size_t begin, std::size_t out, const std::vector<uint64_t>& kept,
+                             const float* keptScores);
+
+ private:
+    std::vector<float> m_xmins;
+    std::vector<float> m_ymins;
+    std::vector<float> m_xmaxs;
+    std::vector<float> m_ymaxs;
+    std::vector<float> m_scores;
+    std::vector<uint64_t> m_classIndices;
+
+    // numImages() + 1 offsets
+    std::vector<std::size_t> m_imageOffsets = {0};
+
+    NmsEngine m_nmsEngine;
+    MultiClassNmsEngine m_multiClassNmsEngine;
+    SoftNmsEngine m_softNmsEngine;
+    MatrixNmsEngine m_matrixNmsEngine;
+
+    // boxes shifted per class, for class aware soft and matrix nms
+    std::array<std::vector<float>, 4> m_shiftedBoxes;
+
+    // the topK highest score detections of an image, when nms is skipped
+    std::vector<uint64_t> m_topIndices;
+
+    std::vector<uint64_t> m_keepIndices;
+};
+}  // namespace Ort
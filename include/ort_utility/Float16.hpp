@@ -0,0 +1,37 @@
+/**
+ * @file    Float16.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ort
+{
+/**
+ *  @brief IEEE 754 half precision value, layout compatible with the element type of fp16 tensors
+ */
+struct Float16 {
+    uint16_t value;
+};
+
+static_assert(sizeof(Float16) == 2, "Float16 must be 2 bytes");
+
+float toFloat(const Float16 half);
+
+/**
+ *  @brief round to nearest even, out of range values become infinity
+ */
+Float16 toFloat16(const float value);
+
+/**
+ *  @brief bulk conversions, using F16C or AVX-512 when the cpu supports them
+ */
+void convertFloat16ToFloat(const Float16* src, float* dst, std::size_t count);
+
+void convertFloatToFloat16(const float* src, Float16* dst, std::size_t count);
+}  // namespace Ort
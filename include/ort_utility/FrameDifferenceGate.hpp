@@ -0,0 +1,89 @@
+/**
+ * @file    FrameDifferenceGate.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ort
+{
+struct FrameGateParams {
+    // side in pixels of the square blocks the frames are averaged over
+    std::size_t blockSize = 16;
+
+    // largest change of the mean of a block, in gray levels, that still counts as the same scene
+    float maxBlockDifference = 6.f;
+
+    // inference is forced after this many skipped frames in a row, 0 to never force it
+    std::size_t refreshInterval = 30;
+};
+
+/**
+ *  @brief decides whether a frame of a mostly static camera needs a new inference or can reuse the last result
+ *
+ *  frames are downsampled to the means of their blocks, all channels together, and compared block by block with the
+ *  last frame that went through inference; a single block changing by more than maxBlockDifference is enough to
+ *  infer again, so small moving objects are not averaged away while sensor noise is. The block sums are one
+ *  sum-of-absolute-differences instruction per 32 bytes of frame.
+ */
+class FrameDifferenceGate
+{
+ public:
+    explicit FrameDifferenceGate(const FrameGateParams& params = FrameGateParams());
+
+    /**
+     *  @brief true when frame needs inference: first frame, new frame size, change above the threshold or refresh
+     *  interval reached; frame then becomes the reference the next frames are compared with
+     *
+     *  @param frame height rows of width pixels of numChannels interleaved bytes, stride bytes apart
+     */
+    bool needsInference(const uint8_t* frame, int64_t width, int64_t height, int numChannels, std::size_t stride);
+
+    // forget the reference frame: the next frame goes through inference
+    void reset();
+
+    const FrameGateParams& params() const
+    {
+        return m_params;
+    }
+
+    // largest block difference of the last frame with the reference, in gray levels
+    float lastScore() const
+    {
+        return m_lastScore;
+    }
+
+    std::size_t numInferred() const
+    {
+        return m_numInferred;
+    }
+
+    std::size_t numSkipped() const
+    {
+        return m_numSkipped;
+    }
+
+ private:
+    const FrameGateParams m_params;
+
+    int64_t m_width = 0;
+    int64_t m_height = 0;
+    int m_numChannels = 0;
+
+    // block means of the reference frame, and of the current frame
+    std::vector<float> m_referenceMeans;
+    std::vector<float> m_means;
+    std::vector<uint64_t> m_blockSums;
+
+    float m_lastScore = 0;
+    std::size_t m_numInferred = 0;
+    std::size_t m_numSkipped = 0;
+    std::size_t m_numSkippedInRow = 0;
+};
+}  // namespace Ort
@@ -26,12 +26,29 @@ class ImageClassificationOrtSessionHandler : public ImageRecognitionOrtSessionHa
 
     ~ImageClassificationOrtSessionHandler();
 
+    /**
+     *  @brief k highest scores of a single image, highest first
+     *
+     *  the output is left untouched: softmax is monotonic, so the classes are selected on the logits and only the k
+     *  selected scores are normalized
+     */
     std::vector<std::pair<int, float>> topK(const std::vector<float*>& inferenceOutput,  //
                                             const uint16_t k = 1,                        //
                                             const bool useSoftmax = true) const;
 
+    /**
+     *  @brief k highest scores of each row of a [batchSize, numClasses] output, rows spread over threads
+     */
+    std::vector<std::vector<std::pair<int, float>>> topK(const DataOutputType& inferenceOutput,  //
+                                                         const uint16_t k = 1,                   //
+                                                         const bool useSoftmax = true) const;
+
     std::string topKToString(const std::vector<float*>& inferenceOutput,  //
                              const uint16_t k = 1,                        //
                              const bool useSoftmax = true) const;
+
+ private:
+    void topKRow(const float* scores, uint16_t k, bool useSoftmax, std::vector<uint64_t>* indices,
+                 std::vector<std::pair<int, float>>* result) const;
 };
 }  // namespace Ort
@@ -0,0 +1,62 @@
+/**
+ * @file    ImageIngest.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Ort
+{
+struct DecodedImage {
+    // interleaved (HWC), tightly packed pixels; BGR order for 3-channel images to match opencv
+    std::vector<uint8_t> data;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    // size of the image in the file, before any scaling, in display orientation
+    int originalWidth = 0;
+    int originalHeight = 0;
+
+    bool empty() const
+    {
+        return data.empty();
+    }
+};
+
+/**
+ *  @brief decode a jpeg using libjpeg-turbo's DCT-domain scaling
+ *
+ *  the smallest scale factor M/8 whose output still covers (targetWidth x targetHeight) is chosen, so the decoder
+ *  skips most of the IDCT work for large inputs. The decoded size is therefore at least the target size, not exactly
+ *  it. Pass 0 as target size to decode at full resolution.
+ *
+ *  the exif orientation is applied as cv::imread does by default: sizes and pixels are in display orientation.
+ *
+ *  @param numChannels 1 to decode straight to grayscale, 3 to decode to BGR
+ *  @return empty image if the data is not a valid jpeg or the library was built without libjpeg
+ */
+DecodedImage decodeJpeg(const uint8_t* buffer, std::size_t bufferSize, int targetWidth = 0, int targetHeight = 0,
+                        int numChannels = 3);
+
+DecodedImage decodeJpeg(const std::string& imagePath, int targetWidth = 0, int targetHeight = 0, int numChannels = 3);
+
+/**
+ *  @brief bilinear resize of interleaved 8-bit images
+ */
+void resizeBilinear(const uint8_t* src, int srcWidth, int srcHeight, int numChannels,  //
+                    uint8_t* dst, int dstWidth, int dstHeight);
+
+/**
+ *  @brief decode a jpeg near the target size then finish the resize to exactly (targetWidth x targetHeight)
+ *
+ *  @return empty image if the file cannot be decoded as jpeg; callers can then fall back to another reader
+ */
+DecodedImage readImage(const std::string& imagePath, int targetWidth, int targetHeight, int numChannels = 3);
+}  // namespace Ort
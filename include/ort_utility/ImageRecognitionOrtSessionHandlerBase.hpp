@@ -7,10 +7,12 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "FrameDifferenceGate.hpp"
 #include "OrtSessionHandler.hpp"
 
 namespace Ort
@@ -46,8 +48,39 @@ class ImageRecognitionOrtSessionHandlerBase : public OrtSessionHandler
         return m_classNames;
     }
 
+    /**
+     *  @brief gate the frames of a mostly static camera with a FrameDifferenceGate, see needsInference()
+     */
+    void setFrameGate(const FrameGateParams& params);
+
+    /**
+     *  @brief whether frame must go through preprocess, inference and decoding, or the result of the last inferred
+     *  frame can be reused; always true without a frame gate
+     *
+     *  @param frame height rows of width pixels of numChannels interleaved bytes, stride bytes apart
+     */
+    bool needsInference(const uint8_t* frame, int64_t width, int64_t height, int numChannels, std::size_t stride);
+
+    // nullptr without a frame gate
+    const FrameDifferenceGate* frameGate() const
+    {
+        return m_frameGate.get();
+    }
+
  protected:
     const uint16_t m_numClasses;
     std::vector<std::string> m_classNames;
+
+ private:
+    template <int NUM_CHANNELS>
+    void preprocessImpl(float* dst,                         //
+                        const unsigned char* src,           //
+                        const int64_t targetImgWidth,       //
+                        const int64_t targetImgHeight,      //
+                        const std::vector<float>& meanVal,  //
+                        const std::vector<float>& stdVal) const;
+
+ private:
+    std::unique_ptr<FrameDifferenceGate> m_frameGate;
 };
 }  // namespace Ort
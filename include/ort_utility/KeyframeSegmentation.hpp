@@ -0,0 +1,149 @@
+/**
+ * @file    KeyframeSegmentation.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ort
+{
+struct KeyframeParams {
+    // motion is estimated on gray frames downsampled by this factor
+    std::size_t motionScale = 4;
+
+    // largest motion searched between two frames, in downsampled pixels
+    int searchRadius = 4;
+
+    // a block whose best match still differs by more than this mean, in gray levels, is newly uncovered content
+    float maxBlockError = 12.f;
+
+    // keyframe once the mean block motion summed since the last keyframe exceeds this, in frame pixels
+    float maxMotion = 16.f;
+
+    // keyframe once this fraction of the blocks is newly uncovered content
+    float maxUnmatchedFraction = 0.2f;
+
+    // keyframe after this many propagated frames in a row, however static the scene
+    std::size_t maxInterval = 10;
+};
+
+/**
+ *  @brief video segmentation running the model on keyframes only, the labels of the frames in between being the
+ *  labels of the last frame warped by its motion
+ *
+ *  motion is estimated by block matching: the frame is converted to gray and box downsampled by motionScale, then
+ *  every block of MOTION_BLOCK_SIZE x MOTION_BLOCK_SIZE downsampled pixels is searched for in the previous
+ *  downsampled frame, with one sum of absolute differences instruction per 4 rows of a block, and refined to a
+ *  fraction of a pixel by a line fit through the neighbour matches. The labels of a frame are the keyframe labels
+ *  warped by the motion summed since the keyframe. Keyframes are chosen by the measured motion: fast or uncovering
+ *  scenes get keyframes often, static ones every maxInterval frames.
+ *
+ *  usage, per frame: if nextFrame() is true, segment the frame with the model and pass its labels to
+ *  setKeyframeLabels(); labels() then holds the labels of the frame in both cases.
+ */
+class KeyframeSegmentation
+{
+ public:
+    // side of the matched blocks, in downsampled pixels
+    static constexpr std::size_t MOTION_BLOCK_SIZE = 8;
+
+    explicit KeyframeSegmentation(const KeyframeParams& params = KeyframeParams());
+
+    /**
+     *  @brief estimate the motion of frame since the previous one
+     *
+     *  @param frame height rows of width pixels of numChannels interleaved bytes, stride bytes apart
+     *  @return true when frame is a keyframe, whose labels must be set with setKeyframeLabels(); false when
+     *  labels() already holds its propagated labels
+     */
+    bool nextFrame(const uint8_t* frame, int64_t width, int64_t height, int numChannels, std::size_t stride);
+
+    /**
+     *  @brief labels of the last keyframe, at any resolution: they are warped at that resolution
+     */
+    void setKeyframeLabels(const uint8_t* labels, std::size_t labelWidth, std::size_t labelHeight);
+
+    // labelHeight() x labelWidth() labels of the last frame
+    const uint8_t* labels() const
+    {
+        return m_labels.data();
+    }
+
+    std::size_t labelWidth() const
+    {
+        return m_labelWidth;
+    }
+
+    std::size_t labelHeight() const
+    {
+        return m_labelHeight;
+    }
+
+    std::size_t numKeyframes() const
+    {
+        return m_numKeyframes;
+    }
+
+    std::size_t numPropagated() const
+    {
+        return m_numPropagated;
+    }
+
+    // mean block motion of the last frame, in frame pixels
+    float lastMotion() const
+    {
+        return m_lastMotion;
+    }
+
+ private:
+    // gray box downsampled frame into m_current
+    void downsample(const uint8_t* frame, int numChannels, std::size_t stride);
+
+    // add the best motion of every block of m_current in m_previous to m_motionXs, m_motionYs; returns the fraction
+    // of unmatched blocks
+    float estimateMotion();
+
+    // m_keyframeLabels warped by the block motion into m_labels
+    void warpLabels();
+
+ private:
+    const KeyframeParams m_params;
+
+    int64_t m_width = 0;
+    int64_t m_height = 0;
+    std::size_t m_smallWidth = 0;
+    std::size_t m_smallHeight = 0;
+    std::size_t m_numBlocksX = 0;
+    std::size_t m_numBlocksY = 0;
+
+    // downsampled gray frames
+    std::vector<uint8_t> m_previous;
+    std::vector<uint8_t> m_current;
+    std::vector<uint32_t> m_sums;
+
+    // per block, position in the keyframe minus position in the current frame, in downsampled pixels, summed frame
+    // after frame: warping the keyframe labels once does not accumulate the rounding of every frame
+    std::vector<float> m_motionXs;
+    std::vector<float> m_motionYs;
+
+    // sums of absolute differences of the candidate motions of a block
+    std::vector<uint32_t> m_sads;
+
+    std::vector<uint8_t> m_keyframeLabels;
+    std::vector<uint8_t> m_labels;
+    std::size_t m_labelWidth = 0;
+    std::size_t m_labelHeight = 0;
+
+    float m_motionSinceKeyframe = 0;
+    float m_lastMotion = 0;
+    std::size_t m_numPropagatedInRow = 0;
+    std::size_t m_numKeyframes = 0;
+    std::size_t m_numPropagated = 0;
+};
+}  // namespace Ort
@@ -0,0 +1,37 @@
+/**
+ * @file    MaskPaste.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ort
+{
+/**
+ *  @brief paste fixed size probability masks into one image of instance ids, e.g. the 28 x 28 masks of MaskRCNN
+ *
+ *  each mask is upsampled bilinearly to its box, as cv::resize does, thresholded and written straight into the rows
+ *  of instanceIds: no per instance image is allocated. Instance i owns the pixels of value i + 1, the background is 0,
+ *  and overlapping pixels go to the lowest instance, the best one when instances are sorted by decreasing score.
+ *
+ *  Rows of instanceIds are split over worker threads once the boxes cover enough pixels; every worker pastes all the
+ *  masks into its own rows, so the result does not depend on the number of threads.
+ *
+ *  @param masks the mask of instance i starts at masks + maskIndices[i] * maskHeight * maskWidth, or at
+ *  masks + i * maskHeight * maskWidth when maskIndices is nullptr
+ *  @param xmins, ymins, xmaxs, ymaxs box corners in pixels of instanceIds, one array per coordinate
+ *  @param numInstances at most 65535
+ *  @param instanceIds height x width, row major, overwritten
+ *  @param numThreads maximum number of worker threads, 0 for std::thread::hardware_concurrency()
+ */
+void pasteMasks(const float* masks, std::size_t maskWidth, std::size_t maskHeight, const uint64_t* maskIndices,  //
+                const float* xmins, const float* ymins,                                                          //
+                const float* xmaxs, const float* ymaxs,                                                          //
+                std::size_t numInstances, float maskThresh,                                                      //
+                uint16_t* instanceIds, std::size_t width, std::size_t height, std::size_t numThreads = 1);
+}  // namespace Ort
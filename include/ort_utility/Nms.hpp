@@ -0,0 +1,294 @@
+/**
+ * @file    Nms.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Ort
+{
+enum class NmsAlgorithm {
+    // keep the topK highest score boxes without suppression, for models running nms themselves
+    NONE,
+    GREEDY,
+    // Bodla et al., Soft-NMS -- Improving Object Detection With One Line of Code
+    SOFT,
+    // Wang et al., SOLOv2: Dynamic and Fast Instance Segmentation
+    MATRIX
+};
+
+// how soft and matrix nms decay the score of overlapping boxes
+enum class DecayFunction { LINEAR, GAUSSIAN };
+
+struct NmsParams {
+    NmsAlgorithm algorithm = NmsAlgorithm::GREEDY;
+
+    DecayFunction decay = DecayFunction::GAUSSIAN;
+
+    // greedy nms suppresses, linear soft nms decays, only the boxes overlapping more than this
+    float overlapThresh = 0.45;
+
+    // gaussian decay: exp(-iou^2 / sigma) for soft nms, exp(-(iou^2 - compensateIou^2) / sigma) for matrix nms
+    float sigma = 0.5;
+
+    // soft and matrix nms drop the boxes whose decayed score falls below
+    float scoreThresh = 0.001;
+
+    // maximum number of highest score candidates considered
+    uint64_t topK = std::numeric_limits<uint64_t>::max();
+
+    // only boxes of the same class suppress each other, see DetectionBatch::nms
+    bool classAware = false;
+};
+
+struct NmsResult {
+    // kept boxes in decreasing score order
+    std::vector<uint64_t> indices;
+
+    // scores of the kept boxes, decayed by soft and matrix nms
+    std::vector<float> scores;
+
+    // classes of the kept boxes, empty for class agnostic nms
+    std::vector<uint64_t> classIndices;
+};
+
+/**
+ *  @brief greedy non maximum suppression over boxes stored as structure of arrays
+ *
+ *  candidates are sorted once and gathered into contiguous, padded coordinate arrays; the IoU of the current box
+ *  against the following ones is computed 64 boxes at a time into a suppression bitmask, so the inner loop vectorizes
+ *  and nothing is allocated per iteration. Buffers are reused across calls: keep one engine per thread.
+ */
+class NmsEngine
+{
+ public:
+    /**
+     *  @param xmins, ymins, xmaxs, ymaxs box corners, one array per coordinate
+     *  @param topK maximum number of highest score candidates considered
+     *  @return indices of the kept boxes, in decreasing score order; valid until the next call
+     */
+    const std::vector<uint64_t>& run(const float* xmins, const float* ymins,  //
+                                     const float* xmaxs, const float* ymaxs,  //
+                                     const float* scores, std::size_t numBoxes, float overlapThresh = 0.45,
+                                     uint64_t topK = std::numeric_limits<uint64_t>::max());
+
+    /**
+     *  @brief same as above for [xmin, ymin, xmax, ymax] boxes
+     */
+    const std::vector<uint64_t>& run(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                                     float overlapThresh = 0.45,
+                                     uint64_t topK = std::numeric_limits<uint64_t>::max());
+
+ private:
+    // fill m_order with the indices of the topK highest scores, highest first, and size the candidate buffers
+    void sortCandidates(const float* scores, std::size_t numBoxes, uint64_t topK);
+
+    const std::vector<uint64_t>& suppress(float overlapThresh);
+
+ private:
+    std::vector<uint64_t> m_order;
+
+    // candidates in decreasing score order, padded to a multiple of 64 with empty boxes
+    std::vector<float> m_xmins;
+    std::vector<float> m_ymins;
+    std::vector<float> m_xmaxs;
+    std::vector<float> m_ymaxs;
+    std::vector<float> m_areas;
+
+    // one bit per sorted candidate
+    std::vector<uint64_t> m_suppressed;
+
+    std::vector<uint64_t> m_keepIndices;
+};
+
+/**
+ *  @brief class aware nms: boxes only suppress boxes of their own class
+ *
+ *  candidates are partitioned by class with a counting sort, then each class runs through an NmsEngine; classes are
+ *  spread over worker threads when there is enough work to amortize starting them.
+ */
+class MultiClassNmsEngine
+{
+ public:
+    using Result = NmsResult;
+
+    /**
+     *  @param numThreads maximum number of worker threads, 0 for std::thread::hardware_concurrency()
+     */
+    explicit MultiClassNmsEngine(std::size_t numThreads = 0);
+
+    /**
+     *  @param classIndices class of each box
+     *  @param topKPerClass maximum number of boxes kept per class
+     *  @param topK maximum number of boxes kept over all classes
+     *  @return kept boxes; valid until the next call
+     */
+    const Result& run(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                      const std::vector<uint64_t>& classIndices, float overlapThresh = 0.45,
+                      uint64_t topKPerClass = std::numeric_limits<uint64_t>::max(),
+                      uint64_t topK = std::numeric_limits<uint64_t>::max());
+
+    /**
+     *  @brief same as above for boxes stored as structure of arrays
+     */
+    const Result& run(const float* xmins, const float* ymins,  //
+                      const float* xmaxs, const float* ymaxs,  //
+                      const float* scores, const uint64_t* classIndices, std::size_t numBoxes,
+                      float overlapThresh = 0.45, uint64_t topKPerClass = std::numeric_limits<uint64_t>::max(),
+                      uint64_t topK = std::numeric_limits<uint64_t>::max());
+
+ private:
+    // boxAt(i) returns the [xmin, ymin, xmax, ymax] corners of box i
+    template <typename BoxAt>
+    void partitionByClass(std::size_t numBoxes, const BoxAt& boxAt, const float* scores,
+                          const uint64_t* classIndices);
+
+    const Result& suppress(const float* scores, const uint64_t* classIndices, float overlapThresh,
+                           uint64_t topKPerClass, uint64_t topK);
+
+    void suppressClass(NmsEngine* engine, std::size_t classIdx, float overlapThresh, uint64_t topKPerClass);
+
+    void merge(const float* scores, uint64_t topK);
+
+ private:
+    std::size_t m_numThreads;
+
+    // one engine per worker thread
+    std::vector<NmsEngine> m_engines;
+
+    // boxes of class c are at [m_classOffsets[c], m_classOffsets[c + 1]) of the partitioned arrays
+    std::vector<std::size_t> m_classOffsets;
+    std::vector<uint64_t> m_partitionedIndices;
+    std::vector<float> m_xmins;
+    std::vector<float> m_ymins;
+    std::vector<float> m_xmaxs;
+    std::vector<float> m_ymaxs;
+    std::vector<float> m_scores;
+
+    // kept original indices, per class
+    std::vector<std::vector<uint64_t>> m_classKeepIndices;
+
+    std::vector<std::size_t> m_cursors;
+    std::vector<std::size_t> m_schedule;
+
+    Result m_result;
+};
+
+/**
+ *  @brief topK highest score candidates in decreasing score order, as structure of arrays
+ */
+struct SortedCandidates {
+    void assign(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores, uint64_t topK);
+
+    void assign(const float* xmins, const float* ymins, const float* xmaxs, const float* ymaxs,
+                const float* sourceScores, std::size_t numBoxes, uint64_t topK);
+
+    std::size_t size() const
+    {
+        return indices.size();
+    }
+
+    // original index of each candidate
+    std::vector<uint64_t> indices;
+
+    std::vector<float> xmins;
+    std::vector<float> ymins;
+    std::vector<float> xmaxs;
+    std::vector<float> ymaxs;
+    std::vector<float> areas;
+    std::vector<float> scores;
+};
+
+/**
+ *  @brief soft nms: instead of being suppressed, boxes overlapping the current maximum get their score decayed
+ *
+ *  every step computes the IoU of the selected box against all candidates at once with the simd kernels; the cost is
+ *  quadratic in the number of candidates, so bound it with NmsParams::topK.
+ */
+class SoftNmsEngine
+{
+ public:
+    /**
+     *  @return kept boxes; valid until the next call
+     */
+    const NmsResult& run(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                         const NmsParams& params);
+
+    /**
+     *  @brief same as above for boxes stored as structure of arrays
+     */
+    const NmsResult& run(const float* xmins, const float* ymins,  //
+                         const float* xmaxs, const float* ymaxs,  //
+                         const float* scores, std::size_t numBoxes, const NmsParams& params);
+
+ private:
+    const NmsResult& suppress(const NmsParams& params);
+
+ private:
+    SortedCandidates m_candidates;
+    std::vector<float> m_ious;
+    NmsResult m_result;
+};
+
+/**
+ *  @brief matrix nms: every box is decayed at once by its overlaps with all higher score boxes
+ *
+ *  the IoU matrix is streamed one row at a time instead of being stored, and its columns are split over worker
+ *  threads; there is no sequential dependency between boxes as in greedy and soft nms.
+ */
+class MatrixNmsEngine
+{
+ public:
+    /**
+     *  @param numThreads maximum number of worker threads, 0 for std::thread::hardware_concurrency()
+     */
+    explicit MatrixNmsEngine(std::size_t numThreads = 0);
+
+    /**
+     *  @return kept boxes; valid until the next call
+     */
+    const NmsResult& run(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                         const NmsParams& params);
+
+    /**
+     *  @brief same as above for boxes stored as structure of arrays
+     */
+    const NmsResult& run(const float* xmins, const float* ymins,  //
+                         const float* xmaxs, const float* ymaxs,  //
+                         const float* scores, std::size_t numBoxes, const NmsParams& params);
+
+ private:
+    const NmsResult& suppress(const NmsParams& params);
+
+    // compensateIou of the columns [begin, end): the maximum IoU of a box with any higher score box
+    void computeCompensateIous(std::size_t begin, std::size_t end, float* ious);
+
+    /**
+     *  @brief decay factors of the columns [begin, end)
+     *
+     *  needs the compensateIou of all the previous columns, unless begin is 0 and updateCompensateIous is set: rows are
+     *  then visited in order, each completing the compensateIou the next rows need
+     */
+    void computeDecays(std::size_t begin, std::size_t end, const NmsParams& params, bool updateCompensateIous,
+                       float* ious);
+
+ private:
+    std::size_t m_numThreads;
+    SortedCandidates m_candidates;
+    std::vector<float> m_compensateIous;
+    std::vector<float> m_decays;
+
+    // one IoU row per worker thread
+    std::vector<std::vector<float>> m_ious;
+
+    NmsResult m_result;
+};
+}  // namespace Ort
@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
 
+#include "DetectionBatch.hpp"
 #include "ImageRecognitionOrtSessionHandlerBase.hpp"
+#include "Nms.hpp"
 
 namespace Ort
 {
@@ -24,5 +27,64 @@ class ObjectDetectionOrtSessionHandler : public ImageRecognitionOrtSessionHandle
         const std::optional<std::vector<std::vector<int64_t>>>& inputShapes = std::nullopt);
 
     ~ObjectDetectionOrtSessionHandler();
+
+    void setNmsParams(const NmsParams& nmsParams)
+    {
+        m_nmsParams = nmsParams;
+    }
+
+    const NmsParams& nmsParams() const
+    {
+        return m_nmsParams;
+    }
+
+    /**
+     *  @brief decode, nms and rescale the detections of every image of the batch
+     *
+     *  @param imageSizes [width, height] of each original image, one per image of the batch
+     *  @param detections reused output batch: it stops allocating once it has seen its largest frame
+     */
+    void detect(const std::vector<DataOutputType>& inferenceOutput,     //
+                const std::vector<std::array<int64_t, 2>>& imageSizes,  //
+                float confThresh,                                       //
+                DetectionBatch* detections) const;
+
+    /**
+     *  @brief update the network input size the model outputs are decoded against
+     */
+    virtual void updateInputSize(int64_t width, int64_t height);
+
+    int64_t inputImageWidth() const
+    {
+        return m_inputImageWidth;
+    }
+
+    int64_t inputImageHeight() const
+    {
+        return m_inputImageHeight;
+    }
+
+ protected:
+    /**
+     *  @brief push the detections of image imageIdx whose score exceeds confThresh, in network input coordinates
+     *
+     *  beginImage() has already been called on detections
+     */
+    virtual void decode(const std::vector<DataOutputType>& inferenceOutput,  //
+                        std::size_t imageIdx,                                //
+                        float confThresh,                                    //
+                        DetectionBatch* detections) const = 0;
+
+    /**
+     *  @brief map the detections of image imageIdx back to the original image, after nms
+     */
+    virtual void rescale(std::size_t imageIdx, int64_t imageWidth, int64_t imageHeight,
+                         DetectionBatch* detections) const;
+
+ protected:
+    NmsParams m_nmsParams;
+
+    int64_t m_inputImageWidth = 0;
+    int64_t m_inputImageHeight = 0;
 };
 }  // namespace Ort
@@ -13,6 +13,9 @@
 #include <utility>
 #include <vector>
 
+#include "Preprocess.hpp"
+#include "TensorBuffer.hpp"
+
 namespace Ort
 {
 class OrtSessionHandler
@@ -21,16 +24,61 @@ class OrtSessionHandler
     // DataOutputType->(pointer to output data, shape of output data)
     using DataOutputType = std::pair<float*, std::vector<int64_t>>;
 
+    // custom op registered on every session: uint8 [N, H, W, C] frame -> normalized float [N, C, H', W'] tensor
+    // models prepended with it (scripts/preprocess_op) take raw frames instead of preprocessed float buffers
+    static constexpr const char* PREPROCESS_CUSTOM_OP_DOMAIN = "ort_utility";
+    static constexpr const char* PREPROCESS_CUSTOM_OP_NAME = "ImagePreprocess";
+
     explicit OrtSessionHandler(const std::string& modelPath,  //
                                const std::optional<size_t>& gpuIdx = std::nullopt,
                                const std::optional<std::vector<std::vector<int64_t>>>& inputShapes = std::nullopt);
     ~OrtSessionHandler();
 
     // multiple inputs, multiple outputs
+    // each buffer is read as the element type of its model input (e.g. a uint8 frame for ImagePreprocess inputs, a
+    // Float16 buffer for fp16 inputs)
+    // fp16 outputs are widened to float; output data stays valid until the next call from the same thread
+    // several threads can run one handler at once, each keeping its last outputs until the handler is destroyed; the
+    // non-const methods must not run concurrently with any call
     std::vector<DataOutputType> operator()(const std::vector<float*>& inputImgData) const;
 
     void updateInputShapes(const std::vector<std::vector<int64_t>>& inputShapes);
 
+    bool inputIsFloat16(std::size_t inputIdx) const;
+
+    /**
+     *  @brief fetch only the given outputs in the next runs, e.g. to skip a head whose results are not needed: the
+     *  nodes feeding no selected output are not computed
+     *
+     *  operator() still returns one entry per model output, {nullptr, {}} for the outputs not selected; an empty
+     *  selection selects all the outputs
+     */
+    void selectOutputs(const std::vector<std::size_t>& outputIndices);
+
+    /**
+     *  @brief one aligned buffer per model input, sized from the current input shapes and element types
+     *
+     *  input shapes with dynamic dimensions must be set (constructor or updateInputShapes) beforehand
+     */
+    std::vector<TensorBuffer>
+    allocateInputBuffers(TensorBuffer::PageMode pageMode = TensorBuffer::PageMode::TRANSPARENT_HUGE_PAGES) const;
+
+ protected:
+    /**
+     *  @brief preprocess into the buffer of the given input, as fp16 if the model takes fp16
+     */
+    template <int NUM_CHANNELS, Layout SRC_LAYOUT, ChannelOrder CHANNEL_ORDER, typename Normalization, typename SrcT>
+    void preprocessInput(float* dst, const SrcT* src, const int64_t width, const int64_t height,
+                         const Normalization& norm = Normalization(), const std::size_t inputIdx = 0) const
+    {
+        if (this->inputIsFloat16(inputIdx)) {
+            preprocessImage<NUM_CHANNELS, SRC_LAYOUT, CHANNEL_ORDER>(reinterpret_cast<Float16*>(dst), src, width,
+                                                                     height, norm);
+        } else {
+            preprocessImage<NUM_CHANNELS, SRC_LAYOUT, CHANNEL_ORDER>(dst, src, width, height, norm);
+        }
+    }
+
  private:
     class OrtSessionHandlerIml;
     std::unique_ptr<OrtSessionHandlerIml> m_piml;
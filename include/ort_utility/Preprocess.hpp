@@ -0,0 +1,167 @@
+/**
+ * @file    Preprocess.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ratio>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "Float16.hpp"
+
+namespace Ort
+{
+// memory layout of the source image; the destination is always the CHW layout of a network input
+enum class Layout { HWC, CHW };
+
+// channel order of the destination; sources are BGR as read by opencv
+enum class ChannelOrder { BGR, RGB };
+
+/**
+ *  @brief dst = src * ScaleRatio + BiasRatio, with both factors fixed by the model at compile time
+ */
+template <typename ScaleRatio, typename BiasRatio = std::ratio<0>> struct ConstantNormalization {
+    static constexpr float SCALE = static_cast<float>(ScaleRatio::num) / ScaleRatio::den;
+    static constexpr float BIAS = static_cast<float>(BiasRatio::num) / BiasRatio::den;
+
+    constexpr float scale(int /*channel*/) const
+    {
+        return SCALE;
+    }
+
+    constexpr float bias(int /*channel*/) const
+    {
+        return BIAS;
+    }
+};
+
+// x
+using IdentityNormalization = ConstantNormalization<std::ratio<1>>;
+
+// x / 255
+using UnitScaleNormalization = ConstantNormalization<std::ratio<1, 255>>;
+
+/**
+ *  @brief dst = (src * preScale - mean[c]) / std[c], for statistics only known at runtime
+ */
+template <int NUM_CHANNELS> class MeanStdNormalization
+{
+ public:
+    MeanStdNormalization(const std::vector<float>& meanVal, const std::vector<float>& stdVal,
+                         const float preScale = 1 / 255.f)
+    {
+        if (meanVal.size() != NUM_CHANNELS || stdVal.size() != NUM_CHANNELS) {
+            throw std::runtime_error("mean and std must have one value per channel");
+        }
+
+        for (int c = 0; c < NUM_CHANNELS; ++c) {
+            m_scales[c] = preScale / stdVal[c];
+            m_biases[c] = -meanVal[c] / stdVal[c];
+        }
+    }
+
+    float scale(int channel) const
+    {
+        return m_scales[channel];
+    }
+
+    float bias(int channel) const
+    {
+        return m_biases[channel];
+    }
+
+ private:
+    std::array<float, NUM_CHANNELS> m_scales;
+    std::array<float, NUM_CHANNELS> m_biases;
+};
+
+namespace detail
+{
+template <int NUM_CHANNELS, Layout SRC_LAYOUT, ChannelOrder CHANNEL_ORDER, typename SrcT>
+void preprocessPixels(float* const* dstPlanes, const SrcT* src, const int64_t planeSize, const int64_t begin,
+                      const int64_t end, const std::array<float, NUM_CHANNELS>& scales,
+                      const std::array<float, NUM_CHANNELS>& biases)
+{
+    constexpr auto srcChannel = [](int c) { return CHANNEL_ORDER == ChannelOrder::RGB && c != 1 && c < 3 ? 2 - c : c; };
+
+    if constexpr (SRC_LAYOUT == Layout::HWC) {
+        for (int64_t i = begin; i < end; ++i) {
+            const SrcT* pixel = src + i * NUM_CHANNELS;
+            for (int c = 0; c < NUM_CHANNELS; ++c) {
+                dstPlanes[c][i - begin] = pixel[srcChannel(c)] * scales[c] + biases[c];
+            }
+        }
+    } else {
+        for (int c = 0; c < NUM_CHANNELS; ++c) {
+            const SrcT* srcPlane = src + srcChannel(c) * planeSize;
+            float* dstPlane = dstPlanes[c];
+            for (int64_t i = begin; i < end; ++i) {
+                dstPlane[i - begin] = srcPlane[i] * scales[c] + biases[c];
+            }
+        }
+    }
+}
+}  // namespace detail
+
+/**
+ *  @brief convert an image into a CHW network input
+ *
+ *  every parameter that decides the memory access pattern is a template parameter, so that each handler
+ *  instantiates exactly the variant it needs and the compiler can unroll the channel loop and vectorize the pixel
+ *  loop; normalization constants fixed by the model are folded in as well.
+ *
+ *  @param dst float or Float16 buffer; fp16 is produced in cache sized blocks converted in bulk
+ *  @param norm normalization policy providing scale(c) and bias(c) indexed by destination channel
+ */
+template <int NUM_CHANNELS, Layout SRC_LAYOUT, ChannelOrder CHANNEL_ORDER, typename Normalization, typename DstT,
+          typename SrcT>
+void preprocessImage(DstT* dst, const SrcT* src, const int64_t width, const int64_t height,
+                     const Normalization& norm = Normalization())
+{
+    static_assert(NUM_CHANNELS == 1 || NUM_CHANNELS == 3 || NUM_CHANNELS == 4, "only 1, 3 or 4 channels");
+    static_assert(CHANNEL_ORDER == ChannelOrder::BGR || NUM_CHANNELS >= 3, "RGB order needs color images");
+    static_assert(std::is_same_v<DstT, float> || std::is_same_v<DstT, Float16>, "destination must be float or fp16");
+
+    std::array<float, NUM_CHANNELS> scales;
+    std::array<float, NUM_CHANNELS> biases;
+    for (int c = 0; c < NUM_CHANNELS; ++c) {
+        scales[c] = norm.scale(c);
+        biases[c] = norm.bias(c);
+    }
+
+    const int64_t planeSize = width * height;
+
+    if constexpr (std::is_same_v<DstT, float>) {
+        float* dstPlanes[NUM_CHANNELS];
+        for (int c = 0; c < NUM_CHANNELS; ++c) {
+            dstPlanes[c] = dst + c * planeSize;
+        }
+        detail::preprocessPixels<NUM_CHANNELS, SRC_LAYOUT, CHANNEL_ORDER>(dstPlanes, src, planeSize, 0, planeSize,
+                                                                          scales, biases);
+    } else {
+        static constexpr int64_t BLOCK_SIZE = 1024;
+        float block[NUM_CHANNELS][BLOCK_SIZE];
+        float* blockPlanes[NUM_CHANNELS];
+        for (int c = 0; c < NUM_CHANNELS; ++c) {
+            blockPlanes[c] = block[c];
+        }
+
+        for (int64_t begin = 0; begin < planeSize; begin += BLOCK_SIZE) {
+            const int64_t end = std::min(begin + BLOCK_SIZE, planeSize);
+            detail::preprocessPixels<NUM_CHANNELS, SRC_LAYOUT, CHANNEL_ORDER>(blockPlanes, src, planeSize, begin, end,
+                                                                              scales, biases);
+            for (int c = 0; c < NUM_CHANNELS; ++c) {
+                convertFloatToFloat16(block[c], dst + c * planeSize + begin, end - begin);
+            }
+        }
+    }
+}
+}  // namespace Ort
@@ -0,0 +1,108 @@
+/**
+ * @file    Renderer.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DetectionBatch.hpp"
+
+namespace Ort
+{
+struct RenderParams {
+    // width in pixels of the box outlines
+    int boxThickness = 2;
+
+    // the glyphs of the 5 x 7 pixel font are scaled up by this integer factor
+    int textScale = 1;
+
+    // opacity of the instance masks, their outlines being opaque
+    float maskAlpha = 0.3f;
+};
+
+/**
+ *  @brief draws detections straight into the rows of a caller provided BGR frame: no copy of the frame, no
+ *  allocation per frame
+ *
+ *  the class tags, the class name in white on the class color, are rendered once at construction into a glyph atlas
+ *  from a built-in bitmap font; drawing a tag is then one copy per row. Boxes are filled runs of pixels, and masks are
+ *  blended run by run with the vectorized blendRow(), against a row of color terms precomputed per class.
+ *
+ *  draw functions are const and can run from several threads on different frames.
+ */
+class Renderer
+{
+ public:
+    /**
+     *  @param classNames name of each class, or empty to tag detections by their class index
+     *  @param colors [b, g, r] color of each class
+     */
+    Renderer(const std::vector<std::string>& classNames, const std::vector<std::array<int, 3>>& colors,
+             const RenderParams& params = RenderParams());
+
+    /**
+     *  @brief boxes and class tags of the detections of image imageIdx, the tag at the top left corner of the box
+     *
+     *  @param frame height rows of width BGR pixels, stride bytes apart, drawn in place
+     */
+    void drawDetections(const DetectionBatch& detections, std::size_t imageIdx, uint8_t* frame, std::size_t width,
+                        std::size_t height, std::size_t stride) const;
+
+    /**
+     *  @brief blend the color of its class into the pixels of every instance, and outline it
+     *
+     *  @param instanceIds height x width, row major, see pasteMasks(): pixels of value i + 1 belong to detection
+     *  detections.imageBegin(imageIdx) + i, 0 is the background
+     *  @param frame height rows of width BGR pixels, stride bytes apart, drawn in place
+     */
+    void drawMasks(const uint16_t* instanceIds, const DetectionBatch& detections, std::size_t imageIdx, uint8_t* frame,
+                   std::size_t width, std::size_t height, std::size_t stride) const;
+
+    std::size_t numClasses() const
+    {
+        return m_colors.size();
+    }
+
+    // size in pixels of the tag of class classIdx
+    std::size_t tagWidth(uint64_t classIdx) const
+    {
+        return m_tagWidths.at(classIdx);
+    }
+
+    std::size_t tagHeight() const
+    {
+        return m_tagHeight;
+    }
+
+ private:
+    void drawBox(const std::array<float, 4>& bbox, uint64_t classIdx, uint8_t* frame, std::size_t width,
+                 std::size_t height, std::size_t stride) const;
+
+    void drawTag(const std::array<float, 4>& bbox, uint64_t classIdx, uint8_t* frame, std::size_t width,
+                 std::size_t height, std::size_t stride) const;
+
+ private:
+    const RenderParams m_params;
+
+    std::vector<std::array<uint8_t, 3>> m_colors;
+
+    // BGR tags of all the classes, one after the other: row r of tag c is 3 * m_tagWidths[c] bytes at
+    // m_atlas[m_tagOffsets[c] + 3 * r * m_tagWidths[c]]
+    std::vector<uint8_t> m_atlas;
+    std::vector<std::size_t> m_tagOffsets;
+    std::vector<std::size_t> m_tagWidths;
+    std::size_t m_tagHeight = 0;
+
+    // per class, the color terms of blendRow() for a run of pixels of that color
+    std::vector<uint16_t> m_maskTerms;
+    uint16_t m_maskFrameWeight = 0;
+};
+}  // namespace Ort
@@ -0,0 +1,94 @@
+/**
+ * @file    Rle.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Ort
+{
+/**
+ *  @brief COCO run length encoding of a binary mask
+ *
+ *  counts are the lengths of the alternating runs of 0 and 1 over the pixels in column major order, starting with a
+ *  run of 0 that may be empty, as in pycocotools
+ */
+struct RleMask {
+    uint32_t height = 0;
+    uint32_t width = 0;
+    std::vector<uint32_t> counts;
+
+    // number of pixels of the mask
+    uint64_t area() const;
+
+    /**
+     *  @brief the compressed string of pycocotools, as stored in COCO json files; dst is overwritten
+     */
+    void toString(std::string* dst) const;
+
+    /**
+     *  @brief parse the compressed string of pycocotools, keeping the capacity of counts
+     */
+    void fromString(const std::string& str, uint32_t maskHeight, uint32_t maskWidth);
+};
+
+/**
+ *  @brief run length encoding of label images, e.g. the instance ids of pasteMasks or a segmentation label map
+ *
+ *  labels are transposed to column major order once, then the run boundaries are found 16 pixels at a time and
+ *  every boundary closes the run of the label ending there and of the label starting there, so all the labels are
+ *  encoded in a single pass whose cost grows with the number of runs, not of labels. Buffers and masks are reused
+ *  across calls: keep one codec per thread.
+ */
+class RleCodec
+{
+ public:
+    /**
+     *  @brief encode the pixels of every label of [firstLabel, firstLabel + numLabels), other labels are ignored
+     *
+     *  @param labels height x width, row major
+     *  @param firstLabel 1 for the instance ids of pasteMasks, whose background is 0
+     *  @return one mask per label, the mask of label l at index l - firstLabel; valid until the next call
+     */
+    const std::vector<RleMask>& encode(const uint8_t* labels, std::size_t width, std::size_t height,
+                                       std::size_t numLabels, uint16_t firstLabel = 0);
+
+    const std::vector<RleMask>& encode(const uint16_t* labels, std::size_t width, std::size_t height,
+                                       std::size_t numLabels, uint16_t firstLabel = 0);
+
+    /**
+     *  @brief set the pixels of mask to label, leaving the others untouched
+     *
+     *  @param labels mask.height x mask.width, row major
+     */
+    void decode(const RleMask& mask, uint8_t label, uint8_t* labels);
+
+    void decode(const RleMask& mask, uint16_t label, uint16_t* labels);
+
+ private:
+    template <typename Label>
+    const std::vector<RleMask>& encodeLabels(const Label* labels, std::size_t width, std::size_t height,
+                                             std::size_t numLabels, uint16_t firstLabel);
+
+    template <typename Label> void decodeLabels(const RleMask& mask, Label label, Label* labels);
+
+ private:
+    // labels in column major order, padded with one extra element
+    std::vector<uint16_t> m_columnMajor;
+
+    // one byte per pixel in column major order, set on the pixels of the decoded mask
+    std::vector<uint8_t> m_decoded;
+
+    // per label, position where its last run ended
+    std::vector<uint64_t> m_lastBoundaries;
+
+    std::vector<RleMask> m_masks;
+};
+}  // namespace Ort
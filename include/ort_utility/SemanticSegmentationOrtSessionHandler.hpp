@@ -0,0 +1,72 @@
+/**
+ * @file    SemanticSegmentationOrtSessionHandler.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "ImageRecognitionOrtSessionHandlerBase.hpp"
+
+namespace Ort
+{
+class SemanticSegmentationOrtSessionHandler : public ImageRecognitionOrtSessionHandlerBase
+{
+ public:
+    SemanticSegmentationOrtSessionHandler(
+        const uint16_t numClasses,                           //
+        const std::string& modelPath,                        //
+        const std::optional<size_t>& gpuIdx = std::nullopt,  //
+        const std::optional<std::vector<std::vector<int64_t>>>& inputShapes = std::nullopt);
+
+    ~SemanticSegmentationOrtSessionHandler();
+
+    /**
+     *  @brief [b, g, r] color of each label, for overlayLabels(); labels without a color are drawn black
+     */
+    void initColors(const std::vector<std::array<int, 3>>& colors);
+
+    /**
+     *  @brief one byte per pixel label map of image imageIdx, from the int64 labels of a model exporting its argmax
+     *
+     *  @param labelOutput batchSize x height x width, or batchSize x 1 x height x width
+     *  @param labels room for height x width labels
+     */
+    void narrowLabels(const DataOutputType& labelOutput, std::size_t imageIdx, uint8_t* labels) const;
+
+    /**
+     *  @brief one byte per pixel label map of image imageIdx, the argmax over the classes of a model exporting logits
+     *
+     *  rows are split over worker threads in bands, see argmaxChannels()
+     *
+     *  @param logitOutput batchSize x numClasses x height x width
+     *  @param labels room for height x width labels
+     *  @param maxProbs when given, room for height x width softmax probabilities of the labels
+     *  @param numThreads maximum number of worker threads, 0 for std::thread::hardware_concurrency()
+     */
+    void argmaxLabels(const DataOutputType& logitOutput, std::size_t imageIdx, uint8_t* labels,
+                      float* maxProbs = nullptr, std::size_t numThreads = 1) const;
+
+    /**
+     *  @brief frame = (1 - alpha) * frame + alpha * color of the label at the nearest pixel of the label map
+     *
+     *  nearest upscale, color lookup and blend are fused in one pass over the frame, without temporary images; frame
+     *  rows mapped to the same label row reuse its colors
+     *
+     *  @param labels labelHeight x labelWidth, row major
+     *  @param frame frameHeight rows of frameWidth BGR pixels, frameStride bytes apart, blended in place
+     */
+    void overlayLabels(const uint8_t* labels, std::size_t labelWidth, std::size_t labelHeight, float alpha,
+                       uint8_t* frame, std::size_t frameWidth, std::size_t frameHeight,
+                       std::size_t frameStride) const;
+
+ private:
+    // indexed by any uint8 label
+    std::array<std::array<uint8_t, 3>, 256> m_colors{};
+};
+}  // namespace Ort
@@ -0,0 +1,75 @@
+/**
+ * @file    TensorBuffer.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace Ort
+{
+/**
+ *  @brief owning, 64-byte aligned buffer for input/output tensors
+ *
+ *  buffers of at least one huge page are mmap'ed so that they can be backed by huge pages, which removes most of the
+ *  TLB misses when streaming through multi-megabyte tensors.
+ */
+class TensorBuffer
+{
+ public:
+    // cache line size, also enough for aligned avx-512 loads
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    enum class PageMode {
+        DEFAULT,
+        // madvise(MADV_HUGEPAGE), effective when transparent huge pages are enabled in "madvise" or "always" mode
+        TRANSPARENT_HUGE_PAGES,
+        // MAP_HUGETLB from the hugetlbfs pool (vm.nr_hugepages), falls back to transparent huge pages if exhausted
+        HUGETLB
+    };
+
+    TensorBuffer() = default;
+
+    explicit TensorBuffer(std::size_t numBytes, PageMode pageMode = PageMode::TRANSPARENT_HUGE_PAGES);
+
+    ~TensorBuffer();
+
+    TensorBuffer(TensorBuffer&& other) noexcept;
+
+    TensorBuffer& operator=(TensorBuffer&& other) noexcept;
+
+    TensorBuffer(const TensorBuffer&) = delete;
+
+    TensorBuffer& operator=(const TensorBuffer&) = delete;
+
+    template <typename T = float> T* data() const
+    {
+        return static_cast<T*>(m_data);
+    }
+
+    // size in bytes
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+ private:
+    void release();
+
+ private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+    // length of the mapping starting at m_data, 0 when the memory comes from aligned_alloc
+    std::size_t m_mappedSize = 0;
+};
+}  // namespace Ort
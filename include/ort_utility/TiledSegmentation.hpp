@@ -0,0 +1,137 @@
+/**
+ * @file    TiledSegmentation.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "SemanticSegmentationOrtSessionHandler.hpp"
+#include "TensorBuffer.hpp"
+
+namespace Ort
+{
+/**
+ *  @brief sliding window segmentation of frames larger than the model input, at full resolution
+ *
+ *  the frame is split into overlapping tiles of the model input size, the last tile of each row and column aligned to
+ *  the frame border; tiles smaller frames do not fill are padded with 0. Batches of tiles are run on a pool of
+ *  sessions, one worker thread per session, and merged straight into the label map of the frame:
+ *
+ *  - models exporting their int64 argmax (batch x height x width, or batch x 1 x height x width): every tile writes
+ *  the pixels closer to its center than to its neighbours', the seams falling in the middle of the overlaps, so no
+ *  merge buffer is needed;
+ *
+ *  - models exporting float logits (batch x numClasses x height x width): the logits are summed with weights ramping
+ *  down over the overlap at the tile borders, then argmaxed band by band, a band being the rows between the origins
+ *  of two tile rows, as soon as all the tiles overlapping it are merged. The sums only hold the rows of the tile rows
+ *  in flight, numClasses floats per pixel; tiles lock the bands they add to.
+ */
+class TiledSegmentation
+{
+ public:
+    /**
+     *  @param sessions handlers of the same model, each used by one worker at a time; their input shape is set to
+     *  batchSize x 3 x tileHeight x tileWidth
+     *  @param overlap pixels shared by neighbour tiles, less than the tile size
+     *  @param maxInFlightTiles cap on the tiles held in input buffers at once, 0 for no cap: only the first
+     *  max(maxInFlightTiles / batchSize, 1) sessions are used and the batch is reduced to the cap if larger
+     */
+    TiledSegmentation(const std::vector<SemanticSegmentationOrtSessionHandler*>& sessions,  //
+                      int64_t tileWidth, int64_t tileHeight, int64_t overlap,               //
+                      std::size_t batchSize = 1, std::size_t maxInFlightTiles = 0);
+
+    ~TiledSegmentation();
+
+    /**
+     *  @param frame frameHeight rows of frameWidth BGR pixels, frameStride bytes apart
+     *  @param labels frameHeight x frameWidth, row major, overwritten
+     */
+    void segment(const uint8_t* frame, int64_t frameWidth, int64_t frameHeight, std::size_t frameStride,
+                 uint8_t* labels);
+
+    // number of tiles of the last segmented frame
+    std::size_t numTiles() const
+    {
+        return m_tileXs.size() * m_tileYs.size();
+    }
+
+ private:
+    struct Worker {
+        SemanticSegmentationOrtSessionHandler* session;
+        std::vector<TensorBuffer> inputBuffers;
+        // one tile cropped out of the frame, tightly packed
+        std::vector<uint8_t> tile;
+    };
+
+    // run batches of the tiles left after nextTile until there are none
+    void runWorker(Worker* worker, std::atomic<std::size_t>* nextTile, const uint8_t* frame, int64_t frameWidth,
+                   int64_t frameHeight, std::size_t frameStride, uint8_t* labels);
+
+    void cropTile(std::size_t tileIdx, const uint8_t* frame, int64_t frameWidth, int64_t frameHeight,
+                  std::size_t frameStride, uint8_t* tile) const;
+
+    void mergeLabels(const int64_t* tileLabels, std::size_t tileIdx, int64_t frameWidth, uint8_t* labels) const;
+
+    void mergeLogits(const float* tileLogits, std::size_t numClasses, std::size_t tileIdx, int64_t frameWidth,
+                     int64_t frameHeight, uint8_t* labels);
+
+    // argmax the complete bands following the last argmaxed one, lock holding m_logitMutex
+    void argmaxReadyBands(std::unique_lock<std::mutex>* lock, int64_t frameWidth, int64_t frameHeight,
+                          uint8_t* labels);
+
+    // wake up the workers waiting for rows of the sums after one of them failed
+    void abortMerge();
+
+    // first row of band k
+    int64_t bandBegin(std::size_t k, int64_t frameHeight) const
+    {
+        return k < m_tileYs.size() ? m_tileYs[k] : frameHeight;
+    }
+
+ private:
+    const int64_t m_tileWidth;
+    const int64_t m_tileHeight;
+    const int64_t m_overlap;
+    const std::size_t m_batchSize;
+
+    std::vector<Worker> m_workers;
+
+    // tile origins along each axis, and the [begin, end) pixels each tile owns in the labels mode
+    std::vector<int64_t> m_tileXs;
+    std::vector<int64_t> m_tileYs;
+    std::vector<int64_t> m_ownedXs;
+    std::vector<int64_t> m_ownedYs;
+
+    // ramp weight of each tile column and row in the logits mode
+    std::vector<float> m_weightsX;
+    std::vector<float> m_weightsY;
+
+    // m_numLogitClasses planes of m_sumRows x frameWidth weighted logit sums, in the logits mode: frame row y is
+    // summed in row y % m_sumRows, zeroed again once its band is argmaxed
+    std::vector<float> m_logitSums;
+    std::size_t m_numLogitClasses = 0;
+    int64_t m_sumRows = 0;
+
+    // tiles left to merge into each band, and the lock of the band sums
+    std::vector<std::size_t> m_bandPendingTiles;
+    std::vector<std::mutex> m_bandMutexes;
+
+    // first band not argmaxed yet, whether a worker is argmaxing, whether a worker failed
+    std::size_t m_nextBand = 0;
+    bool m_argmaxing = false;
+    bool m_mergeAborted = false;
+
+    // guards the class count, the pending tiles and the band state; signaled when bands are argmaxed
+    std::mutex m_logitMutex;
+    std::condition_variable m_bandsReleased;
+};
+}  // namespace Ort
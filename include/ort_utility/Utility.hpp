@@ -8,9 +8,9 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
-#include <deque>
 #include <limits>
 #include <memory>
 #include <numeric>
@@ -21,6 +21,9 @@
 #include <iostream>
 #endif
 
+#include "Nms.hpp"
+#include "VectorMath.hpp"
+
 template <typename T, template <typename, typename = std::allocator<T>> class Container>
 std::ostream& operator<<(std::ostream& os, const Container<T>& container)
 {
@@ -32,19 +35,6 @@ std::ostream& operator<<(std::ostream& os, const Container<T>& container)
     return os;
 }
 
-namespace
-{
-template <typename T> std::deque<size_t> sortIndexes(const std::vector<T>& v)
-{
-    std::deque<size_t> indices(v.size());
-    std::iota(indices.begin(), indices.end(), 0);
-
-    std::stable_sort(std::begin(indices), std::end(indices), [&v](size_t i1, size_t i2) { return v[i1] < v[i2]; });
-
-    return indices;
-}
-}  // namespace
-
 namespace Ort
 {
 #if ENABLE_DEBUG
@@ -58,90 +48,120 @@ namespace Ort
 #define DEBUG_LOG(...)
 #endif
 
+/**
+ *  @brief in place softmax of a contiguous array, see the strided version in VectorMath.hpp
+ */
 inline void softmax(float* input, const size_t inputLen)
 {
-    const float maxVal = *std::max_element(input, input + inputLen);
-
-    const float sum = std::accumulate(input, input + inputLen, 0.0,
-                                      [&](float a, const float b) { return std::move(a) + expf(b - maxVal); });
-
-    const float offset = maxVal + logf(sum);
-    for (auto it = input; it != (input + inputLen); ++it) {
-        *it = expf(*it - offset);
-    }
+    softmax(input, input, StridedRows{1, inputLen, inputLen});
 }
 
 inline float sigmoid(const float x)
 {
-    return 1.0 / (1.0 + expf(-x));
+    return 1.f / (1.f + std::exp(-x));
 }
 
+/**
+ *  @brief greedy nms, see NmsEngine
+ *
+ *  @param topK maximum number of highest score candidates considered
+ *  @return indices of the kept boxes, in decreasing score order
+ */
 inline std::vector<uint64_t> nms(const std::vector<std::array<float, 4>>& bboxes,            //
                                  const std::vector<float>& scores,                           //
                                  const float overlapThresh = 0.45,                           //
                                  const uint64_t topK = std::numeric_limits<uint64_t>::max()  //
 )
 {
-    assert(bboxes.size() > 0);
-    uint64_t boxesLength = bboxes.size();
-    const uint64_t realK = std::max(std::min(boxesLength, topK), static_cast<uint64_t>(1));
-
-    std::vector<uint64_t> keepIndices;
-    keepIndices.reserve(realK);
-
-    std::deque<uint64_t> sortedIndices = ::sortIndexes(scores);
+    // reuse the engine buffers across calls of the same thread
+    thread_local NmsEngine engine;
+    return engine.run(bboxes, scores, overlapThresh, topK);
+}
 
-    // keep only topk bboxes
-    for (uint64_t i = 0; i < boxesLength - realK; ++i) {
-        sortedIndices.pop_front();
-    }
+/**
+ *  @brief class aware nms, see MultiClassNmsEngine
+ *
+ *  @param topKPerClass maximum number of boxes kept per class
+ *  @param topK maximum number of boxes kept over all classes
+ *  @return indices and classes of the kept boxes, in decreasing score order
+ */
+inline MultiClassNmsEngine::Result multiClassNms(const std::vector<std::array<float, 4>>& bboxes,                    //
+                                                 const std::vector<float>& scores,                                   //
+                                                 const std::vector<uint64_t>& classIndices,                          //
+                                                 const float overlapThresh = 0.45,                                   //
+                                                 const uint64_t topKPerClass = std::numeric_limits<uint64_t>::max(),  //
+                                                 const uint64_t topK = std::numeric_limits<uint64_t>::max()          //
+)
+{
+    thread_local MultiClassNmsEngine engine;
+    return engine.run(bboxes, scores, classIndices, overlapThresh, topKPerClass, topK);
+}
 
-    std::vector<float> areas;
-    areas.reserve(boxesLength);
-    std::transform(std::begin(bboxes), std::end(bboxes), std::back_inserter(areas),
-                   [](const auto& elem) { return (elem[2] - elem[0]) * (elem[3] - elem[1]); });
+/**
+ *  @brief soft nms, see SoftNmsEngine
+ *
+ *  @return indices and decayed scores of the kept boxes, in decreasing score order
+ */
+inline NmsResult softNms(const std::vector<std::array<float, 4>>& bboxes,  //
+                         const std::vector<float>& scores,                 //
+                         const NmsParams& params = NmsParams()             //
+)
+{
+    thread_local SoftNmsEngine engine;
+    return engine.run(bboxes, scores, params);
+}
 
-    while (!sortedIndices.empty()) {
-        uint64_t currentIdx = sortedIndices.back();
-        keepIndices.emplace_back(currentIdx);
+/**
+ *  @brief matrix nms, see MatrixNmsEngine
+ *
+ *  @return indices and decayed scores of the kept boxes, in decreasing score order
+ */
+inline NmsResult matrixNms(const std::vector<std::array<float, 4>>& bboxes,  //
+                           const std::vector<float>& scores,                 //
+                           const NmsParams& params = NmsParams()             //
+)
+{
+    thread_local MatrixNmsEngine engine;
+    return engine.run(bboxes, scores, params);
+}
 
-        if (sortedIndices.size() == 1) {
-            break;
+/**
+ *  @brief class agnostic nms with the algorithm of params
+ *
+ *  @return indices and scores of the kept boxes, in decreasing score order
+ */
+inline NmsResult nms(const std::vector<std::array<float, 4>>& bboxes,  //
+                     const std::vector<float>& scores,                 //
+                     const NmsParams& params                           //
+)
+{
+    switch (params.algorithm) {
+        case NmsAlgorithm::SOFT: {
+            return softNms(bboxes, scores, params);
         }
-
-        sortedIndices.pop_back();
-        std::vector<float> ious;
-        ious.reserve(sortedIndices.size());
-
-        const auto& curBbox = bboxes[currentIdx];
-        const float curArea = areas[currentIdx];
-
-        std::deque<uint64_t> newSortedIndices;
-
-        for (const uint64_t elem : sortedIndices) {
-            const auto& bbox = bboxes[elem];
-            float tmpXmin = std::max(curBbox[0], bbox[0]);
-            float tmpYmin = std::max(curBbox[1], bbox[1]);
-            float tmpXmax = std::min(curBbox[2], bbox[2]);
-            float tmpYmax = std::min(curBbox[3], bbox[3]);
-
-            float tmpW = std::max<float>(tmpXmax - tmpXmin, 0.0);
-            float tmpH = std::max<float>(tmpYmax - tmpYmin, 0.0);
-
-            const float intersection = tmpW * tmpH;
-            const float tmpArea = areas[elem];
-            const float unionArea = tmpArea + curArea - intersection;
-            const float iou = intersection / unionArea;
-
-            if (iou <= overlapThresh) {
-                newSortedIndices.emplace_back(elem);
+        case NmsAlgorithm::MATRIX: {
+            return matrixNms(bboxes, scores, params);
+        }
+        case NmsAlgorithm::NONE: {
+            NmsResult result;
+            result.indices.resize(std::min<uint64_t>(params.topK, scores.size()));
+            result.indices.resize(Ort::topK(scores.data(), scores.size(), params.topK, result.indices.data()));
+            result.scores.reserve(result.indices.size());
+            for (const uint64_t idx : result.indices) {
+                result.scores.emplace_back(scores[idx]);
             }
+            return result;
+        }
+        default: {
+            NmsResult result;
+            result.indices = nms(bboxes, scores, params.overlapThresh, params.topK);
+            result.scores.reserve(result.indices.size());
+            for (const uint64_t idx : result.indices) {
+                result.scores.emplace_back(scores[idx]);
+            }
+            return result;
         }
-
-        sortedIndices = newSortedIndices;
     }
-
-    return keepIndices;
 }
 
 inline std::vector<std::array<int, 3>> generateColorCharts(const uint16_t numClasses = 1000, const uint16_t seed = 255)
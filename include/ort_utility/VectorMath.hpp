@@ -0,0 +1,132 @@
+/**
+ * @file    VectorMath.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ort
+{
+/**
+ *  @brief index of the first maximum of data, using AVX2 or AVX-512 when the cpu supports them
+ *
+ *  size must not be 0
+ */
+std::size_t argmax(const float* data, std::size_t size);
+
+/**
+ *  @brief stream compaction: write the indices i < count whose element data[i * stride] is greater than thresh
+ *
+ *  vectorized for strides dividing 8, e.g. the one channel of interest of interleaved scores
+ *
+ *  @param indices room for count indices
+ *  @return number of indices written, in increasing order
+ */
+std::size_t findAboveThreshold(const float* data, std::size_t count, std::size_t stride, float thresh,
+                               uint64_t* indices);
+
+/**
+ *  @brief partial selection: the indices of the k largest elements of data, largest first
+ *
+ *  a heap keeps the k best elements seen so far and full registers are compared against its smallest one, so once
+ *  the heap is warm most of data is skipped without touching the heap. Ties go to the lower index.
+ *
+ *  @param indices room for min(k, size) indices
+ *  @return number of indices written: min(k, size)
+ */
+std::size_t topK(const float* data, std::size_t size, std::size_t k, uint64_t* indices);
+
+/**
+ *  @brief dst[i] = src[i] clamped to [0, 255], e.g. the int64 label map of a model exporting its argmax to one byte
+ *  per pixel
+ */
+void narrowLabels(const int64_t* src, std::size_t count, uint8_t* dst);
+
+/**
+ *  @brief dst[i] = (dst[i] * frameWeight + colorTerms[i]) >> 8, the fixed point blend of bytes with a color
+ *
+ *  weights are in 1/256 units, see blendFrameWeight() and blendColorTerm()
+ */
+void blendRow(const uint16_t* colorTerms, uint16_t frameWeight, std::size_t count, uint8_t* dst);
+
+/**
+ *  @brief frameWeight of blendRow() for a color of opacity alpha, clamped to [0, 1]
+ */
+uint16_t blendFrameWeight(float alpha);
+
+/**
+ *  @brief colorTerms[i] of blendRow() for the color channel value color: color weighted by the complement of
+ *  frameWeight, plus the rounding
+ */
+uint16_t blendColorTerm(uint8_t color, uint16_t frameWeight);
+
+/**
+ *  @brief accuracy of the polynomial approximating exp in the functions below
+ *
+ *  all of them use the same range reduction, only the degree of the polynomial changes; inputs below -104 give 0,
+ *  and NaN stays NaN
+ */
+enum class ExpAccuracy {
+    // degree 3, relative error below 1e-4: for scores only compared against thresholds
+    LOW,
+    // degree 5, within 4 ulp of exp
+    MEDIUM,
+    // degree 7, within 1 ulp of exp
+    HIGH
+};
+
+/**
+ *  @brief numRows rows of rowSize elements: element j of row i is at data[i * rowStride + j * elementStride]
+ *
+ *  rows are vectorized along their elements when elementStride is 1, and side by side, one row per simd lane, when
+ *  rowStride is 1 (e.g. the channels of each pixel of a CHW tensor); other layouts are gathered row by row
+ */
+struct StridedRows {
+    std::size_t numRows;
+    std::size_t rowSize;
+    std::size_t rowStride;
+    std::size_t elementStride = 1;
+};
+
+/**
+ *  @brief sum of exp(data[i] - offset), the softmax denominator when offset is the maximum of data
+ */
+float sumExp(const float* data, std::size_t size, float offset);
+
+/**
+ *  @brief dst[i] = exp(src[i]), src and dst may be the same array
+ */
+void vectorExp(const float* src, float* dst, std::size_t size, ExpAccuracy accuracy = ExpAccuracy::HIGH);
+
+/**
+ *  @brief softmax of each row, dst has the layout of src and may be src
+ */
+void softmax(const float* src, float* dst, const StridedRows& rows, ExpAccuracy accuracy = ExpAccuracy::HIGH);
+
+/**
+ *  @brief sigmoid of each element, dst has the layout of src and may be src
+ */
+void sigmoid(const float* src, float* dst, const StridedRows& rows, ExpAccuracy accuracy = ExpAccuracy::HIGH);
+
+/**
+ *  @brief dst[i] = log(sum_j exp(row i element j)), one value per row
+ */
+void logSumExp(const float* src, float* dst, const StridedRows& rows, ExpAccuracy accuracy = ExpAccuracy::HIGH);
+
+/**
+ *  @brief per pixel argmax over the channel planes of a CHW tensor, e.g. the logits of a segmentation model
+ *
+ *  labels[i] = argmax_c data[i + c * planeStride] for i < count, the first channel winning ties. Every plane is
+ *  streamed with vector compares, the running maximum and its channel staying in registers.
+ *
+ *  @param numChannels at most 256
+ *  @param maxProbs when given, the softmax probability of the label of each pixel
+ */
+void argmaxChannels(const float* data, std::size_t numChannels, std::size_t planeStride, std::size_t count,
+                    uint8_t* labels, float* maxProbs = nullptr, ExpAccuracy accuracy = ExpAccuracy::MEDIUM);
+}  // namespace Ort
@@ -0,0 +1,291 @@
+/**
+ * @file    YoloDecoder.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "DetectionBatch.hpp"
+#include "OrtSessionHandler.hpp"
+#include "VectorMath.hpp"
+
+namespace Ort
+{
+enum class YoloHead {
+    // box sizes are exp(tw) times the anchor size of the prediction
+    ANCHOR_BASED,
+    // box sizes are exp(tw) times the stride of the prediction
+    ANCHOR_FREE
+};
+
+// memory layout of the head outputs, each prediction being [tx, ty, tw, th, objectness, class scores...]
+enum class YoloLayout {
+    // one output per level: batchSize x (anchorsPerLevel * (5 + numClasses)) x gridHeight x gridWidth
+    PLANAR,
+    // one output for all levels: batchSize x numPredictions x (5 + numClasses), predictions ordered by level, anchor,
+    // grid row then grid column
+    INTERLEAVED
+};
+
+enum class YoloActivation {
+    // the model exports activated values
+    IDENTITY,
+    SIGMOID,
+    // across the class scores of a prediction only
+    SOFTMAX
+};
+
+/**
+ *  @brief decoder of yolo heads whose layout is fixed at compile time by Config
+ *
+ *  Config provides as static constexpr members:
+ *      HEAD, LAYOUT: YoloHead, YoloLayout
+ *      NUM_CLASSES: std::size_t, 0 when only known at runtime
+ *      STRIDES: std::array<int64_t, numLevels>, downsampling ratio of each level
+ *      ANCHORS: std::array<std::array<float, 2>, numLevels * anchorsPerLevel>, [width, height] in input pixels,
+ *               grouped by level; empty for anchor free heads
+ *      XY_ACTIVATION, OBJECTNESS_ACTIVATION, CLASS_ACTIVATION: YoloActivation
+ *
+ *  predictions are first compacted on objectness with findAboveThreshold, the class probability being at most 1;
+ *  only the survivors are scored and decoded, with loops over classes of a compile-time trip count.
+ *  Decoded boxes are in network input pixels.
+ */
+template <typename Config> class YoloDecoder
+{
+ public:
+    static constexpr std::size_t NUM_LEVELS = Config::STRIDES.size();
+
+    static constexpr std::size_t ANCHORS_PER_LEVEL =
+        Config::HEAD == YoloHead::ANCHOR_BASED ? Config::ANCHORS.size() / NUM_LEVELS : 1;
+
+    static_assert(NUM_LEVELS > 0, "yolo heads have at least one level");
+    static_assert(Config::HEAD == YoloHead::ANCHOR_FREE || Config::ANCHORS.size() == NUM_LEVELS * ANCHORS_PER_LEVEL,
+                  "every level needs the same number of anchors");
+    static_assert(Config::HEAD == YoloHead::ANCHOR_BASED || Config::ANCHORS.size() == 0,
+                  "anchor free heads have no anchors");
+    static_assert(Config::XY_ACTIVATION != YoloActivation::SOFTMAX &&
+                      Config::OBJECTNESS_ACTIVATION != YoloActivation::SOFTMAX,
+                  "softmax only applies to class scores");
+
+    /**
+     *  @param numClasses must match Config::NUM_CLASSES when that is not 0
+     */
+    explicit YoloDecoder(const std::size_t numClasses = Config::NUM_CLASSES)
+        : m_numClasses(Config::NUM_CLASSES != 0 ? Config::NUM_CLASSES : numClasses)
+    {
+        if (m_numClasses == 0) {
+            throw std::runtime_error("yolo decoder needs at least one class");
+        }
+        if (numClasses != m_numClasses) {
+            throw std::runtime_error("number of classes does not match the yolo head config");
+        }
+    }
+
+    std::size_t numClasses() const
+    {
+        return m_numClasses;
+    }
+
+    /**
+     *  @brief grid sizes of the interleaved layout, planar outputs take them from their shapes
+     */
+    void setInputSize(const int64_t width, const int64_t height)
+    {
+        m_levelOffsets[0] = 0;
+        for (std::size_t level = 0; level < NUM_LEVELS; ++level) {
+            m_gridWidths[level] = width / Config::STRIDES[level];
+            const int64_t numCells = m_gridWidths[level] * (height / Config::STRIDES[level]);
+            m_levelOffsets[level + 1] = m_levelOffsets[level] + ANCHORS_PER_LEVEL * numCells;
+        }
+    }
+
+    /**
+     *  @brief push the predictions of image imageIdx of the batch whose confidence, objectness times class
+     *  probability, exceeds confThresh
+     */
+    void decode(const std::vector<OrtSessionHandler::DataOutputType>& inferenceOutput,  //
+                const std::size_t imageIdx,                                             //
+                const float confThresh,                                                 //
+                DetectionBatch* detections) const
+    {
+        const float objectnessThresh = YoloDecoder::objectnessThreshold(confThresh);
+        if constexpr (Config::LAYOUT == YoloLayout::PLANAR) {
+            this->decodePlanar(inferenceOutput, imageIdx, confThresh, objectnessThresh, detections);
+        } else {
+            this->decodeInterleaved(inferenceOutput, imageIdx, confThresh, objectnessThresh, detections);
+        }
+    }
+
+ private:
+    template <YoloActivation ACTIVATION> static float activate(const float x)
+    {
+        return ACTIVATION == YoloActivation::SIGMOID ? 1.f / (1.f + std::exp(-x)) : x;
+    }
+
+    // a prediction passes when its activated objectness is greater than confThresh: compare the raw values instead
+    static float objectnessThreshold(const float confThresh)
+    {
+        if constexpr (Config::OBJECTNESS_ACTIVATION != YoloActivation::SIGMOID) {
+            return confThresh;
+        }
+        return confThresh <= 0 ? -std::numeric_limits<float>::infinity()
+               : confThresh >= 1 ? std::numeric_limits<float>::infinity()
+                                 : std::log(confThresh / (1 - confThresh));
+    }
+
+    void decodePlanar(const std::vector<OrtSessionHandler::DataOutputType>& inferenceOutput,  //
+                      const std::size_t imageIdx,                                             //
+                      const float confThresh,                                                 //
+                      const float objectnessThresh,                                           //
+                      DetectionBatch* detections) const
+    {
+        if (inferenceOutput.size() < NUM_LEVELS) {
+            throw std::runtime_error("planar yolo heads need one output per level");
+        }
+
+        const std::size_t numChannels = 5 + m_numClasses;
+        for (std::size_t level = 0; level < NUM_LEVELS; ++level) {
+            const auto& outputShape = inferenceOutput[level].second;
+            if (outputShape.size() != 4 || outputShape[1] != static_cast<int64_t>(ANCHORS_PER_LEVEL * numChannels) ||
+                static_cast<int64_t>(imageIdx) >= outputShape[0]) {
+                throw std::runtime_error("unexpected output shape");
+            }
+
+            const int64_t gridWidth = outputShape[3];
+            const std::size_t numCells = outputShape[2] * gridWidth;
+            const float* outputData = inferenceOutput[level].first + imageIdx * outputShape[1] * numCells;
+            m_indices.resize(numCells);
+
+            for (std::size_t anchorIdx = 0; anchorIdx < ANCHORS_PER_LEVEL; ++anchorIdx) {
+                // channel c of the anchor is the plane starting at anchorData + c * numCells
+                const float* anchorData = outputData + anchorIdx * numChannels * numCells;
+                const std::size_t numFound = Ort::findAboveThreshold(anchorData + 4 * numCells, numCells, 1,
+                                                                     objectnessThresh, m_indices.data());
+                for (std::size_t i = 0; i < numFound; ++i) {
+                    const uint64_t cell = m_indices[i];
+                    this->decodePrediction(anchorData + cell, numCells, level, anchorIdx, cell % gridWidth,
+                                           cell / gridWidth, confThresh, detections);
+                }
+            }
+        }
+    }
+
+    void decodeInterleaved(const std::vector<OrtSessionHandler::DataOutputType>& inferenceOutput,  //
+                           const std::size_t imageIdx,                                             //
+                           const float confThresh,                                                 //
+                           const float objectnessThresh,                                           //
+                           DetectionBatch* detections) const
+    {
+        const std::size_t numChannels = 5 + m_numClasses;
+        const std::size_t numPredictions = m_levelOffsets[NUM_LEVELS];
+        const auto& outputShape = inferenceOutput.front().second;
+        if (outputShape.size() != 3 || outputShape[1] != static_cast<int64_t>(numPredictions) ||
+            outputShape[2] != static_cast<int64_t>(numChannels) || static_cast<int64_t>(imageIdx) >= outputShape[0]) {
+            throw std::runtime_error("output shape does not match the input size");
+        }
+
+        const float* outputData = inferenceOutput.front().first + imageIdx * numPredictions * numChannels;
+        m_indices.resize(numPredictions);
+        const std::size_t numFound =
+            Ort::findAboveThreshold(outputData + 4, numPredictions, numChannels, objectnessThresh, m_indices.data());
+
+        std::size_t level = 0;
+        for (std::size_t i = 0; i < numFound; ++i) {
+            // indices are increasing: levels are visited in order
+            const uint64_t predictionIdx = m_indices[i];
+            while (predictionIdx >= m_levelOffsets[level + 1]) {
+                ++level;
+            }
+
+            const std::size_t numCells = (m_levelOffsets[level + 1] - m_levelOffsets[level]) / ANCHORS_PER_LEVEL;
+            const std::size_t localIdx = predictionIdx - m_levelOffsets[level];
+            const std::size_t cell = localIdx % numCells;
+            this->decodePrediction(outputData + predictionIdx * numChannels, 1, level, localIdx / numCells,
+                                   cell % m_gridWidths[level], cell / m_gridWidths[level], confThresh, detections);
+        }
+    }
+
+    /**
+     *  @param prediction channel c of the prediction is at prediction[c * channelStride]
+     */
+    void decodePrediction(const float* prediction, const std::size_t channelStride,  //
+                          const std::size_t level, const std::size_t anchorIdx,      //
+                          const int64_t col, const int64_t row,                      //
+                          const float confThresh, DetectionBatch* detections) const
+    {
+        // constant folded when the class count is known at compile time
+        const std::size_t numClasses = Config::NUM_CLASSES != 0 ? Config::NUM_CLASSES : m_numClasses;
+        const float* classScores = prediction + 5 * channelStride;
+
+        std::size_t classIdx = 0;
+        if (channelStride == 1) {
+            classIdx = Ort::argmax(classScores, numClasses);
+        } else {
+            for (std::size_t k = 1; k < numClasses; ++k) {
+                if (classScores[k * channelStride] > classScores[classIdx * channelStride]) {
+                    classIdx = k;
+                }
+            }
+        }
+
+        const float maxScore = classScores[classIdx * channelStride];
+        float classProb = maxScore;
+        if constexpr (Config::CLASS_ACTIVATION == YoloActivation::SOFTMAX) {
+            // only the maximum of the class softmax is needed: 1 / sum(exp(score - maxScore))
+            float sum = 0;
+            if (channelStride == 1) {
+                sum = Ort::sumExp(classScores, numClasses, maxScore);
+            } else {
+                for (std::size_t k = 0; k < numClasses; ++k) {
+                    sum += std::exp(classScores[k * channelStride] - maxScore);
+                }
+            }
+            classProb = 1 / sum;
+        } else if constexpr (Config::CLASS_ACTIVATION == YoloActivation::SIGMOID) {
+            classProb = activate<YoloActivation::SIGMOID>(maxScore);
+        }
+
+        const float confidence = activate<Config::OBJECTNESS_ACTIVATION>(prediction[4 * channelStride]) * classProb;
+        if (!(confidence > confThresh)) {
+            return;
+        }
+
+        const float stride = Config::STRIDES[level];
+        float anchorWidth = stride;
+        float anchorHeight = stride;
+        if constexpr (Config::HEAD == YoloHead::ANCHOR_BASED) {
+            const auto& anchor = Config::ANCHORS[level * ANCHORS_PER_LEVEL + anchorIdx];
+            anchorWidth = anchor[0];
+            anchorHeight = anchor[1];
+        }
+
+        const float xcenter = (activate<Config::XY_ACTIVATION>(prediction[0]) + col) * stride;
+        const float ycenter = (activate<Config::XY_ACTIVATION>(prediction[channelStride]) + row) * stride;
+        const float width = std::exp(prediction[2 * channelStride]) * anchorWidth;
+        const float height = std::exp(prediction[3 * channelStride]) * anchorHeight;
+
+        detections->push(xcenter - width / 2, ycenter - height / 2, xcenter + width / 2, ycenter + height / 2,
+                         confidence, classIdx);
+    }
+
+ private:
+    std::size_t m_numClasses;
+
+    // predictions of level l are [m_levelOffsets[l], m_levelOffsets[l + 1]) of the interleaved output
+    std::array<std::size_t, NUM_LEVELS + 1> m_levelOffsets{};
+    std::array<int64_t, NUM_LEVELS> m_gridWidths{};
+
+    // predictions passing the objectness threshold
+    mutable std::vector<uint64_t> m_indices;
+};
+}  // namespace Ort
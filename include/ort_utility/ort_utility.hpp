@@ -7,14 +7,46 @@
 
 #pragma once
 
+#include "CellHeatmap.hpp"
+
 #include "Constants.hpp"
 
+#include "DetectionBatch.hpp"
+
+#include "Float16.hpp"
+
+#include "FrameDifferenceGate.hpp"
+
 #include "ImageClassificationOrtSessionHandler.hpp"
 
+#include "ImageIngest.hpp"
+
 #include "ImageRecognitionOrtSessionHandlerBase.hpp"
 
+#include "KeyframeSegmentation.hpp"
+
+#include "MaskPaste.hpp"
+
 #include "OrtSessionHandler.hpp"
 
+#include "Preprocess.hpp"
+
+#include "Nms.hpp"
+
 #include "ObjectDetectionOrtSessionHandler.hpp"
 
+#include "Renderer.hpp"
+
+#include "Rle.hpp"
+
+#include "SemanticSegmentationOrtSessionHandler.hpp"
+
+#include "TensorBuffer.hpp"
+
+#include "TiledSegmentation.hpp"
+
 #include "Utility.hpp"
+
+#include "VectorMath.hpp"
+
+#include "YoloDecoder.hpp"
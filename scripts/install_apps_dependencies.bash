@@ -2,4 +2,4 @@
 
 sudo -l
 
-sudo apt-get install -y --no-install-recommends libopencv-dev
+sudo apt-get install -y --no-install-recommends libopencv-dev libjpeg-turbo8-dev
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+import argparse
+
+import onnx
+from onnx import TensorProto, helper
+
+_CUSTOM_OP_DOMAIN = "ort_utility"
+_CUSTOM_OP_NAME = "ImagePreprocess"
+
+
+def get_args():
+    parser = argparse.ArgumentParser(
+        "prepend ort_utility's ImagePreprocess custom op so that the model takes uint8 [N, H, W, C] frames"
+    )
+    parser.add_argument("--model", type=str, required=True)
+    parser.add_argument("--output", type=str, required=True)
+    parser.add_argument("--input_index", type=int, default=0, help="index of the image input to replace")
+    parser.add_argument("--input_name", type=str, default="frame")
+    parser.add_argument("--scale", type=float, default=1.0 / 255)
+    parser.add_argument("--mean", type=float, nargs="*", default=[])
+    parser.add_argument("--std", type=float, nargs="*", default=[])
+    parser.add_argument("--swap_rb", action="store_true", help="for models trained on RGB inputs")
+
+    return parser.parse_args()
+
+
+def main():
+    args = get_args()
+    assert len(args.mean) == len(args.std)
+
+    model = onnx.load(args.model)
+    graph = model.graph
+
+    initializer_names = {initializer.name for initializer in graph.initializer}
+    image_inputs = [graph_input for graph_input in graph.input if graph_input.name not in initializer_names]
+    old_input = image_inputs[args.input_index]
+
+    # [N, C, H, W]
+    dims = [dim.dim_value if dim.HasField("dim_value") else 0 for dim in old_input.type.tensor_type.shape.dim]
+    assert len(dims) == 4 and dims[1] > 0, "the image input must be of shape [N, C, H, W] with static channels"
+    num_channels, height, width = dims[1:]
+    assert not args.mean or len(args.mean) == num_channels
+
+    new_input = helper.make_tensor_value_info(
+        args.input_name, TensorProto.UINT8, ["batch_size", "frame_height", "frame_width", num_channels]
+    )
+    attributes = {"height": height, "width": width, "scale": args.scale, "swap_rb": int(args.swap_rb)}
+    # onnx cannot infer the type of an empty list attribute: no mean and std attributes means no normalization
+    if args.mean:
+        attributes["mean"] = args.mean
+        attributes["std"] = args.std
+    preprocess_node = helper.make_node(
+        _CUSTOM_OP_NAME,
+        inputs=[args.input_name],
+        outputs=[old_input.name],
+        domain=_CUSTOM_OP_DOMAIN,
+        **attributes,
+    )
+
+    graph.node.insert(0, preprocess_node)
+    input_position = list(graph.input).index(old_input)
+    graph.input.remove(old_input)
+    graph.input.insert(input_position, new_input)
+    model.opset_import.append(helper.make_opsetid(_CUSTOM_OP_DOMAIN, 1))
+
+    onnx.save(model, args.output)
+    print(f"\nonnx model is saved to: {args.output}")
+
+
+if __name__ == "__main__":
+    main()
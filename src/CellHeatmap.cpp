@@ -0,0 +1,98 @@
+/**
+ * @file    CellHeatmap.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+// the bounds are loosened by this much against the rounding of log and of log-sum-exp: pixels near the threshold are
+// settled by their exact score
+constexpr float BOUND_MARGIN = 1e-3f;
+}  // namespace
+
+namespace Ort
+{
+const std::vector<HeatmapPoint>& CellHeatmapDecoder::decode(const float* logits, const std::size_t cellSize,
+                                                            const std::size_t heightInCells,
+                                                            const std::size_t widthInCells, const float thresh,
+                                                            const std::size_t border)
+{
+    if (cellSize == 0 || cellSize > 32) {
+        throw std::runtime_error("cell size must be in [1, 32]");
+    }
+
+    m_points.clear();
+    const std::size_t width = widthInCells * cellSize;
+    const std::size_t height = heightInCells * cellSize;
+    if (2 * border >= width || 2 * border >= height) {
+        return m_points;
+    }
+
+    // only the cells with pixels inside the border
+    const std::size_t cxBegin = border / cellSize;
+    const std::size_t cxEnd = (width - border + cellSize - 1) / cellSize;
+    const std::size_t cyBegin = border / cellSize;
+    const std::size_t cyEnd = (height - border + cellSize - 1) / cellSize;
+    const std::size_t numCellsX = cxEnd - cxBegin;
+
+    const std::size_t numPointLogits = cellSize * cellSize;
+    const std::size_t planeSize = heightInCells * widthInCells;
+    const float logThresh = thresh > 0 ? std::log(thresh) - BOUND_MARGIN : -std::numeric_limits<float>::infinity();
+
+    m_logSumExps.resize(numCellsX);
+    m_bounds.resize(numCellsX);
+    m_pixelMasks.resize(numCellsX);
+    for (std::size_t cy = cyBegin; cy < cyEnd; ++cy) {
+        const float* rowLogits = logits + cy * widthInCells + cxBegin;
+
+        // one softmax row per cell, the cells of the row side by side
+        Ort::logSumExp(rowLogits, m_logSumExps.data(), Ort::StridedRows{numCellsX, numPointLogits + 1, 1, planeSize});
+        for (std::size_t cx = 0; cx < numCellsX; ++cx) {
+            m_bounds[cx] = m_logSumExps[cx] + logThresh;
+        }
+
+        // pixel rows of the cells, so that points come in row major order
+        for (std::size_t r = 0; r < cellSize; ++r) {
+            const std::size_t y = cy * cellSize + r;
+            if (y < border || y >= height - border) {
+                continue;
+            }
+
+            // bit c of the mask of a cell is set when pixel (r, c) of the cell may score above thresh: whole rows of
+            // the channel planes are compared at once
+            std::fill(m_pixelMasks.begin(), m_pixelMasks.end(), 0);
+            for (std::size_t c = 0; c < cellSize; ++c) {
+                const float* planeRow = rowLogits + (r * cellSize + c) * planeSize;
+                for (std::size_t cx = 0; cx < numCellsX; ++cx) {
+                    m_pixelMasks[cx] |= static_cast<uint32_t>(planeRow[cx] > m_bounds[cx]) << c;
+                }
+            }
+
+            for (std::size_t cx = 0; cx < numCellsX; ++cx) {
+                for (uint32_t mask = m_pixelMasks[cx]; mask; mask &= mask - 1) {
+                    const std::size_t c = __builtin_ctz(mask);
+                    const std::size_t x = (cxBegin + cx) * cellSize + c;
+                    if (x < border || x >= width - border) {
+                        continue;
+                    }
+                    const float score = std::exp(rowLogits[(r * cellSize + c) * planeSize + cx] - m_logSumExps[cx]);
+                    if (score > thresh) {
+                        m_points.emplace_back(HeatmapPoint{static_cast<int64_t>(x), static_cast<int64_t>(y), score});
+                    }
+                }
+            }
+        }
+    }
+
+    return m_points;
+}
+}  // namespace Ort
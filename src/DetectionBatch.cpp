@@ -0,0 +1,137 @@
+/**
+ * @file    DetectionBatch.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace Ort
+{
+void DetectionBatch::clear()
+{
+    for (auto* buffer : {&m_xmins, &m_ymins, &m_xmaxs, &m_ymaxs, &m_scores}) {
+        buffer->clear();
+    }
+    m_classIndices.clear();
+    m_imageOffsets.assign(1, 0);
+}
+
+void DetectionBatch::nms(const NmsParams& params)
+{
+    if (params.algorithm == NmsAlgorithm::NONE && params.topK >= this->size()) {
+        return;
+    }
+
+    std::size_t out = 0;
+    for (std::size_t imageIdx = 0; imageIdx < this->numImages(); ++imageIdx) {
+        // detections before out are already compacted, the ones of this image have not moved yet
+        const std::size_t begin = m_imageOffsets[imageIdx];
+        const std::size_t numBoxes = m_imageOffsets[imageIdx + 1] - begin;
+        m_imageOffsets[imageIdx] = out;
+
+        const float* xmins = m_xmins.data() + begin;
+        const float* ymins = m_ymins.data() + begin;
+        const float* xmaxs = m_xmaxs.data() + begin;
+        const float* ymaxs = m_ymaxs.data() + begin;
+        const float* scores = m_scores.data() + begin;
+        const uint64_t* classIndices = m_classIndices.data() + begin;
+
+        if (params.algorithm == NmsAlgorithm::NONE) {
+            m_topIndices.resize(std::min<uint64_t>(params.topK, numBoxes));
+            Ort::topK(scores, numBoxes, params.topK, m_topIndices.data());
+            out = this->compactImage(begin, out, m_topIndices, nullptr);
+            continue;
+        }
+
+        if (params.algorithm == NmsAlgorithm::GREEDY) {
+            const auto& kept =
+                params.classAware
+                    ? m_multiClassNmsEngine
+                          .run(xmins, ymins, xmaxs, ymaxs, scores, classIndices, numBoxes, params.overlapThresh,
+                               std::numeric_limits<uint64_t>::max(), params.topK)
+                          .indices
+                    : m_nmsEngine.run(xmins, ymins, xmaxs, ymaxs, scores, numBoxes, params.overlapThresh, params.topK);
+            out = this->compactImage(begin, out, kept, nullptr);
+            continue;
+        }
+
+        if (params.classAware && numBoxes > 0) {
+            // shift every class to its own region, past all the boxes of the previous classes; boxes are not clipped
+            // before nms, so the regions start at the smallest coordinate, not at 0
+            const float* corners[4] = {xmins, ymins, xmaxs, ymaxs};
+            float minCoordinate = std::numeric_limits<float>::max();
+            float maxCoordinate = std::numeric_limits<float>::lowest();
+            for (const float* corner : corners) {
+                const auto [minIt, maxIt] = std::minmax_element(corner, corner + numBoxes);
+                minCoordinate = std::min(minCoordinate, *minIt);
+                maxCoordinate = std::max(maxCoordinate, *maxIt);
+            }
+            const float classOffset = maxCoordinate - minCoordinate + 1;
+            for (std::size_t c = 0; c < 4; ++c) {
+                m_shiftedBoxes[c].resize(numBoxes);
+                for (std::size_t i = 0; i < numBoxes; ++i) {
+                    m_shiftedBoxes[c][i] = corners[c][i] - minCoordinate + classIndices[i] * classOffset;
+                }
+            }
+            xmins = m_shiftedBoxes[0].data();
+            ymins = m_shiftedBoxes[1].data();
+            xmaxs = m_shiftedBoxes[2].data();
+            ymaxs = m_shiftedBoxes[3].data();
+        }
+
+        const NmsResult& result = params.algorithm == NmsAlgorithm::SOFT
+                                      ? m_softNmsEngine.run(xmins, ymins, xmaxs, ymaxs, scores, numBoxes, params)
+                                      : m_matrixNmsEngine.run(xmins, ymins, xmaxs, ymaxs, scores, numBoxes, params);
+        out = this->compactImage(begin, out, result.indices, result.scores.data());
+    }
+
+    m_imageOffsets.back() = out;
+    for (auto* buffer : {&m_xmins, &m_ymins, &m_xmaxs, &m_ymaxs, &m_scores}) {
+        buffer->resize(out);
+    }
+    m_classIndices.resize(out);
+}
+
+std::size_t DetectionBatch::compactImage(std::size_t begin, std::size_t out, const std::vector<uint64_t>& kept,
+                                         const float* keptScores)
+{
+    if (keptScores) {
+        for (std::size_t k = 0; k < kept.size(); ++k) {
+            m_scores[begin + kept[k]] = keptScores[k];
+        }
+    }
+
+    // in increasing order, every kept detection moves backward, never over one still to be read
+    m_keepIndices.assign(kept.begin(), kept.end());
+    std::sort(m_keepIndices.begin(), m_keepIndices.end());
+    for (const uint64_t idx : m_keepIndices) {
+        const std::size_t src = begin + idx;
+        m_xmins[out] = m_xmins[src];
+        m_ymins[out] = m_ymins[src];
+        m_xmaxs[out] = m_xmaxs[src];
+        m_ymaxs[out] = m_ymaxs[src];
+        m_scores[out] = m_scores[src];
+        m_classIndices[out] = m_classIndices[src];
+        ++out;
+    }
+
+    return out;
+}
+
+void DetectionBatch::rescale(std::size_t imageIdx, float scaleX, float scaleY, float imageWidth, float imageHeight)
+{
+    const float maxX = imageWidth - 1;
+    const float maxY = imageHeight - 1;
+    for (std::size_t i = this->imageBegin(imageIdx); i < this->imageEnd(imageIdx); ++i) {
+        m_xmins[i] = std::clamp(m_xmins[i] * scaleX, 0.f, maxX);
+        m_ymins[i] = std::clamp(m_ymins[i] * scaleY, 0.f, maxY);
+        m_xmaxs[i] = std::clamp(m_xmaxs[i] * scaleX, 0.f, maxX);
+        m_ymaxs[i] = std::clamp(m_ymaxs[i] * scaleY, 0.f, maxY);
+    }
+}
+}  // namespace Ort
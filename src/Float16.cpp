@@ -0,0 +1,202 @@
+/**
+ * @file    Float16.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsToFloat(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Ref: https://gist.github.com/rygorous/2156668
+uint16_t floatToHalfBits(const float value)
+{
+    // 2^16, first value that does not fit into a half after rounding
+    static constexpr uint32_t HALF_OVERFLOW = (127 + 16) << 23;
+    // 2^-14, smallest normal half
+    static constexpr uint32_t HALF_MIN_NORMAL = (127 - 14) << 23;
+    static constexpr uint32_t DENORMAL_MAGIC = ((127 - 15) + (23 - 10) + 1) << 23;
+
+    uint32_t bits = floatBits(value);
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7FFFFFFF;
+
+    if (bits >= HALF_OVERFLOW) {
+        // infinity stays infinity, nan stays a quiet nan
+        return sign | (bits > 0x7F800000 ? 0x7E00 : 0x7C00);
+    }
+
+    if (bits < HALF_MIN_NORMAL) {
+        // let the fpu do the rounding of subnormals
+        const float rounded = bitsToFloat(bits) + bitsToFloat(DENORMAL_MAGIC);
+        return sign | static_cast<uint16_t>(floatBits(rounded) - DENORMAL_MAGIC);
+    }
+
+    const uint32_t mantissaOdd = (bits >> 13) & 1;
+    // rebias the exponent and round to nearest even
+    bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + mantissaOdd;
+    return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+float halfBitsToFloat(const uint16_t half)
+{
+    static constexpr uint32_t SHIFTED_EXPONENT = 0x7C00 << 13;
+    static constexpr uint32_t DENORMAL_MAGIC = 113 << 23;
+
+    uint32_t bits = (half & 0x7FFF) << 13;
+    const uint32_t exponent = bits & SHIFTED_EXPONENT;
+    bits += (127 - 15) << 23;
+
+    if (exponent == SHIFTED_EXPONENT) {
+        // infinity or nan
+        bits += (128 - 16) << 23;
+    } else if (exponent == 0) {
+        // zero or subnormal, renormalized by the fpu
+        bits = floatBits(bitsToFloat(bits + (1 << 23)) - bitsToFloat(DENORMAL_MAGIC));
+    }
+
+    return bitsToFloat(bits | static_cast<uint32_t>(half & 0x8000) << 16);
+}
+
+void convertFloat16ToFloatScalar(const Ort::Float16* src, float* dst, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i] = halfBitsToFloat(src[i].value);
+    }
+}
+
+void convertFloatToFloat16Scalar(const float* src, Ort::Float16* dst, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i].value = floatToHalfBits(src[i]);
+    }
+}
+
+#if ORT_UTILITY_X86
+__attribute__((target("avx,f16c"))) void convertFloat16ToFloatF16C(const Ort::Float16* src, float* dst,
+                                                                     std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(half));
+    }
+    convertFloat16ToFloatScalar(src + i, dst + i, count - i);
+}
+
+__attribute__((target("avx,f16c"))) void convertFloatToFloat16F16C(const float* src, Ort::Float16* dst,
+                                                                     std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), half);
+    }
+    convertFloatToFloat16Scalar(src + i, dst + i, count - i);
+}
+
+__attribute__((target("avx512f"))) void convertFloat16ToFloatAvx512(const Ort::Float16* src, float* dst,
+                                                                      std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i half = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        // the zero-masked forms avoid gcc 12's spurious maybe-uninitialized warning in the unmasked intrinsics
+        _mm512_storeu_ps(dst + i, _mm512_maskz_cvtph_ps(0xFFFF, half));
+    }
+    convertFloat16ToFloatScalar(src + i, dst + i, count - i);
+}
+
+__attribute__((target("avx512f"))) void convertFloatToFloat16Avx512(const float* src, Ort::Float16* dst,
+                                                                      std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i half =
+            _mm512_maskz_cvtps_ph(0xFFFF, _mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), half);
+    }
+    convertFloatToFloat16Scalar(src + i, dst + i, count - i);
+}
+#endif
+
+using Float16ToFloatFunc = void (*)(const Ort::Float16*, float*, std::size_t);
+using FloatToFloat16Func = void (*)(const float*, Ort::Float16*, std::size_t);
+
+Float16ToFloatFunc selectFloat16ToFloat()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return convertFloat16ToFloatAvx512;
+    }
+    if (__builtin_cpu_supports("f16c")) {
+        return convertFloat16ToFloatF16C;
+    }
+#endif
+    return convertFloat16ToFloatScalar;
+}
+
+FloatToFloat16Func selectFloatToFloat16()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return convertFloatToFloat16Avx512;
+    }
+    if (__builtin_cpu_supports("f16c")) {
+        return convertFloatToFloat16F16C;
+    }
+#endif
+    return convertFloatToFloat16Scalar;
+}
+}  // namespace
+
+namespace Ort
+{
+float toFloat(const Float16 half)
+{
+    return ::halfBitsToFloat(half.value);
+}
+
+Float16 toFloat16(const float value)
+{
+    return Float16{::floatToHalfBits(value)};
+}
+
+void convertFloat16ToFloat(const Float16* src, float* dst, std::size_t count)
+{
+    static const ::Float16ToFloatFunc convert = ::selectFloat16ToFloat();
+    convert(src, dst, count);
+}
+
+void convertFloatToFloat16(const float* src, Float16* dst, std::size_t count)
+{
+    static const ::FloatToFloat16Func convert = ::selectFloatToFloat16();
+    convert(src, dst, count);
+}
+}  // namespace Ort
@@ -0,0 +1,165 @@
+/**
+ * @file    FrameDifferenceGate.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+/**
+ *  @brief sums[b] += sum of the bytes of row[b * blockBytes, (b + 1) * blockBytes), for b < numBlocks
+ */
+using AddBlockSumsFunc = void (*)(const uint8_t* row, std::size_t blockBytes, std::size_t numBlocks,
+                                  uint64_t* sums);
+
+void addBlockSumsScalar(const uint8_t* row, const std::size_t blockBytes, const std::size_t numBlocks,
+                        uint64_t* sums)
+{
+    for (std::size_t b = 0; b < numBlocks; ++b) {
+        const uint8_t* block = row + b * blockBytes;
+        uint64_t sum = 0;
+        for (std::size_t i = 0; i < blockBytes; ++i) {
+            sum += block[i];
+        }
+        sums[b] += sum;
+    }
+}
+
+#if ORT_UTILITY_X86
+// sad against 0 adds 8 bytes into each 64 bit lane: blocks of whole 16 byte chunks need no scalar tail
+__attribute__((target("avx2"))) void addBlockSumsAvx2(const uint8_t* row, const std::size_t blockBytes,
+                                                      const std::size_t numBlocks, uint64_t* sums)
+{
+    if (blockBytes % 16 != 0) {
+        ::addBlockSumsScalar(row, blockBytes, numBlocks, sums);
+        return;
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum;
+    for (std::size_t b = 0; b < numBlocks; ++b) {
+        const uint8_t* block = row + b * blockBytes;
+        __m256i acc = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 32 <= blockBytes; i += 32) {
+            acc = _mm256_add_epi64(
+                acc, _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i)), zero));
+        }
+        __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        if (i < blockBytes) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            halves = _mm_add_epi64(halves, _mm_sad_epu8(bytes, _mm256_castsi256_si128(zero)));
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&sum), _mm_add_epi64(halves, _mm_unpackhi_epi64(halves, halves)));
+        sums[b] += sum;
+    }
+}
+#endif
+
+AddBlockSumsFunc selectAddBlockSums()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return addBlockSumsAvx2;
+    }
+#endif
+    return addBlockSumsScalar;
+}
+}  // namespace
+
+namespace Ort
+{
+FrameDifferenceGate::FrameDifferenceGate(const FrameGateParams& params)
+    : m_params(params)
+{
+    if (params.blockSize == 0) {
+        throw std::runtime_error("block size must be more than 0");
+    }
+}
+
+bool FrameDifferenceGate::needsInference(const uint8_t* frame, const int64_t width, const int64_t height,
+                                         const int numChannels, const std::size_t stride)
+{
+    if (width <= 0 || height <= 0 || numChannels <= 0) {
+        throw std::runtime_error("empty frame");
+    }
+
+    const std::size_t blockSize = m_params.blockSize;
+    const std::size_t numBlocksX = (width + blockSize - 1) / blockSize;
+    const std::size_t numBlocksY = (height + blockSize - 1) / blockSize;
+    const std::size_t numFullBlocksX = width / blockSize;
+    const std::size_t blockBytes = blockSize * numChannels;
+    const std::size_t lastBlockBytes = (width - numFullBlocksX * blockSize) * numChannels;
+
+    static const AddBlockSumsFunc addBlockSums = ::selectAddBlockSums();
+    m_means.resize(numBlocksX * numBlocksY);
+    m_blockSums.resize(numBlocksX);
+    for (std::size_t by = 0; by < numBlocksY; ++by) {
+        const std::size_t rowBegin = by * blockSize;
+        const std::size_t rowEnd = std::min<std::size_t>(rowBegin + blockSize, height);
+        std::fill(m_blockSums.begin(), m_blockSums.end(), 0);
+        for (std::size_t y = rowBegin; y < rowEnd; ++y) {
+            const uint8_t* row = frame + y * stride;
+            addBlockSums(row, blockBytes, numFullBlocksX, m_blockSums.data());
+            if (lastBlockBytes) {
+                ::addBlockSumsScalar(row + numFullBlocksX * blockBytes, lastBlockBytes, 1,
+                                     m_blockSums.data() + numFullBlocksX);
+            }
+        }
+
+        const std::size_t numRows = rowEnd - rowBegin;
+        for (std::size_t bx = 0; bx < numBlocksX; ++bx) {
+            const std::size_t numBytes = (bx < numFullBlocksX ? blockBytes : lastBlockBytes) * numRows;
+            m_means[by * numBlocksX + bx] = static_cast<float>(m_blockSums[bx]) / numBytes;
+        }
+    }
+
+    const bool newReference = m_referenceMeans.empty() || width != m_width || height != m_height ||
+                              numChannels != m_numChannels;
+    m_lastScore = std::numeric_limits<float>::infinity();
+    if (!newReference) {
+        m_lastScore = 0;
+        for (std::size_t i = 0; i < m_means.size(); ++i) {
+            m_lastScore = std::max(m_lastScore, std::abs(m_means[i] - m_referenceMeans[i]));
+        }
+    }
+
+    const bool refresh = m_params.refreshInterval && m_numSkippedInRow >= m_params.refreshInterval;
+    if (!newReference && !refresh && m_lastScore <= m_params.maxBlockDifference) {
+        ++m_numSkipped;
+        ++m_numSkippedInRow;
+        return false;
+    }
+
+    // the frame going through inference is the one the next frames must be compared with
+    m_referenceMeans.swap(m_means);
+    m_width = width;
+    m_height = height;
+    m_numChannels = numChannels;
+    ++m_numInferred;
+    m_numSkippedInRow = 0;
+    return true;
+}
+
+void FrameDifferenceGate::reset()
+{
+    m_referenceMeans.clear();
+    m_numSkippedInRow = 0;
+}
+}  // namespace Ort
@@ -6,11 +6,22 @@
  */
 
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <functional>
+#include <numeric>
 #include <sstream>
 
 #include "ort_utility/ort_utility.hpp"
 
+#include "ParallelFor.hpp"
+
+namespace
+{
+// minimum scores per worker, see Ort::numParallelWorkers()
+constexpr std::size_t MIN_SCORES_PER_THREAD = 1 << 16;
+}  // namespace
+
 namespace Ort
 {
 ImageClassificationOrtSessionHandler::ImageClassificationOrtSessionHandler(
@@ -30,24 +41,62 @@ ImageClassificationOrtSessionHandler::topK(const std::vector<float*>& inferenceO
                                            const uint16_t k,                            //
                                            const bool useSoftmax) const
 {
-    const uint16_t realK = std::max(std::min(k, m_numClasses), static_cast<uint16_t>(1));
-
     assert(inferenceOutput.size() == 1);
-    float* processData = inferenceOutput[0];
-    if (useSoftmax) {
-        softmax(processData, m_numClasses);
-    }
+    std::vector<uint64_t> indices;
+    std::vector<std::pair<int, float>> result;
+    this->topKRow(inferenceOutput[0], k, useSoftmax, &indices, &result);
 
-    std::vector<std::pair<int, float>> ps;
-    ps.reserve(m_numClasses);
+    return result;
+}
 
-    for (int i = 0; i < m_numClasses; ++i) {
-        ps.emplace_back(std::make_pair(i, processData[i]));
+std::vector<std::vector<std::pair<int, float>>>
+ImageClassificationOrtSessionHandler::topK(const DataOutputType& inferenceOutput,  //
+                                           const uint16_t k,                       //
+                                           const bool useSoftmax) const
+{
+    const auto& outputShape = inferenceOutput.second;
+    if (outputShape.empty()) {
+        throw std::runtime_error("empty output shape");
+    }
+    const std::size_t batchSize = outputShape[0];
+    const std::size_t numScores =
+        std::accumulate(outputShape.begin() + 1, outputShape.end(), int64_t(1), std::multiplies<int64_t>());
+    if (numScores != m_numClasses) {
+        throw std::runtime_error("output shape does not match the number of classes");
     }
 
-    std::sort(ps.begin(), ps.end(), [](const auto& elem1, const auto& elem2) { return elem1.second > elem2.second; });
+    std::vector<std::vector<std::pair<int, float>>> results(batchSize);
+    auto processRows = [&](const std::size_t begin, const std::size_t end) {
+        std::vector<uint64_t> indices;
+        for (std::size_t row = begin; row < end; ++row) {
+            this->topKRow(inferenceOutput.first + row * numScores, k, useSoftmax, &indices, &results[row]);
+        }
+    };
+
+    // contiguous ranges of rows: every row costs the same
+    Ort::parallelForRanges(batchSize, batchSize * numScores, MIN_SCORES_PER_THREAD, 0, processRows);
+
+    return results;
+}
+
+void ImageClassificationOrtSessionHandler::topKRow(const float* scores, const uint16_t k, const bool useSoftmax,
+                                                   std::vector<uint64_t>* indices,
+                                                   std::vector<std::pair<int, float>>* result) const
+{
+    const uint16_t realK = std::max(std::min(k, m_numClasses), static_cast<uint16_t>(1));
+
+    indices->resize(realK);
+    Ort::topK(scores, m_numClasses, realK, indices->data());
 
-    return std::vector<std::pair<int, float>>(ps.begin(), ps.begin() + realK);
+    // the first selected score is the maximum: the softmax offset
+    const float maxScore = scores[indices->front()];
+    const float sum = useSoftmax ? Ort::sumExp(scores, m_numClasses, maxScore) : 1;
+
+    result->clear();
+    result->reserve(realK);
+    for (const uint64_t idx : *indices) {
+        result->emplace_back(idx, useSoftmax ? std::exp(scores[idx] - maxScore) / sum : scores[idx]);
+    }
 }
 
 std::string ImageClassificationOrtSessionHandler::topKToString(const std::vector<float*>& inferenceOutput,  //
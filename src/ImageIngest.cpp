@@ -0,0 +1,416 @@
+/**
+ * @file    ImageIngest.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if ENABLE_JPEG_TURBO
+#include <jpeglib.h>
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+bool hasJpegSignature(const uint8_t* buffer, std::size_t bufferSize)
+{
+    return bufferSize >= 2 && buffer[0] == 0xFF && buffer[1] == 0xD8;
+}
+
+#if ENABLE_JPEG_TURBO
+struct JpegErrorManager {
+    jpeg_error_mgr pub;
+    std::jmp_buf setjmpBuffer;
+};
+
+void jpegErrorExit(j_common_ptr cinfo)
+{
+    auto* errorManager = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+#if ENABLE_DEBUG
+    (*cinfo->err->output_message)(cinfo);
+#endif
+    std::longjmp(errorManager->setjmpBuffer, 1);
+}
+
+void jpegOutputMessage(j_common_ptr cinfo)
+{
+#if ENABLE_DEBUG
+    char buffer[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, buffer);
+    std::fprintf(stderr, "[libjpeg] %s\n", buffer);
+#else
+    (void)cinfo;
+#endif
+}
+
+/**
+ *  @brief pick the smallest of the simd-accelerated DCT scales (1/8, 1/4, 1/2, 1/1) that still covers the target
+ */
+unsigned int chooseScaleNum(int imageWidth, int imageHeight, int targetWidth, int targetHeight)
+{
+    if (targetWidth <= 0 || targetHeight <= 0) {
+        return 8;
+    }
+
+    for (unsigned int scaleNum : {1u, 2u, 4u}) {
+        // libjpeg rounds scaled dimensions up
+        const int scaledWidth = (imageWidth * scaleNum + 7) / 8;
+        const int scaledHeight = (imageHeight * scaleNum + 7) / 8;
+        if (scaledWidth >= targetWidth && scaledHeight >= targetHeight) {
+            return scaleNum;
+        }
+    }
+
+    return 8;
+}
+
+/**
+ *  @brief orientation tag (1 to 8) of the exif data of an APP1 marker, 1 when there is none
+ */
+int exifOrientation(const uint8_t* data, std::size_t size)
+{
+    static constexpr uint8_t EXIF_HEADER[] = {'E', 'x', 'i', 'f', 0, 0};
+    static constexpr std::size_t TIFF_OFFSET = sizeof(EXIF_HEADER);
+    static constexpr uint16_t ORIENTATION_TAG = 0x0112;
+    static constexpr std::size_t IFD_ENTRY_SIZE = 12;
+
+    if (size < TIFF_OFFSET + 8 || !std::equal(EXIF_HEADER, EXIF_HEADER + TIFF_OFFSET, data)) {
+        return 1;
+    }
+    const uint8_t* tiff = data + TIFF_OFFSET;
+    const std::size_t tiffSize = size - TIFF_OFFSET;
+
+    // "II" for little endian, "MM" for big endian
+    const bool littleEndian = tiff[0] == 'I' && tiff[1] == 'I';
+    if (!littleEndian && !(tiff[0] == 'M' && tiff[1] == 'M')) {
+        return 1;
+    }
+    auto read16 = [littleEndian](const uint8_t* p) {
+        return static_cast<uint16_t>(littleEndian ? p[0] | p[1] << 8 : p[0] << 8 | p[1]);
+    };
+    auto read32 = [littleEndian](const uint8_t* p) {
+        return littleEndian ? uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24
+                            : uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+    };
+
+    const std::size_t ifdOffset = read32(tiff + 4);
+    if (ifdOffset + 2 > tiffSize) {
+        return 1;
+    }
+    const std::size_t numEntries = read16(tiff + ifdOffset);
+    for (std::size_t i = 0; i < numEntries; ++i) {
+        const std::size_t entryOffset = ifdOffset + 2 + i * IFD_ENTRY_SIZE;
+        if (entryOffset + IFD_ENTRY_SIZE > tiffSize) {
+            break;
+        }
+        const uint8_t* entry = tiff + entryOffset;
+        if (read16(entry) == ORIENTATION_TAG) {
+            // a SHORT, stored in the first bytes of the value field
+            const int orientation = read16(entry + 8);
+            return orientation >= 1 && orientation <= 8 ? orientation : 1;
+        }
+    }
+
+    return 1;
+}
+
+// orientations 5 to 8 swap the width and the height of the stored image
+bool isTransposed(int orientation)
+{
+    return orientation >= 5;
+}
+
+/**
+ *  @brief the decompression part is kept free of objects with non-trivial destructors because of setjmp/longjmp
+ *
+ *  @param orientation exif orientation of the stored pixels, applied by the caller
+ *  @return false on libjpeg error
+ */
+bool decodeWithLibJpeg(jpeg_decompress_struct* cinfo, JpegErrorManager* errorManager, int targetWidth,
+                       int targetHeight, int numChannels, Ort::DecodedImage* image, int* orientation)
+{
+    if (setjmp(errorManager->setjmpBuffer)) {
+        jpeg_destroy_decompress(cinfo);
+        return false;
+    }
+
+    jpeg_save_markers(cinfo, JPEG_APP0 + 1, 0xFFFF);
+    jpeg_read_header(cinfo, TRUE);
+
+    *orientation = 1;
+    for (jpeg_saved_marker_ptr marker = cinfo->marker_list; marker; marker = marker->next) {
+        if (marker->marker == JPEG_APP0 + 1) {
+            *orientation = ::exifOrientation(marker->data, marker->data_length);
+            break;
+        }
+    }
+
+    image->originalWidth = cinfo->image_width;
+    image->originalHeight = cinfo->image_height;
+
+    // the target is given in display orientation
+    if (::isTransposed(*orientation)) {
+        std::swap(targetWidth, targetHeight);
+    }
+    cinfo->scale_num = chooseScaleNum(cinfo->image_width, cinfo->image_height, targetWidth, targetHeight);
+    cinfo->scale_denom = 8;
+    cinfo->dct_method = JDCT_ISLOW;
+
+    if (numChannels == 1) {
+        // for YCbCr jpegs this only keeps the luma plane, skipping the chroma upsampling and color conversion
+        cinfo->out_color_space = JCS_GRAYSCALE;
+    } else {
+#ifdef JCS_EXTENSIONS
+        cinfo->out_color_space = JCS_EXT_BGR;
+#else
+        cinfo->out_color_space = JCS_RGB;
+#endif
+    }
+
+    jpeg_start_decompress(cinfo);
+
+    image->width = cinfo->output_width;
+    image->height = cinfo->output_height;
+    image->channels = cinfo->output_components;
+    image->data.resize(static_cast<std::size_t>(image->width) * image->height * image->channels);
+
+    const std::size_t rowStride = static_cast<std::size_t>(image->width) * image->channels;
+    while (cinfo->output_scanline < cinfo->output_height) {
+        JSAMPROW rowPtr = image->data.data() + cinfo->output_scanline * rowStride;
+        jpeg_read_scanlines(cinfo, &rowPtr, 1);
+    }
+
+    jpeg_finish_decompress(cinfo);
+    jpeg_destroy_decompress(cinfo);
+
+#ifndef JCS_EXTENSIONS
+    if (image->channels == 3) {
+        for (std::size_t i = 0; i < image->data.size(); i += 3) {
+            std::swap(image->data[i], image->data[i + 2]);
+        }
+    }
+#endif
+
+    return true;
+}
+
+/**
+ *  @brief turn the stored pixels to their display orientation, as cv::imread does
+ */
+void applyOrientation(int orientation, Ort::DecodedImage* image)
+{
+    if (orientation == 1) {
+        return;
+    }
+
+    const int width = image->width;
+    const int height = image->height;
+    const int channels = image->channels;
+    const bool transposed = ::isTransposed(orientation);
+    const int dstWidth = transposed ? height : width;
+    const int dstHeight = transposed ? width : height;
+
+    std::vector<uint8_t> rotated(image->data.size());
+    for (int y = 0; y < dstHeight; ++y) {
+        uint8_t* dst = rotated.data() + static_cast<std::size_t>(y) * dstWidth * channels;
+        for (int x = 0; x < dstWidth; ++x) {
+            // stored pixel shown at (x, y)
+            int srcX = x, srcY = y;
+            switch (orientation) {
+                case 2:
+                    srcX = width - 1 - x;
+                    break;
+                case 3:
+                    srcX = width - 1 - x;
+                    srcY = height - 1 - y;
+                    break;
+                case 4:
+                    srcY = height - 1 - y;
+                    break;
+                case 5:
+                    srcX = y;
+                    srcY = x;
+                    break;
+                case 6:
+                    srcX = y;
+                    srcY = height - 1 - x;
+                    break;
+                case 7:
+                    srcX = width - 1 - y;
+                    srcY = height - 1 - x;
+                    break;
+                case 8:
+                    srcX = width - 1 - y;
+                    srcY = x;
+                    break;
+            }
+            std::copy_n(image->data.data() + (static_cast<std::size_t>(srcY) * width + srcX) * channels, channels,
+                        dst + x * channels);
+        }
+    }
+
+    image->data = std::move(rotated);
+    image->width = dstWidth;
+    image->height = dstHeight;
+    if (transposed) {
+        std::swap(image->originalWidth, image->originalHeight);
+    }
+}
+
+template <typename SourceSetter>
+Ort::DecodedImage decodeJpegImpl(SourceSetter&& setSource, int targetWidth, int targetHeight, int numChannels)
+{
+    Ort::DecodedImage image;
+
+    if (numChannels != 1 && numChannels != 3) {
+        DEBUG_LOG("only 1 or 3 channels are supported, got %d", numChannels);
+        return image;
+    }
+
+    jpeg_decompress_struct cinfo;
+    JpegErrorManager errorManager;
+    cinfo.err = jpeg_std_error(&errorManager.pub);
+    errorManager.pub.error_exit = jpegErrorExit;
+    errorManager.pub.output_message = jpegOutputMessage;
+    jpeg_create_decompress(&cinfo);
+    setSource(&cinfo);
+
+    int orientation = 1;
+    if (!decodeWithLibJpeg(&cinfo, &errorManager, targetWidth, targetHeight, numChannels, &image, &orientation)) {
+        return Ort::DecodedImage();
+    }
+    ::applyOrientation(orientation, &image);
+
+    return image;
+}
+#endif
+}  // namespace
+
+namespace Ort
+{
+DecodedImage decodeJpeg(const uint8_t* buffer, std::size_t bufferSize, int targetWidth, int targetHeight,
+                        int numChannels)
+{
+    if (!::hasJpegSignature(buffer, bufferSize)) {
+        return DecodedImage();
+    }
+
+#if ENABLE_JPEG_TURBO
+    return ::decodeJpegImpl(
+        [buffer, bufferSize](jpeg_decompress_struct* cinfo) {
+            jpeg_mem_src(cinfo, const_cast<unsigned char*>(buffer), bufferSize);
+        },
+        targetWidth, targetHeight, numChannels);
+#else
+    (void)targetWidth;
+    (void)targetHeight;
+    (void)numChannels;
+    DEBUG_LOG("ort_utility was built without libjpeg-turbo");
+    return DecodedImage();
+#endif
+}
+
+DecodedImage decodeJpeg(const std::string& imagePath, int targetWidth, int targetHeight, int numChannels)
+{
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file(std::fopen(imagePath.c_str(), "rb"), &std::fclose);
+    if (!file) {
+        return DecodedImage();
+    }
+
+    uint8_t signature[2];
+    if (std::fread(signature, 1, sizeof(signature), file.get()) != sizeof(signature) ||
+        !::hasJpegSignature(signature, sizeof(signature))) {
+        return DecodedImage();
+    }
+    std::rewind(file.get());
+
+#if ENABLE_JPEG_TURBO
+    return ::decodeJpegImpl([&file](jpeg_decompress_struct* cinfo) { jpeg_stdio_src(cinfo, file.get()); },
+                            targetWidth, targetHeight, numChannels);
+#else
+    (void)targetWidth;
+    (void)targetHeight;
+    (void)numChannels;
+    DEBUG_LOG("ort_utility was built without libjpeg-turbo");
+    return DecodedImage();
+#endif
+}
+
+void resizeBilinear(const uint8_t* src, int srcWidth, int srcHeight, int numChannels,  //
+                    uint8_t* dst, int dstWidth, int dstHeight)
+{
+    // 11-bit fixed point weights, so that the products of the two passes still fit in 32 bits
+    static constexpr int WEIGHT_BITS = 11;
+    static constexpr int WEIGHT_ONE = 1 << WEIGHT_BITS;
+    static constexpr int ROUNDING = 1 << (2 * WEIGHT_BITS - 1);
+
+    const float scaleX = static_cast<float>(srcWidth) / dstWidth;
+    const float scaleY = static_cast<float>(srcHeight) / dstHeight;
+    const int maxX0 = std::max(srcWidth - 2, 0);
+    const int maxY0 = std::max(srcHeight - 2, 0);
+
+    std::vector<int> xOffsets(dstWidth);
+    std::vector<int> xWeights(dstWidth);
+    for (int x = 0; x < dstWidth; ++x) {
+        const float srcX = std::clamp((x + 0.5f) * scaleX - 0.5f, 0.f, static_cast<float>(srcWidth - 1));
+        const int x0 = std::min(static_cast<int>(srcX), maxX0);
+        xOffsets[x] = x0 * numChannels;
+        xWeights[x] = srcWidth > 1 ? static_cast<int>(std::lround((srcX - x0) * WEIGHT_ONE)) : 0;
+    }
+    const int nextPixel = srcWidth > 1 ? numChannels : 0;
+    const std::size_t srcStride = static_cast<std::size_t>(srcWidth) * numChannels;
+    const std::size_t dstStride = static_cast<std::size_t>(dstWidth) * numChannels;
+
+    for (int y = 0; y < dstHeight; ++y) {
+        const float srcY = std::clamp((y + 0.5f) * scaleY - 0.5f, 0.f, static_cast<float>(srcHeight - 1));
+        const int y0 = std::min(static_cast<int>(srcY), maxY0);
+        const int y1 = std::min(y0 + 1, srcHeight - 1);
+        const int wy = static_cast<int>(std::lround((srcY - y0) * WEIGHT_ONE));
+
+        const uint8_t* row0 = src + y0 * srcStride;
+        const uint8_t* row1 = src + y1 * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        for (int x = 0; x < dstWidth; ++x) {
+            const int wx = xWeights[x];
+            const uint8_t* p0 = row0 + xOffsets[x];
+            const uint8_t* p1 = row1 + xOffsets[x];
+            for (int c = 0; c < numChannels; ++c) {
+                const int top = p0[c] * (WEIGHT_ONE - wx) + p0[c + nextPixel] * wx;
+                const int bottom = p1[c] * (WEIGHT_ONE - wx) + p1[c + nextPixel] * wx;
+                dstRow[x * numChannels + c] =
+                    static_cast<uint8_t>((top * (WEIGHT_ONE - wy) + bottom * wy + ROUNDING) >> (2 * WEIGHT_BITS));
+            }
+        }
+    }
+}
+
+DecodedImage readImage(const std::string& imagePath, int targetWidth, int targetHeight, int numChannels)
+{
+    DecodedImage decoded = decodeJpeg(imagePath, targetWidth, targetHeight, numChannels);
+    if (decoded.empty() || (decoded.width == targetWidth && decoded.height == targetHeight)) {
+        return decoded;
+    }
+
+    DecodedImage resized;
+    resized.width = targetWidth;
+    resized.height = targetHeight;
+    resized.channels = decoded.channels;
+    resized.originalWidth = decoded.originalWidth;
+    resized.originalHeight = decoded.originalHeight;
+    resized.data.resize(static_cast<std::size_t>(targetWidth) * targetHeight * decoded.channels);
+    resizeBilinear(decoded.data.data(), decoded.width, decoded.height, decoded.channels,  //
+                   resized.data.data(), targetWidth, targetHeight);
+
+    return resized;
+}
+}  // namespace Ort
@@ -7,8 +7,6 @@
  *
  */
 
-#include <cassert>
-#include <cstring>
 #include <sstream>
 
 #include "ort_utility/ort_utility.hpp"
@@ -46,6 +44,18 @@ void ImageRecognitionOrtSessionHandlerBase::initClassNames(const std::vector<std
     m_classNames = classNames;
 }
 
+void ImageRecognitionOrtSessionHandlerBase::setFrameGate(const FrameGateParams& params)
+{
+    m_frameGate = std::make_unique<FrameDifferenceGate>(params);
+}
+
+bool ImageRecognitionOrtSessionHandlerBase::needsInference(const uint8_t* frame, const int64_t width,
+                                                           const int64_t height, const int numChannels,
+                                                           const std::size_t stride)
+{
+    return !m_frameGate || m_frameGate->needsInference(frame, width, height, numChannels, stride);
+}
+
 void ImageRecognitionOrtSessionHandlerBase::preprocess(float* dst,                         //
                                                        const unsigned char* src,           //
                                                        const int64_t targetImgWidth,       //
@@ -54,32 +64,38 @@ void ImageRecognitionOrtSessionHandlerBase::preprocess(float* dst,
                                                        const std::vector<float>& meanVal,  //
                                                        const std::vector<float>& stdVal) const
 {
-    if (!meanVal.empty() && !stdVal.empty()) {
-        assert(meanVal.size() == stdVal.size() && meanVal.size() == static_cast<std::size_t>(numChannels));
+    // dispatch once to the variant specialized for the channel count
+    switch (numChannels) {
+        case 1:
+            this->preprocessImpl<1>(dst, src, targetImgWidth, targetImgHeight, meanVal, stdVal);
+            break;
+        case 3:
+            this->preprocessImpl<3>(dst, src, targetImgWidth, targetImgHeight, meanVal, stdVal);
+            break;
+        case 4:
+            this->preprocessImpl<4>(dst, src, targetImgWidth, targetImgHeight, meanVal, stdVal);
+            break;
+        default:
+            throw std::runtime_error("only 1, 3 or 4 channel images are supported, got " +
+                                     std::to_string(numChannels));
     }
+}
 
-    int64_t dataLength = targetImgHeight * targetImgWidth * numChannels;
-
-    memcpy(dst, reinterpret_cast<const float*>(src), dataLength);
-
-    if (!meanVal.empty() && !stdVal.empty()) {
-        for (int i = 0; i < targetImgHeight; ++i) {
-            for (int j = 0; j < targetImgWidth; ++j) {
-                for (int c = 0; c < numChannels; ++c) {
-                    dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                        (src[i * targetImgWidth * numChannels + j * numChannels + c] / 255.0 - meanVal[c]) / stdVal[c];
-                }
-            }
-        }
-    } else {
-        for (int i = 0; i < targetImgHeight; ++i) {
-            for (int j = 0; j < targetImgWidth; ++j) {
-                for (int c = 0; c < numChannels; ++c) {
-                    dst[c * targetImgHeight * targetImgWidth + i * targetImgWidth + j] =
-                        src[i * targetImgWidth * numChannels + j * numChannels + c] / 255.0;
-                }
-            }
-        }
+template <int NUM_CHANNELS>
+void ImageRecognitionOrtSessionHandlerBase::preprocessImpl(float* dst,                         //
+                                                           const unsigned char* src,           //
+                                                           const int64_t targetImgWidth,       //
+                                                           const int64_t targetImgHeight,      //
+                                                           const std::vector<float>& meanVal,  //
+                                                           const std::vector<float>& stdVal) const
+{
+    if (meanVal.empty() || stdVal.empty()) {
+        this->preprocessInput<NUM_CHANNELS, Layout::HWC, ChannelOrder::BGR, UnitScaleNormalization>(
+            dst, src, targetImgWidth, targetImgHeight);
+        return;
     }
+
+    this->preprocessInput<NUM_CHANNELS, Layout::HWC, ChannelOrder::BGR>(
+        dst, src, targetImgWidth, targetImgHeight, MeanStdNormalization<NUM_CHANNELS>(meanVal, stdVal));
 }
 }  // namespace Ort
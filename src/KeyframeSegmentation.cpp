@@ -0,0 +1,286 @@
+/**
+ * @file    KeyframeSegmentation.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+constexpr std::size_t BLOCK_SIZE = Ort::KeyframeSegmentation::MOTION_BLOCK_SIZE;
+
+/**
+ *  @brief sum of absolute differences of two BLOCK_SIZE x BLOCK_SIZE blocks of bytes
+ */
+using BlockSadFunc = uint32_t (*)(const uint8_t* lhs, const uint8_t* rhs, std::size_t stride);
+
+uint32_t blockSadScalar(const uint8_t* lhs, const uint8_t* rhs, const std::size_t stride)
+{
+    uint32_t sad = 0;
+    for (std::size_t y = 0; y < BLOCK_SIZE; ++y) {
+        for (std::size_t x = 0; x < BLOCK_SIZE; ++x) {
+            sad += std::abs(lhs[y * stride + x] - rhs[y * stride + x]);
+        }
+    }
+    return sad;
+}
+
+#if ORT_UTILITY_X86
+// the 8 byte rows of 4 block rows in one register
+__attribute__((target("avx2"))) __m256i loadBlockRowsAvx2(const uint8_t* block, const std::size_t stride)
+{
+    int64_t rows[4];
+    for (int r = 0; r < 4; ++r) {
+        std::memcpy(&rows[r], block + r * stride, sizeof(int64_t));
+    }
+    return _mm256_setr_epi64x(rows[0], rows[1], rows[2], rows[3]);
+}
+
+__attribute__((target("avx2"))) uint32_t blockSadAvx2(const uint8_t* lhs, const uint8_t* rhs,
+                                                      const std::size_t stride)
+{
+    __m256i sads = _mm256_setzero_si256();
+    for (std::size_t y = 0; y < BLOCK_SIZE; y += 4) {
+        sads = _mm256_add_epi64(sads, _mm256_sad_epu8(::loadBlockRowsAvx2(lhs + y * stride, stride),
+                                                      ::loadBlockRowsAvx2(rhs + y * stride, stride)));
+    }
+    const __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(sads), _mm256_extracti128_si256(sads, 1));
+    return _mm_cvtsi128_si32(_mm_add_epi64(halves, _mm_unpackhi_epi64(halves, halves)));
+}
+#endif
+
+BlockSadFunc selectBlockSad()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return blockSadAvx2;
+    }
+#endif
+    return blockSadScalar;
+}
+}  // namespace
+
+namespace Ort
+{
+KeyframeSegmentation::KeyframeSegmentation(const KeyframeParams& params)
+    : m_params(params)
+{
+    if (params.motionScale == 0) {
+        throw std::runtime_error("motion scale must be more than 0");
+    }
+    if (params.searchRadius < 0 || params.searchRadius > 127) {
+        throw std::runtime_error("search radius must be in [0, 127]");
+    }
+}
+
+bool KeyframeSegmentation::nextFrame(const uint8_t* frame, const int64_t width, const int64_t height,
+                                     const int numChannels, const std::size_t stride)
+{
+    if (width <= 0 || height <= 0 || numChannels <= 0) {
+        throw std::runtime_error("empty frame");
+    }
+
+    if (width != m_width || height != m_height) {
+        m_width = width;
+        m_height = height;
+        m_smallWidth = width / m_params.motionScale;
+        m_smallHeight = height / m_params.motionScale;
+        m_numBlocksX = m_smallWidth / BLOCK_SIZE;
+        m_numBlocksY = m_smallHeight / BLOCK_SIZE;
+        m_previous.clear();
+    }
+    this->downsample(frame, numChannels, stride);
+
+    bool isKeyframe = m_previous.empty() || m_labels.empty() || m_numBlocksX == 0 || m_numBlocksY == 0 ||
+                      (m_params.maxInterval && m_numPropagatedInRow >= m_params.maxInterval);
+    m_lastMotion = 0;
+    if (!isKeyframe) {
+        const float unmatchedFraction = this->estimateMotion();
+        m_motionSinceKeyframe += m_lastMotion;
+        isKeyframe =
+            unmatchedFraction > m_params.maxUnmatchedFraction || m_motionSinceKeyframe > m_params.maxMotion;
+    }
+    m_previous.swap(m_current);
+
+    if (isKeyframe) {
+        ++m_numKeyframes;
+        m_numPropagatedInRow = 0;
+        m_motionSinceKeyframe = 0;
+        m_motionXs.assign(m_numBlocksX * m_numBlocksY, 0);
+        m_motionYs.assign(m_numBlocksX * m_numBlocksY, 0);
+        return true;
+    }
+
+    this->warpLabels();
+    ++m_numPropagated;
+    ++m_numPropagatedInRow;
+    return false;
+}
+
+void KeyframeSegmentation::setKeyframeLabels(const uint8_t* labels, const std::size_t labelWidth,
+                                             const std::size_t labelHeight)
+{
+    m_keyframeLabels.assign(labels, labels + labelWidth * labelHeight);
+    m_labels = m_keyframeLabels;
+    m_labelWidth = labelWidth;
+    m_labelHeight = labelHeight;
+}
+
+void KeyframeSegmentation::downsample(const uint8_t* frame, const int numChannels, const std::size_t stride)
+{
+    const std::size_t scale = m_params.motionScale;
+    const std::size_t cellBytes = scale * numChannels;
+    const uint32_t cellSize = scale * cellBytes;
+
+    m_current.resize(m_smallWidth * m_smallHeight);
+    m_sums.resize(m_smallWidth);
+    for (std::size_t sy = 0; sy < m_smallHeight; ++sy) {
+        std::fill(m_sums.begin(), m_sums.end(), 0);
+        for (std::size_t r = 0; r < scale; ++r) {
+            const uint8_t* row = frame + (sy * scale + r) * stride;
+            for (std::size_t sx = 0; sx < m_smallWidth; ++sx) {
+                const uint8_t* cell = row + sx * cellBytes;
+                uint32_t sum = 0;
+                for (std::size_t k = 0; k < cellBytes; ++k) {
+                    sum += cell[k];
+                }
+                m_sums[sx] += sum;
+            }
+        }
+        for (std::size_t sx = 0; sx < m_smallWidth; ++sx) {
+            m_current[sy * m_smallWidth + sx] = (m_sums[sx] + cellSize / 2) / cellSize;
+        }
+    }
+}
+
+float KeyframeSegmentation::estimateMotion()
+{
+    static const BlockSadFunc blockSad = ::selectBlockSad();
+    const int radius = m_params.searchRadius;
+    const int searchSize = 2 * radius + 1;
+    const uint32_t maxSad = m_params.maxBlockError * BLOCK_SIZE * BLOCK_SIZE;
+    const int64_t maxX = m_smallWidth - BLOCK_SIZE;
+    const int64_t maxY = m_smallHeight - BLOCK_SIZE;
+
+    // sads grow linearly away from the true motion: the offset of the vertex of the V through the best match and its
+    // neighbours. Exact matches are not refined, the bias of an asymmetric texture would add up frame after frame;
+    // candidates out of the frame are never picked, nor used to refine
+    m_sads.resize(searchSize * searchSize);
+    auto sadAt = [&](const int dx, const int dy) { return m_sads[(dy + radius) * searchSize + dx + radius]; };
+    auto subpixel = [](const uint32_t before, const uint32_t best, const uint32_t after) {
+        if (best == 0 || before == UINT32_MAX || after == UINT32_MAX) {
+            return 0.f;
+        }
+        const float slope = std::max(before, after) - static_cast<float>(best);
+        return slope > 0 ? (static_cast<float>(before) - static_cast<float>(after)) / (2 * slope) : 0.f;
+    };
+
+    std::size_t numUnmatched = 0;
+    float motionSum = 0;
+    for (std::size_t by = 0; by < m_numBlocksY; ++by) {
+        for (std::size_t bx = 0; bx < m_numBlocksX; ++bx) {
+            const int64_t x0 = bx * BLOCK_SIZE;
+            const int64_t y0 = by * BLOCK_SIZE;
+            const uint8_t* block = m_current.data() + y0 * m_smallWidth + x0;
+
+            // full search, the smaller motion winning ties so that flat areas do not drift
+            uint32_t bestSad = UINT32_MAX;
+            int bestDx = 0;
+            int bestDy = 0;
+            for (int dy = -radius; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx) {
+                    uint32_t& sad = m_sads[(dy + radius) * searchSize + dx + radius];
+                    if (y0 + dy < 0 || y0 + dy > maxY || x0 + dx < 0 || x0 + dx > maxX) {
+                        sad = UINT32_MAX;
+                        continue;
+                    }
+                    sad = blockSad(block, m_previous.data() + (y0 + dy) * m_smallWidth + x0 + dx, m_smallWidth);
+                    if (sad < bestSad ||
+                        (sad == bestSad && std::abs(dx) + std::abs(dy) < std::abs(bestDx) + std::abs(bestDy))) {
+                        bestSad = sad;
+                        bestDx = dx;
+                        bestDy = dy;
+                    }
+                }
+            }
+
+            float motionX = bestDx;
+            float motionY = bestDy;
+            if (std::abs(bestDx) < radius) {
+                motionX += subpixel(sadAt(bestDx - 1, bestDy), bestSad, sadAt(bestDx + 1, bestDy));
+            }
+            if (std::abs(bestDy) < radius) {
+                motionY += subpixel(sadAt(bestDx, bestDy - 1), bestSad, sadAt(bestDx, bestDy + 1));
+            }
+
+            const std::size_t blockIdx = by * m_numBlocksX + bx;
+            m_motionXs[blockIdx] += motionX;
+            m_motionYs[blockIdx] += motionY;
+            numUnmatched += bestSad > maxSad;
+            motionSum += std::sqrt(motionX * motionX + motionY * motionY);
+        }
+    }
+
+    const std::size_t numBlocks = m_numBlocksX * m_numBlocksY;
+    m_lastMotion = motionSum * m_params.motionScale / numBlocks;
+    return static_cast<float>(numUnmatched) / numBlocks;
+}
+
+void KeyframeSegmentation::warpLabels()
+{
+    // block of each label column and row; pixels past the last full block follow it
+    thread_local std::vector<uint32_t> blockXs;
+    thread_local std::vector<uint32_t> blockYs;
+    blockXs.resize(m_labelWidth);
+    blockYs.resize(m_labelHeight);
+    const std::size_t blockPixels = m_params.motionScale * BLOCK_SIZE;
+    for (std::size_t x = 0; x < m_labelWidth; ++x) {
+        blockXs[x] = std::min<std::size_t>((x * m_width / m_labelWidth) / blockPixels, m_numBlocksX - 1);
+    }
+    for (std::size_t y = 0; y < m_labelHeight; ++y) {
+        blockYs[y] = std::min<std::size_t>((y * m_height / m_labelHeight) / blockPixels, m_numBlocksY - 1);
+    }
+
+    // block motion in label pixels
+    thread_local std::vector<int32_t> labelDxs;
+    thread_local std::vector<int32_t> labelDys;
+    labelDxs.resize(m_motionXs.size());
+    labelDys.resize(m_motionYs.size());
+    const float scaleX = static_cast<float>(m_params.motionScale) * m_labelWidth / m_width;
+    const float scaleY = static_cast<float>(m_params.motionScale) * m_labelHeight / m_height;
+    for (std::size_t i = 0; i < m_motionXs.size(); ++i) {
+        labelDxs[i] = std::lround(m_motionXs[i] * scaleX);
+        labelDys[i] = std::lround(m_motionYs[i] * scaleY);
+    }
+
+    // every label comes from where its block was in the keyframe
+    const int64_t lastX = m_labelWidth - 1;
+    const int64_t lastY = m_labelHeight - 1;
+    for (std::size_t y = 0; y < m_labelHeight; ++y) {
+        const std::size_t blockRow = blockYs[y] * m_numBlocksX;
+        uint8_t* dst = m_labels.data() + y * m_labelWidth;
+        for (std::size_t x = 0; x < m_labelWidth; ++x) {
+            const std::size_t blockIdx = blockRow + blockXs[x];
+            const int64_t srcX = std::min<int64_t>(std::max<int64_t>(x + labelDxs[blockIdx], 0), lastX);
+            const int64_t srcY = std::min<int64_t>(std::max<int64_t>(y + labelDys[blockIdx], 0), lastY);
+            dst[x] = m_keyframeLabels[srcY * m_labelWidth + srcX];
+        }
+    }
+}
+}  // namespace Ort
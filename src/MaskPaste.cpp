@@ -0,0 +1,202 @@
+/**
+ * @file    MaskPaste.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+#include "ParallelFor.hpp"
+
+namespace
+{
+// minimum box pixels per worker, see Ort::numParallelWorkers()
+constexpr std::size_t MIN_PIXELS_PER_THREAD = 1 << 18;
+
+/**
+ *  @brief dst[i] = id where the interpolated mask row exceeds thresh and dst[i] is still background
+ *
+ *  the value at pixel i is row[xIndices[i]] + xWeights[i] * (row[xIndices[i] + 1] - row[xIndices[i]])
+ */
+using PasteRowFunc = void (*)(const float* row, const int32_t* xIndices, const float* xWeights, std::size_t count,
+                              float thresh, uint16_t id, uint16_t* dst);
+
+void pasteRowScalar(const float* row, const int32_t* xIndices, const float* xWeights, const std::size_t count,
+                    const float thresh, const uint16_t id, uint16_t* dst)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        const float left = row[xIndices[i]];
+        const float value = left + xWeights[i] * (row[xIndices[i] + 1] - left);
+        dst[i] = value > thresh && dst[i] == 0 ? id : dst[i];
+    }
+}
+
+#if ORT_UTILITY_X86
+__attribute__((target("avx2"))) void pasteRowAvx2(const float* row, const int32_t* xIndices, const float* xWeights,
+                                                  const std::size_t count, const float thresh, const uint16_t id,
+                                                  uint16_t* dst)
+{
+    const __m256 threshVec = _mm256_set1_ps(thresh);
+    const __m128i idVec = _mm_set1_epi16(id);
+    const __m128i zero = _mm_setzero_si128();
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xIndices + i));
+        const __m256 left = _mm256_i32gather_ps(row, indices, sizeof(float));
+        const __m256 right = _mm256_i32gather_ps(row + 1, indices, sizeof(float));
+        const __m256 weights = _mm256_loadu_ps(xWeights + i);
+        const __m256 value = _mm256_add_ps(left, _mm256_mul_ps(weights, _mm256_sub_ps(right, left)));
+
+        // 32 bit lane masks narrowed to the 16 bit ids, keeping their order
+        const __m256i above = _mm256_castps_si256(_mm256_cmp_ps(value, threshVec, _CMP_GT_OQ));
+        const __m128i above16 = _mm_packs_epi32(_mm256_castsi256_si128(above), _mm256_extracti128_si256(above, 1));
+
+        const __m128i ids = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i selected = _mm_and_si128(above16, _mm_cmpeq_epi16(ids, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_blendv_epi8(ids, idVec, selected));
+    }
+
+    ::pasteRowScalar(row, xIndices + i, xWeights + i, count - i, thresh, id, dst + i);
+}
+#endif
+
+PasteRowFunc selectPasteRow()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return pasteRowAvx2;
+    }
+#endif
+    return pasteRowScalar;
+}
+
+// bilinear source sample and weight of destination pixel i, for srcSize samples stretched by 1 / scale, with half
+// pixel centers and replicated borders as in cv::resize
+inline void sourceCoordinate(const int64_t i, const float scale, const std::size_t srcSize, int32_t* index,
+                             float* weight)
+{
+    const float coordinate = std::min(std::max((i + 0.5f) * scale - 0.5f, 0.f), static_cast<float>(srcSize - 1));
+    *index = std::min(static_cast<int32_t>(coordinate), static_cast<int32_t>(srcSize - 1));
+    *weight = coordinate - *index;
+}
+
+struct Box {
+    // first and past the last pixel of the box, before clamping to the image
+    int64_t xBegin;
+    int64_t yBegin;
+    int64_t xEnd;
+    int64_t yEnd;
+};
+
+inline Box roundBox(const float xmin, const float ymin, const float xmax, const float ymax)
+{
+    return {std::lround(xmin), std::lround(ymin), std::lround(xmax), std::lround(ymax)};
+}
+
+/**
+ *  @brief paste the mask of one instance into the rows [rowBegin, rowEnd) of instanceIds
+ */
+void pasteMaskRows(const PasteRowFunc pasteRow, const float* mask, const std::size_t maskWidth,
+                   const std::size_t maskHeight, const Box& box, const float maskThresh, const uint16_t id,
+                   uint16_t* instanceIds, const std::size_t width, const std::size_t rowBegin,
+                   const std::size_t rowEnd)
+{
+    const int64_t boxWidth = box.xEnd - box.xBegin;
+    const int64_t boxHeight = box.yEnd - box.yBegin;
+    const int64_t colBegin = std::max<int64_t>(box.xBegin, 0);
+    const int64_t colEnd = std::min<int64_t>(box.xEnd, width);
+    const int64_t first = std::max<int64_t>(box.yBegin, rowBegin);
+    const int64_t last = std::min<int64_t>(box.yEnd, rowEnd);
+    if (boxWidth <= 0 || boxHeight <= 0 || colBegin >= colEnd || first >= last) {
+        return;
+    }
+
+    // horizontal interpolation of every column, shared by all rows of the box
+    thread_local std::vector<int32_t> xIndices;
+    thread_local std::vector<float> xWeights;
+    thread_local std::vector<float> row;
+    const std::size_t count = colEnd - colBegin;
+    xIndices.resize(count);
+    xWeights.resize(count);
+    const float scaleX = static_cast<float>(maskWidth) / boxWidth;
+    for (std::size_t i = 0; i < count; ++i) {
+        ::sourceCoordinate(colBegin + i - box.xBegin, scaleX, maskWidth, &xIndices[i], &xWeights[i]);
+    }
+
+    // one more sample replicating the last one, so that index + 1 is always readable
+    row.resize(maskWidth + 1);
+    const float scaleY = static_cast<float>(maskHeight) / boxHeight;
+    for (int64_t y = first; y < last; ++y) {
+        int32_t top;
+        float weight;
+        ::sourceCoordinate(y - box.yBegin, scaleY, maskHeight, &top, &weight);
+        const float* topRow = mask + top * maskWidth;
+        const float* bottomRow = mask + std::min<std::size_t>(top + 1, maskHeight - 1) * maskWidth;
+        for (std::size_t j = 0; j < maskWidth; ++j) {
+            row[j] = topRow[j] + weight * (bottomRow[j] - topRow[j]);
+        }
+        row[maskWidth] = row[maskWidth - 1];
+
+        pasteRow(row.data(), xIndices.data(), xWeights.data(), count, maskThresh, id,
+                 instanceIds + y * width + colBegin);
+    }
+}
+}  // namespace
+
+namespace Ort
+{
+void pasteMasks(const float* masks, const std::size_t maskWidth, const std::size_t maskHeight,
+                const uint64_t* maskIndices,                                               //
+                const float* xmins, const float* ymins,                                    //
+                const float* xmaxs, const float* ymaxs,                                    //
+                const std::size_t numInstances, const float maskThresh,                    //
+                uint16_t* instanceIds, const std::size_t width, const std::size_t height,  //
+                const std::size_t numThreads)
+{
+    if (numInstances > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("too many instances for 16 bit instance ids");
+    }
+    if (numInstances > 0 && (maskWidth == 0 || maskHeight == 0)) {
+        throw std::runtime_error("empty masks");
+    }
+
+    std::fill(instanceIds, instanceIds + width * height, 0);
+
+    std::vector<Box> boxes(numInstances);
+    std::size_t numBoxPixels = 0;
+    for (std::size_t i = 0; i < numInstances; ++i) {
+        boxes[i] = ::roundBox(xmins[i], ymins[i], xmaxs[i], ymaxs[i]);
+        numBoxPixels += std::max<int64_t>(boxes[i].xEnd - boxes[i].xBegin, 0) *
+                        std::max<int64_t>(boxes[i].yEnd - boxes[i].yBegin, 0);
+    }
+
+    static const PasteRowFunc pasteRow = ::selectPasteRow();
+    const std::size_t maskSize = maskWidth * maskHeight;
+    auto pasteRows = [&](const std::size_t rowBegin, const std::size_t rowEnd) {
+        for (std::size_t i = 0; i < numInstances; ++i) {
+            const float* mask = masks + (maskIndices ? maskIndices[i] : i) * maskSize;
+            ::pasteMaskRows(pasteRow, mask, maskWidth, maskHeight, boxes[i], maskThresh, i + 1, instanceIds, width,
+                            rowBegin, rowEnd);
+        }
+    };
+
+    // contiguous bands of rows, each written by one worker only
+    Ort::parallelForRanges(height, numBoxPixels, MIN_PIXELS_PER_THREAD, numThreads, pasteRows);
+}
+}  // namespace Ort
@@ -0,0 +1,771 @@
+/**
+ * @file    Nms.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <initializer_list>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+#include "ParallelFor.hpp"
+
+namespace
+{
+constexpr std::size_t BITS_PER_WORD = 64;
+
+// minimum candidates per worker, see Ort::numParallelWorkers()
+constexpr std::size_t MIN_CANDIDATES_PER_THREAD = 2048;
+
+// matrix nms columns cost a full IoU row each, so threads pay off much earlier
+constexpr std::size_t MIN_MATRIX_COLUMNS_PER_THREAD = 256;
+
+// the current box, against which the remaining candidates are tested
+struct ReferenceBox {
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+    float area;
+};
+
+using SuppressFunc = void (*)(const float*, const float*, const float*, const float*, const float*,
+                              const ReferenceBox&, float, std::size_t, std::size_t, uint64_t*);
+
+using OverlapsFunc = void (*)(const float*, const float*, const float*, const float*, const float*,
+                              const ReferenceBox&, std::size_t, std::size_t, float*);
+
+/**
+ *  @brief mark every candidate of the words [beginWord, numWords) overlapping the reference box by more than the
+ *  threshold
+ */
+void suppressOverlapsScalar(const float* xmins, const float* ymins, const float* xmaxs, const float* ymaxs,
+                            const float* areas, const ReferenceBox& ref, const float overlapThresh,
+                            const std::size_t beginWord, const std::size_t numWords, uint64_t* suppressed)
+{
+    for (std::size_t word = beginWord; word < numWords; ++word) {
+        if (suppressed[word] == ~uint64_t(0)) {
+            continue;
+        }
+
+        uint64_t mask = 0;
+        for (std::size_t k = 0; k < BITS_PER_WORD; ++k) {
+            const std::size_t j = word * BITS_PER_WORD + k;
+            const float width = std::max(std::min(ref.xmax, xmaxs[j]) - std::max(ref.xmin, xmins[j]), 0.f);
+            const float height = std::max(std::min(ref.ymax, ymaxs[j]) - std::max(ref.ymin, ymins[j]), 0.f);
+            const float intersection = width * height;
+            mask |= static_cast<uint64_t>(intersection / (ref.area + areas[j] - intersection) > overlapThresh) << k;
+        }
+        suppressed[word] |= mask;
+    }
+}
+
+/**
+ *  @brief IoU of the reference box with the candidates [begin, end), written at the same indices of ious
+ */
+void computeOverlapsScalar(const float* xmins, const float* ymins, const float* xmaxs, const float* ymaxs,
+                           const float* areas, const ReferenceBox& ref, const std::size_t begin, const std::size_t end,
+                           float* ious)
+{
+    for (std::size_t j = begin; j < end; ++j) {
+        const float width = std::max(std::min(ref.xmax, xmaxs[j]) - std::max(ref.xmin, xmins[j]), 0.f);
+        const float height = std::max(std::min(ref.ymax, ymaxs[j]) - std::max(ref.ymin, ymins[j]), 0.f);
+        const float intersection = width * height;
+        ious[j] = intersection / (ref.area + areas[j] - intersection);
+    }
+}
+
+#if ORT_UTILITY_X86
+__attribute__((target("avx2"))) void suppressOverlapsAvx2(const float* xmins, const float* ymins, const float* xmaxs,
+                                                          const float* ymaxs, const float* areas,
+                                                          const ReferenceBox& ref, const float overlapThresh,
+                                                          const std::size_t beginWord, const std::size_t numWords,
+                                                          uint64_t* suppressed)
+{
+    const __m256 refXmin = _mm256_set1_ps(ref.xmin);
+    const __m256 refYmin = _mm256_set1_ps(ref.ymin);
+    const __m256 refXmax = _mm256_set1_ps(ref.xmax);
+    const __m256 refYmax = _mm256_set1_ps(ref.ymax);
+    const __m256 refArea = _mm256_set1_ps(ref.area);
+    const __m256 thresh = _mm256_set1_ps(overlapThresh);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (std::size_t word = beginWord; word < numWords; ++word) {
+        if (suppressed[word] == ~uint64_t(0)) {
+            continue;
+        }
+
+        uint64_t mask = 0;
+        for (std::size_t k = 0; k < BITS_PER_WORD; k += 8) {
+            const std::size_t j = word * BITS_PER_WORD + k;
+            const __m256 width = _mm256_max_ps(
+                _mm256_sub_ps(_mm256_min_ps(refXmax, _mm256_loadu_ps(xmaxs + j)),
+                              _mm256_max_ps(refXmin, _mm256_loadu_ps(xmins + j))),
+                zero);
+            const __m256 height = _mm256_max_ps(
+                _mm256_sub_ps(_mm256_min_ps(refYmax, _mm256_loadu_ps(ymaxs + j)),
+                              _mm256_max_ps(refYmin, _mm256_loadu_ps(ymins + j))),
+                zero);
+            const __m256 intersection = _mm256_mul_ps(width, height);
+            const __m256 unionArea = _mm256_sub_ps(_mm256_add_ps(refArea, _mm256_loadu_ps(areas + j)), intersection);
+            const __m256 iou = _mm256_div_ps(intersection, unionArea);
+            mask |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_cmp_ps(iou, thresh, _CMP_GT_OQ))) << k;
+        }
+        suppressed[word] |= mask;
+    }
+}
+
+__attribute__((target("avx2"))) void computeOverlapsAvx2(const float* xmins, const float* ymins, const float* xmaxs,
+                                                         const float* ymaxs, const float* areas,
+                                                         const ReferenceBox& ref, const std::size_t begin,
+                                                         const std::size_t end, float* ious)
+{
+    const __m256 refXmin = _mm256_set1_ps(ref.xmin);
+    const __m256 refYmin = _mm256_set1_ps(ref.ymin);
+    const __m256 refXmax = _mm256_set1_ps(ref.xmax);
+    const __m256 refYmax = _mm256_set1_ps(ref.ymax);
+    const __m256 refArea = _mm256_set1_ps(ref.area);
+    const __m256 zero = _mm256_setzero_ps();
+
+    std::size_t j = begin;
+    for (; j + 8 <= end; j += 8) {
+        const __m256 width = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(refXmax, _mm256_loadu_ps(xmaxs + j)),
+                                                         _mm256_max_ps(refXmin, _mm256_loadu_ps(xmins + j))),
+                                           zero);
+        const __m256 height = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(refYmax, _mm256_loadu_ps(ymaxs + j)),
+                                                          _mm256_max_ps(refYmin, _mm256_loadu_ps(ymins + j))),
+                                            zero);
+        const __m256 intersection = _mm256_mul_ps(width, height);
+        const __m256 unionArea = _mm256_sub_ps(_mm256_add_ps(refArea, _mm256_loadu_ps(areas + j)), intersection);
+        _mm256_storeu_ps(ious + j, _mm256_div_ps(intersection, unionArea));
+    }
+    computeOverlapsScalar(xmins, ymins, xmaxs, ymaxs, areas, ref, j, end, ious);
+}
+
+// gcc 12 reports the _mm512_undefined_ps() placeholders of its own avx-512 headers as maybe-uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f"))) void suppressOverlapsAvx512(const float* xmins, const float* ymins,
+                                                               const float* xmaxs, const float* ymaxs,
+                                                               const float* areas, const ReferenceBox& ref,
+                                                               const float overlapThresh, const std::size_t beginWord,
+                                                               const std::size_t numWords, uint64_t* suppressed)
+{
+    const __m512 refXmin = _mm512_set1_ps(ref.xmin);
+    const __m512 refYmin = _mm512_set1_ps(ref.ymin);
+    const __m512 refXmax = _mm512_set1_ps(ref.xmax);
+    const __m512 refYmax = _mm512_set1_ps(ref.ymax);
+    const __m512 refArea = _mm512_set1_ps(ref.area);
+    const __m512 thresh = _mm512_set1_ps(overlapThresh);
+    const __m512 zero = _mm512_setzero_ps();
+
+    for (std::size_t word = beginWord; word < numWords; ++word) {
+        if (suppressed[word] == ~uint64_t(0)) {
+            continue;
+        }
+
+        uint64_t mask = 0;
+        for (std::size_t k = 0; k < BITS_PER_WORD; k += 16) {
+            const std::size_t j = word * BITS_PER_WORD + k;
+            const __m512 width = _mm512_max_ps(
+                _mm512_sub_ps(_mm512_min_ps(refXmax, _mm512_loadu_ps(xmaxs + j)),
+                              _mm512_max_ps(refXmin, _mm512_loadu_ps(xmins + j))),
+                zero);
+            const __m512 height = _mm512_max_ps(
+                _mm512_sub_ps(_mm512_min_ps(refYmax, _mm512_loadu_ps(ymaxs + j)),
+                              _mm512_max_ps(refYmin, _mm512_loadu_ps(ymins + j))),
+                zero);
+            const __m512 intersection = _mm512_mul_ps(width, height);
+            const __m512 unionArea = _mm512_sub_ps(_mm512_add_ps(refArea, _mm512_loadu_ps(areas + j)), intersection);
+            const __m512 iou = _mm512_div_ps(intersection, unionArea);
+            mask |= static_cast<uint64_t>(_mm512_cmp_ps_mask(iou, thresh, _CMP_GT_OQ)) << k;
+        }
+        suppressed[word] |= mask;
+    }
+}
+
+__attribute__((target("avx512f"))) void computeOverlapsAvx512(const float* xmins, const float* ymins,
+                                                              const float* xmaxs, const float* ymaxs,
+                                                              const float* areas, const ReferenceBox& ref,
+                                                              const std::size_t begin, const std::size_t end,
+                                                              float* ious)
+{
+    const __m512 refXmin = _mm512_set1_ps(ref.xmin);
+    const __m512 refYmin = _mm512_set1_ps(ref.ymin);
+    const __m512 refXmax = _mm512_set1_ps(ref.xmax);
+    const __m512 refYmax = _mm512_set1_ps(ref.ymax);
+    const __m512 refArea = _mm512_set1_ps(ref.area);
+    const __m512 zero = _mm512_setzero_ps();
+
+    std::size_t j = begin;
+    for (; j + 16 <= end; j += 16) {
+        const __m512 width = _mm512_max_ps(_mm512_sub_ps(_mm512_min_ps(refXmax, _mm512_loadu_ps(xmaxs + j)),
+                                                         _mm512_max_ps(refXmin, _mm512_loadu_ps(xmins + j))),
+                                           zero);
+        const __m512 height = _mm512_max_ps(_mm512_sub_ps(_mm512_min_ps(refYmax, _mm512_loadu_ps(ymaxs + j)),
+                                                          _mm512_max_ps(refYmin, _mm512_loadu_ps(ymins + j))),
+                                            zero);
+        const __m512 intersection = _mm512_mul_ps(width, height);
+        const __m512 unionArea = _mm512_sub_ps(_mm512_add_ps(refArea, _mm512_loadu_ps(areas + j)), intersection);
+        _mm512_storeu_ps(ious + j, _mm512_div_ps(intersection, unionArea));
+    }
+    computeOverlapsScalar(xmins, ymins, xmaxs, ymaxs, areas, ref, j, end, ious);
+}
+#pragma GCC diagnostic pop
+#endif
+
+// ties go to the later box, as the previous deque based implementation did
+struct HigherScore {
+    const float* scores;
+
+    bool operator()(uint64_t lhs, uint64_t rhs) const
+    {
+        return scores[lhs] > scores[rhs] || (scores[lhs] == scores[rhs] && lhs > rhs);
+    }
+};
+
+/**
+ *  @brief keep the topK highest score boxes in decreasing score order, boxAt(i) returns the corners of box i
+ */
+template <typename BoxAt>
+void assignCandidates(Ort::SortedCandidates* candidates, const std::size_t numBoxes, const BoxAt& boxAt,
+                      const float* sourceScores, const uint64_t topK)
+{
+    auto& indices = candidates->indices;
+    indices.resize(numBoxes);
+    std::iota(indices.begin(), indices.end(), 0);
+    const auto higherScore = HigherScore{sourceScores};
+    if (topK < indices.size()) {
+        std::partial_sort(indices.begin(), indices.begin() + topK, indices.end(), higherScore);
+        indices.resize(topK);
+    } else {
+        std::sort(indices.begin(), indices.end(), higherScore);
+    }
+
+    const std::size_t numCandidates = indices.size();
+    for (auto* buffer : {&candidates->xmins, &candidates->ymins, &candidates->xmaxs, &candidates->ymaxs,
+                         &candidates->areas, &candidates->scores}) {
+        buffer->resize(numCandidates);
+    }
+    for (std::size_t i = 0; i < numCandidates; ++i) {
+        const std::array<float, 4> bbox = boxAt(indices[i]);
+        candidates->xmins[i] = bbox[0];
+        candidates->ymins[i] = bbox[1];
+        candidates->xmaxs[i] = bbox[2];
+        candidates->ymaxs[i] = bbox[3];
+        candidates->areas[i] = (bbox[2] - bbox[0]) * (bbox[3] - bbox[1]);
+        candidates->scores[i] = sourceScores[indices[i]];
+    }
+}
+
+SuppressFunc selectSuppressOverlaps()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return suppressOverlapsAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return suppressOverlapsAvx2;
+    }
+#endif
+    return suppressOverlapsScalar;
+}
+
+OverlapsFunc selectComputeOverlaps()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return computeOverlapsAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return computeOverlapsAvx2;
+    }
+#endif
+    return computeOverlapsScalar;
+}
+
+void computeOverlaps(const Ort::SortedCandidates& candidates, const ReferenceBox& ref, const std::size_t begin,
+                     const std::size_t end, float* ious)
+{
+    static const OverlapsFunc compute = selectComputeOverlaps();
+    compute(candidates.xmins.data(), candidates.ymins.data(), candidates.xmaxs.data(), candidates.ymaxs.data(),
+            candidates.areas.data(), ref, begin, end, ious);
+}
+
+ReferenceBox referenceBox(const Ort::SortedCandidates& candidates, const std::size_t i)
+{
+    return {candidates.xmins[i], candidates.ymins[i], candidates.xmaxs[i], candidates.ymaxs[i], candidates.areas[i]};
+}
+
+/**
+ *  @brief split the columns [0, numColumns) of a triangular matrix in ranges of about the same area and run
+ *  func(worker, begin, end) on each of them, one worker per thread
+ */
+template <typename Func> void parallelForColumns(std::size_t numWorkers, std::size_t numColumns, const Func& func)
+{
+    std::vector<std::size_t> bounds(numWorkers + 1, numColumns);
+    for (std::size_t w = 0; w < numWorkers; ++w) {
+        bounds[w] = static_cast<std::size_t>(numColumns * std::sqrt(static_cast<double>(w) / numWorkers));
+    }
+
+    Ort::runWorkers(numWorkers, [&](const std::size_t w) { func(w, bounds[w], bounds[w + 1]); });
+}
+
+void suppressOverlaps(const float* xmins, const float* ymins, const float* xmaxs, const float* ymaxs,
+                      const float* areas, const ReferenceBox& ref, const float overlapThresh,
+                      const std::size_t beginWord, const std::size_t numWords, uint64_t* suppressed)
+{
+    static const SuppressFunc suppress = selectSuppressOverlaps();
+    suppress(xmins, ymins, xmaxs, ymaxs, areas, ref, overlapThresh, beginWord, numWords, suppressed);
+}
+}  // namespace
+
+namespace Ort
+{
+const std::vector<uint64_t>& NmsEngine::run(const float* xmins, const float* ymins,  //
+                                            const float* xmaxs, const float* ymaxs,  //
+                                            const float* scores, std::size_t numBoxes, float overlapThresh,
+                                            uint64_t topK)
+{
+    this->sortCandidates(scores, numBoxes, topK);
+
+    for (std::size_t i = 0; i < m_order.size(); ++i) {
+        const uint64_t idx = m_order[i];
+        m_xmins[i] = xmins[idx];
+        m_ymins[i] = ymins[idx];
+        m_xmaxs[i] = xmaxs[idx];
+        m_ymaxs[i] = ymaxs[idx];
+        m_areas[i] = (m_xmaxs[i] - m_xmins[i]) * (m_ymaxs[i] - m_ymins[i]);
+    }
+
+    return this->suppress(overlapThresh);
+}
+
+const std::vector<uint64_t>& NmsEngine::run(const std::vector<std::array<float, 4>>& bboxes,
+                                            const std::vector<float>& scores, float overlapThresh, uint64_t topK)
+{
+    if (bboxes.size() != scores.size()) {
+        throw std::runtime_error("number of boxes and scores mismatch");
+    }
+
+    this->sortCandidates(scores.data(), scores.size(), topK);
+
+    for (std::size_t i = 0; i < m_order.size(); ++i) {
+        const auto& bbox = bboxes[m_order[i]];
+        m_xmins[i] = bbox[0];
+        m_ymins[i] = bbox[1];
+        m_xmaxs[i] = bbox[2];
+        m_ymaxs[i] = bbox[3];
+        m_areas[i] = (bbox[2] - bbox[0]) * (bbox[3] - bbox[1]);
+    }
+
+    return this->suppress(overlapThresh);
+}
+
+void NmsEngine::sortCandidates(const float* scores, std::size_t numBoxes, uint64_t topK)
+{
+    m_order.resize(numBoxes);
+    std::iota(m_order.begin(), m_order.end(), 0);
+
+    const auto higherScore = ::HigherScore{scores};
+
+    if (topK < numBoxes) {
+        std::partial_sort(m_order.begin(), m_order.begin() + topK, m_order.end(), higherScore);
+        m_order.resize(topK);
+    } else {
+        std::sort(m_order.begin(), m_order.end(), higherScore);
+    }
+
+    // padding entries are empty boxes at the origin, which never overlap anything
+    const std::size_t paddedSize = (m_order.size() + BITS_PER_WORD - 1) / BITS_PER_WORD * BITS_PER_WORD;
+    for (auto* buffer : {&m_xmins, &m_ymins, &m_xmaxs, &m_ymaxs, &m_areas}) {
+        buffer->assign(paddedSize, 0.f);
+    }
+    m_suppressed.assign(paddedSize / BITS_PER_WORD, 0);
+}
+
+const std::vector<uint64_t>& NmsEngine::suppress(float overlapThresh)
+{
+    m_keepIndices.clear();
+
+    const std::size_t numCandidates = m_order.size();
+    const std::size_t numWords = m_suppressed.size();
+
+    for (std::size_t i = 0; i < numCandidates; ++i) {
+        if (m_suppressed[i / BITS_PER_WORD] & (uint64_t(1) << (i % BITS_PER_WORD))) {
+            continue;
+        }
+        m_keepIndices.emplace_back(m_order[i]);
+
+        // bits of already visited candidates, including i itself, may get set too; they are never read again
+        const ::ReferenceBox ref{m_xmins[i], m_ymins[i], m_xmaxs[i], m_ymaxs[i], m_areas[i]};
+        ::suppressOverlaps(m_xmins.data(), m_ymins.data(), m_xmaxs.data(), m_ymaxs.data(), m_areas.data(), ref,
+                           overlapThresh, (i + 1) / BITS_PER_WORD, numWords, m_suppressed.data());
+    }
+
+    return m_keepIndices;
+}
+
+MultiClassNmsEngine::MultiClassNmsEngine(std::size_t numThreads)
+    : m_numThreads(numThreads ? numThreads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1))
+    , m_engines(m_numThreads)
+{
+}
+
+template <typename BoxAt>
+void MultiClassNmsEngine::partitionByClass(std::size_t numBoxes, const BoxAt& boxAt, const float* scores,
+                                           const uint64_t* classIndices)
+{
+    const std::size_t numClasses = numBoxes == 0 ? 0 : *std::max_element(classIndices, classIndices + numBoxes) + 1;
+
+    m_classOffsets.assign(numClasses + 1, 0);
+    for (std::size_t i = 0; i < numBoxes; ++i) {
+        ++m_classOffsets[classIndices[i] + 1];
+    }
+    std::partial_sum(m_classOffsets.begin(), m_classOffsets.end(), m_classOffsets.begin());
+
+    m_partitionedIndices.resize(numBoxes);
+    for (auto* buffer : {&m_xmins, &m_ymins, &m_xmaxs, &m_ymaxs, &m_scores}) {
+        buffer->resize(numBoxes);
+    }
+
+    // boxes keep their relative order inside a class, so that score ties resolve as in the class agnostic nms
+    m_cursors.assign(m_classOffsets.begin(), m_classOffsets.end() - 1);
+    for (std::size_t i = 0; i < numBoxes; ++i) {
+        const std::size_t pos = m_cursors[classIndices[i]]++;
+        const std::array<float, 4> bbox = boxAt(i);
+        m_partitionedIndices[pos] = i;
+        m_xmins[pos] = bbox[0];
+        m_ymins[pos] = bbox[1];
+        m_xmaxs[pos] = bbox[2];
+        m_ymaxs[pos] = bbox[3];
+        m_scores[pos] = scores[i];
+    }
+
+    m_classKeepIndices.resize(numClasses);
+    for (auto& keepIndices : m_classKeepIndices) {
+        keepIndices.clear();
+    }
+}
+
+const MultiClassNmsEngine::Result& MultiClassNmsEngine::run(const std::vector<std::array<float, 4>>& bboxes,
+                                                            const std::vector<float>& scores,
+                                                            const std::vector<uint64_t>& classIndices,
+                                                            float overlapThresh, uint64_t topKPerClass, uint64_t topK)
+{
+    if (bboxes.size() != scores.size() || bboxes.size() != classIndices.size()) {
+        throw std::runtime_error("number of boxes, scores and class indices mismatch");
+    }
+
+    this->partitionByClass(
+        bboxes.size(), [&bboxes](std::size_t i) { return bboxes[i]; }, scores.data(), classIndices.data());
+    return this->suppress(scores.data(), classIndices.data(), overlapThresh, topKPerClass, topK);
+}
+
+const MultiClassNmsEngine::Result& MultiClassNmsEngine::run(const float* xmins, const float* ymins,  //
+                                                            const float* xmaxs, const float* ymaxs,  //
+                                                            const float* scores, const uint64_t* classIndices,
+                                                            std::size_t numBoxes, float overlapThresh,
+                                                            uint64_t topKPerClass, uint64_t topK)
+{
+    this->partitionByClass(
+        numBoxes,
+        [=](std::size_t i) {
+            return std::array<float, 4>{xmins[i], ymins[i], xmaxs[i], ymaxs[i]};
+        },
+        scores, classIndices);
+    return this->suppress(scores, classIndices, overlapThresh, topKPerClass, topK);
+}
+
+const MultiClassNmsEngine::Result& MultiClassNmsEngine::suppress(const float* scores, const uint64_t* classIndices,
+                                                                 float overlapThresh, uint64_t topKPerClass,
+                                                                 uint64_t topK)
+{
+    const std::size_t numBoxes = m_partitionedIndices.size();
+    const std::size_t numClasses = m_classKeepIndices.size();
+
+    // biggest classes first, so that no worker is left alone with a big class at the end
+    m_schedule.clear();
+    for (std::size_t c = 0; c < numClasses; ++c) {
+        if (m_classOffsets[c + 1] > m_classOffsets[c]) {
+            m_schedule.emplace_back(c);
+        }
+    }
+    std::sort(m_schedule.begin(), m_schedule.end(), [this](std::size_t lhs, std::size_t rhs) {
+        return m_classOffsets[lhs + 1] - m_classOffsets[lhs] > m_classOffsets[rhs + 1] - m_classOffsets[rhs];
+    });
+
+    const std::size_t numWorkers =
+        Ort::numParallelWorkers(m_schedule.size(), numBoxes, MIN_CANDIDATES_PER_THREAD, m_numThreads);
+
+    std::atomic<std::size_t> next(0);
+    auto work = [&](NmsEngine* engine) {
+        for (std::size_t i = next++; i < m_schedule.size(); i = next++) {
+            this->suppressClass(engine, m_schedule[i], overlapThresh, topKPerClass);
+        }
+    };
+
+    Ort::runWorkers(numWorkers, [&](const std::size_t w) { work(&m_engines[w]); });
+
+    this->merge(scores, topK);
+    m_result.scores.resize(m_result.indices.size());
+    m_result.classIndices.resize(m_result.indices.size());
+    for (std::size_t i = 0; i < m_result.indices.size(); ++i) {
+        m_result.scores[i] = scores[m_result.indices[i]];
+        m_result.classIndices[i] = classIndices[m_result.indices[i]];
+    }
+
+    return m_result;
+}
+
+void MultiClassNmsEngine::suppressClass(NmsEngine* engine, std::size_t classIdx, float overlapThresh,
+                                        uint64_t topKPerClass)
+{
+    const std::size_t offset = m_classOffsets[classIdx];
+    const std::size_t numBoxes = m_classOffsets[classIdx + 1] - offset;
+
+    const auto& kept = engine->run(m_xmins.data() + offset, m_ymins.data() + offset, m_xmaxs.data() + offset,
+                                   m_ymaxs.data() + offset, m_scores.data() + offset, numBoxes, overlapThresh);
+
+    auto& keepIndices = m_classKeepIndices[classIdx];
+    const std::size_t numKept = std::min<uint64_t>(kept.size(), topKPerClass);
+    keepIndices.resize(numKept);
+    for (std::size_t i = 0; i < numKept; ++i) {
+        keepIndices[i] = m_partitionedIndices[offset + kept[i]];
+    }
+}
+
+void MultiClassNmsEngine::merge(const float* scores, uint64_t topK)
+{
+    auto& indices = m_result.indices;
+    indices.clear();
+    for (const auto& keepIndices : m_classKeepIndices) {
+        indices.insert(indices.end(), keepIndices.begin(), keepIndices.end());
+    }
+
+    const auto higherScore = ::HigherScore{scores};
+    if (topK < indices.size()) {
+        std::partial_sort(indices.begin(), indices.begin() + topK, indices.end(), higherScore);
+        indices.resize(topK);
+    } else {
+        std::sort(indices.begin(), indices.end(), higherScore);
+    }
+}
+
+void SortedCandidates::assign(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& sourceScores,
+                              uint64_t topK)
+{
+    if (bboxes.size() != sourceScores.size()) {
+        throw std::runtime_error("number of boxes and scores mismatch");
+    }
+
+    ::assignCandidates(
+        this, bboxes.size(), [&bboxes](std::size_t i) { return bboxes[i]; }, sourceScores.data(), topK);
+}
+
+void SortedCandidates::assign(const float* xmins, const float* ymins, const float* xmaxs, const float* ymaxs,
+                              const float* sourceScores, std::size_t numBoxes, uint64_t topK)
+{
+    ::assignCandidates(
+        this, numBoxes,
+        [=](std::size_t i) {
+            return std::array<float, 4>{xmins[i], ymins[i], xmaxs[i], ymaxs[i]};
+        },
+        sourceScores, topK);
+}
+
+const NmsResult& SoftNmsEngine::run(const std::vector<std::array<float, 4>>& bboxes, const std::vector<float>& scores,
+                                    const NmsParams& params)
+{
+    m_candidates.assign(bboxes, scores, params.topK);
+    return this->suppress(params);
+}
+
+const NmsResult& SoftNmsEngine::run(const float* xmins, const float* ymins,  //
+                                    const float* xmaxs, const float* ymaxs,  //
+                                    const float* scores, std::size_t numBoxes, const NmsParams& params)
+{
+    m_candidates.assign(xmins, ymins, xmaxs, ymaxs, scores, numBoxes, params.topK);
+    return this->suppress(params);
+}
+
+const NmsResult& SoftNmsEngine::suppress(const NmsParams& params)
+{
+    m_result.indices.clear();
+    m_result.scores.clear();
+    m_result.classIndices.clear();
+
+    auto& candidates = m_candidates;
+    std::size_t numCandidates = candidates.size();
+    m_ious.resize(numCandidates);
+
+    // candidates are sorted, so the first maximum is the first one
+    std::size_t best = 0;
+    while (numCandidates > 0 && candidates.scores[best] >= params.scoreThresh) {
+        m_result.indices.emplace_back(candidates.indices[best]);
+        m_result.scores.emplace_back(candidates.scores[best]);
+        const ::ReferenceBox ref = ::referenceBox(candidates, best);
+
+        // the selected box leaves the candidates: swap it with the last one
+        --numCandidates;
+        for (auto* buffer : {&candidates.xmins, &candidates.ymins, &candidates.xmaxs, &candidates.ymaxs,
+                             &candidates.areas, &candidates.scores}) {
+            (*buffer)[best] = (*buffer)[numCandidates];
+        }
+        candidates.indices[best] = candidates.indices[numCandidates];
+
+        ::computeOverlaps(candidates, ref, 0, numCandidates, m_ious.data());
+
+        float* liveScores = candidates.scores.data();
+        const float* ious = m_ious.data();
+        if (params.decay == DecayFunction::LINEAR) {
+            for (std::size_t j = 0; j < numCandidates; ++j) {
+                liveScores[j] *= ious[j] > params.overlapThresh ? 1 - ious[j] : 1.f;
+            }
+        } else {
+            // most candidates do not overlap the selected box at all
+            for (std::size_t j = 0; j < numCandidates; ++j) {
+                if (ious[j] > 0) {
+                    liveScores[j] *= std::exp(-ious[j] * ious[j] / params.sigma);
+                }
+            }
+        }
+
+        best = std::max_element(liveScores, liveScores + numCandidates) - liveScores;
+    }
+
+    return m_result;
+}
+
+MatrixNmsEngine::MatrixNmsEngine(std::size_t numThreads)
+    : m_numThreads(numThreads ? numThreads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1))
+    , m_ious(m_numThreads)
+{
+}
+
+const NmsResult& MatrixNmsEngine::run(const std::vector<std::array<float, 4>>& bboxes,
+                                      const std::vector<float>& scores, const NmsParams& params)
+{
+    m_candidates.assign(bboxes, scores, params.topK);
+    return this->suppress(params);
+}
+
+const NmsResult& MatrixNmsEngine::run(const float* xmins, const float* ymins,  //
+                                      const float* xmaxs, const float* ymaxs,  //
+                                      const float* scores, std::size_t numBoxes, const NmsParams& params)
+{
+    m_candidates.assign(xmins, ymins, xmaxs, ymaxs, scores, numBoxes, params.topK);
+    return this->suppress(params);
+}
+
+const NmsResult& MatrixNmsEngine::suppress(const NmsParams& params)
+{
+    const std::size_t numCandidates = m_candidates.size();
+    m_compensateIous.assign(numCandidates, 0.f);
+    m_decays.resize(numCandidates);
+    for (auto& ious : m_ious) {
+        ious.resize(numCandidates);
+    }
+
+    const std::size_t numWorkers =
+        Ort::numParallelWorkers(numCandidates, numCandidates, MIN_MATRIX_COLUMNS_PER_THREAD, m_numThreads);
+
+    if (numWorkers == 1) {
+        this->computeDecays(0, numCandidates, params, true, m_ious[0].data());
+    } else {
+        ::parallelForColumns(numWorkers, numCandidates, [&](std::size_t worker, std::size_t begin, std::size_t end) {
+            this->computeCompensateIous(begin, end, m_ious[worker].data());
+        });
+        ::parallelForColumns(numWorkers, numCandidates, [&](std::size_t worker, std::size_t begin, std::size_t end) {
+            this->computeDecays(begin, end, params, false, m_ious[worker].data());
+        });
+    }
+
+    // decays reorder the candidates: sort the surviving positions again, by decayed score
+    std::vector<uint64_t>& positions = m_result.indices;
+    positions.clear();
+    for (std::size_t j = 0; j < numCandidates; ++j) {
+        m_decays[j] *= m_candidates.scores[j];
+        if (m_decays[j] >= params.scoreThresh) {
+            positions.emplace_back(j);
+        }
+    }
+    std::sort(positions.begin(), positions.end(), ::HigherScore{m_decays.data()});
+
+    m_result.scores.resize(positions.size());
+    m_result.classIndices.clear();
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        m_result.scores[i] = m_decays[positions[i]];
+        positions[i] = m_candidates.indices[positions[i]];
+    }
+
+    return m_result;
+}
+
+void MatrixNmsEngine::computeCompensateIous(std::size_t begin, std::size_t end, float* ious)
+{
+    for (std::size_t i = 0; i + 1 < end; ++i) {
+        const std::size_t first = std::max(i + 1, begin);
+        ::computeOverlaps(m_candidates, ::referenceBox(m_candidates, i), first, end, ious);
+        for (std::size_t j = first; j < end; ++j) {
+            m_compensateIous[j] = std::max(m_compensateIous[j], ious[j]);
+        }
+    }
+}
+
+void MatrixNmsEngine::computeDecays(std::size_t begin, std::size_t end, const NmsParams& params,
+                                    bool updateCompensateIous, float* ious)
+{
+    // the gaussian decay is monotonic in iou^2 - compensateIou^2: track its maximum, exponentiate once per column
+    const bool linear = params.decay == DecayFunction::LINEAR;
+    std::fill(m_decays.begin() + begin, m_decays.begin() + end, linear ? 1.f : 0.f);
+
+    float* decays = m_decays.data();
+    float* compensateIous = m_compensateIous.data();
+    for (std::size_t i = 0; i + 1 < end; ++i) {
+        const std::size_t first = std::max(i + 1, begin);
+        ::computeOverlaps(m_candidates, ::referenceBox(m_candidates, i), first, end, ious);
+
+        if (updateCompensateIous) {
+            for (std::size_t j = first; j < end; ++j) {
+                compensateIous[j] = std::max(compensateIous[j], ious[j]);
+            }
+        }
+
+        const float compensateIou = compensateIous[i];
+        if (linear) {
+            const float compensate = 1 - compensateIou;
+            for (std::size_t j = first; j < end; ++j) {
+                decays[j] = std::min(decays[j], (1 - ious[j]) / compensate);
+            }
+        } else {
+            const float compensate = compensateIou * compensateIou;
+            for (std::size_t j = first; j < end; ++j) {
+                decays[j] = std::max(decays[j], ious[j] * ious[j] - compensate);
+            }
+        }
+    }
+
+    if (!linear) {
+        for (std::size_t j = begin; j < end; ++j) {
+            decays[j] = std::exp(-decays[j] / params.sigma);
+        }
+    }
+}
+}  // namespace Ort
@@ -22,4 +22,40 @@ ObjectDetectionOrtSessionHandler::~ObjectDetectionOrtSessionHandler()
 {
 }
 
+void ObjectDetectionOrtSessionHandler::detect(const std::vector<DataOutputType>& inferenceOutput,     //
+                                              const std::vector<std::array<int64_t, 2>>& imageSizes,  //
+                                              const float confThresh,                                 //
+                                              DetectionBatch* detections) const
+{
+    detections->clear();
+    for (std::size_t imageIdx = 0; imageIdx < imageSizes.size(); ++imageIdx) {
+        detections->beginImage();
+        this->decode(inferenceOutput, imageIdx, confThresh, detections);
+    }
+
+    detections->nms(m_nmsParams);
+
+    for (std::size_t imageIdx = 0; imageIdx < imageSizes.size(); ++imageIdx) {
+        this->rescale(imageIdx, imageSizes[imageIdx][0], imageSizes[imageIdx][1], detections);
+    }
+}
+
+void ObjectDetectionOrtSessionHandler::updateInputSize(const int64_t width, const int64_t height)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("invalid input size");
+    }
+    m_inputImageWidth = width;
+    m_inputImageHeight = height;
+}
+
+void ObjectDetectionOrtSessionHandler::rescale(const std::size_t imageIdx, const int64_t imageWidth,
+                                               const int64_t imageHeight, DetectionBatch* detections) const
+{
+    if (m_inputImageWidth <= 0 || m_inputImageHeight <= 0) {
+        throw std::runtime_error("input size is not set, see updateInputSize");
+    }
+    detections->rescale(imageIdx, 1.f * imageWidth / m_inputImageWidth, 1.f * imageHeight / m_inputImageHeight,
+                        imageWidth, imageHeight);
+}
 }  // namespace Ort
@@ -16,11 +16,19 @@
 
 #include <algorithm>
 #include <cassert>
+#include <mutex>
 #include <numeric>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "PreprocessCustomOp.hpp"
 
 namespace
 {
+// custom op instances must outlive every session that uses them
+const Ort::ImagePreprocessCustomOp IMAGE_PREPROCESS_CUSTOM_OP;
+
 std::string toString(const ONNXTensorElementDataType dataType)
 {
     switch (dataType) {
@@ -76,6 +84,35 @@ std::string toString(const ONNXTensorElementDataType dataType)
             return "undefined";
     }
 }
+
+std::size_t elementSize(const ONNXTensorElementDataType dataType)
+{
+    switch (dataType) {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL: {
+            return 1;
+        }
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16: {
+            return 2;
+        }
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32: {
+            return 4;
+        }
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64: {
+            return 8;
+        }
+        default:
+            throw std::runtime_error("unsupported tensor element type: " + toString(dataType));
+    }
+}
 }  // namespace
 
 namespace Ort
@@ -109,11 +146,58 @@ class OrtSessionHandler::OrtSessionHandlerIml
         }
     }
 
+    bool inputIsFloat16(std::size_t inputIdx) const
+    {
+        return inputIdx < m_inputTypes.size() && m_inputTypes[inputIdx] == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16;
+    }
+
+    void selectOutputs(const std::vector<std::size_t>& outputIndices)
+    {
+        if (std::any_of(outputIndices.begin(), outputIndices.end(),
+                        [this](const std::size_t idx) { return idx >= m_numOutputs; })) {
+            throw std::runtime_error("output index out of the model outputs");
+        }
+
+        m_selectedOutputs = outputIndices;
+        if (m_selectedOutputs.empty()) {
+            m_selectedOutputs.resize(m_numOutputs);
+            std::iota(m_selectedOutputs.begin(), m_selectedOutputs.end(), 0);
+        }
+        std::sort(m_selectedOutputs.begin(), m_selectedOutputs.end());
+        m_selectedOutputs.erase(std::unique(m_selectedOutputs.begin(), m_selectedOutputs.end()),
+                                m_selectedOutputs.end());
+
+        m_selectedOutputNames.clear();
+        for (const std::size_t idx : m_selectedOutputs) {
+            m_selectedOutputNames.emplace_back(m_outputNodeNames[idx]);
+        }
+    }
+
+    std::vector<TensorBuffer> allocateInputBuffers(TensorBuffer::PageMode pageMode) const
+    {
+        std::vector<TensorBuffer> buffers;
+        buffers.reserve(m_numInputs);
+
+        for (int i = 0; i < m_numInputs; ++i) {
+            const auto& curInputShape = m_inputShapes[i];
+            if (std::any_of(curInputShape.begin(), curInputShape.end(), [](int64_t dim) { return dim < 0; })) {
+                throw std::runtime_error("input " + std::string(m_inputNodeNames[i]) +
+                                         " has dynamic dimensions, its shape must be set before allocating it");
+            }
+            buffers.emplace_back(m_inputTensorSizes[i] * ::elementSize(m_inputTypes[i]), pageMode);
+        }
+
+        return buffers;
+    }
+
  private:
     void initSession();
     void initModelInfo();
 
  private:
+    // declared first so that it is destroyed after the session
+    Ort::CustomOpDomain m_customOpDomain;
+
     std::string m_modelPath;
 
     mutable Ort::Session m_session;
@@ -125,6 +209,8 @@ class OrtSessionHandler::OrtSessionHandlerIml
     std::vector<std::vector<int64_t>> m_inputShapes;
     std::vector<std::vector<int64_t>> m_outputShapes;
 
+    std::vector<ONNXTensorElementDataType> m_inputTypes;
+
     std::vector<int64_t> m_inputTensorSizes;
     std::vector<int64_t> m_outputTensorSizes;
 
@@ -134,7 +220,22 @@ class OrtSessionHandler::OrtSessionHandlerIml
     std::vector<char*> m_inputNodeNames;
     std::vector<char*> m_outputNodeNames;
 
+    // outputs fetched by a run, in increasing order, and their names owned by m_outputNodeNames
+    std::vector<std::size_t> m_selectedOutputs;
+    std::vector<char*> m_selectedOutputNames;
+
     bool m_inputShapesProvided = false;
+
+    // outputs of the last run of one calling thread, kept alive so that the returned pointers stay valid
+    struct RunOutputs {
+        std::vector<Ort::Value> tensors;
+        // widened copies of fp16 outputs
+        std::vector<std::vector<float>> float16Outputs;
+    };
+
+    // one entry per thread having called operator(), so that concurrent runs do not overwrite each other's outputs
+    mutable std::unordered_map<std::thread::id, RunOutputs> m_runOutputs;
+    mutable std::mutex m_runOutputsMutex;
 };
 
 //-----------------------------------------------------------------------------//
@@ -166,13 +267,15 @@ OrtSessionHandler::OrtSessionHandlerIml::OrtSessionHandlerIml(
     const std::string& modelPath,         //
     const std::optional<size_t>& gpuIdx,  //
     const std::optional<std::vector<std::vector<int64_t>>>& inputShapes)
-    : m_modelPath(modelPath)
+    : m_customOpDomain(PREPROCESS_CUSTOM_OP_DOMAIN)
+    , m_modelPath(modelPath)
     , m_session(nullptr)
     , m_env(nullptr)
     , m_ortAllocator()
     , m_gpuIdx(gpuIdx)
     , m_inputShapes()
     , m_outputShapes()
+    , m_inputTypes()
     , m_numInputs(0)
     , m_numOutputs(0)
     , m_inputNodeNames()
@@ -213,6 +316,9 @@ void OrtSessionHandler::OrtSessionHandlerIml::initSession()
     Ort::SessionOptions sessionOptions;
 
     sessionOptions.SetIntraOpNumThreads(1);
+
+    m_customOpDomain.Add(&IMAGE_PREPROCESS_CUSTOM_OP);
+    sessionOptions.Add(m_customOpDomain);
     // tensorrt options can be customized into sessionOptions
     // https://onnxruntime.ai/docs/execution-providers/TensorRT-ExecutionProvider.html
 
@@ -243,10 +349,11 @@ void OrtSessionHandler::OrtSessionHandlerIml::initSession()
 void OrtSessionHandler::OrtSessionHandlerIml::initModelInfo()
 {
     for (int i = 0; i < m_numInputs; i++) {
-        if (!m_inputShapesProvided) {
-            Ort::TypeInfo typeInfo = m_session.GetInputTypeInfo(i);
-            auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+        Ort::TypeInfo typeInfo = m_session.GetInputTypeInfo(i);
+        auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+        m_inputTypes.emplace_back(tensorInfo.GetElementType());
 
+        if (!m_inputShapesProvided) {
             m_inputShapes.emplace_back(tensorInfo.GetShape());
         }
 
@@ -300,6 +407,8 @@ void OrtSessionHandler::OrtSessionHandlerIml::initModelInfo()
         DEBUG_LOG("%s\n", ssOutputs.str().c_str());
 #endif
     }
+
+    this->selectOutputs({});
 }
 
 std::vector<OrtSessionHandler::DataOutputType>
@@ -316,23 +425,43 @@ OrtSessionHandler::OrtSessionHandlerIml::operator()(const std::vector<float*>& i
     inputTensors.reserve(m_numInputs);
 
     for (int i = 0; i < m_numInputs; ++i) {
-        inputTensors.emplace_back(std::move(
-            Ort::Value::CreateTensor<float>(memoryInfo, const_cast<float*>(inputData[i]), m_inputTensorSizes[i],
-                                            m_inputShapes[i].data(), m_inputShapes[i].size())));
+        inputTensors.emplace_back(std::move(Ort::Value::CreateTensor(
+            memoryInfo, const_cast<float*>(inputData[i]), m_inputTensorSizes[i] * ::elementSize(m_inputTypes[i]),
+            m_inputShapes[i].data(), m_inputShapes[i].size(), m_inputTypes[i])));
     }
 
-    auto outputTensors = m_session.Run(Ort::RunOptions{nullptr}, m_inputNodeNames.data(), inputTensors.data(),
-                                       m_numInputs, m_outputNodeNames.data(), m_numOutputs);
+    // Session::Run is thread-safe, only the outputs of the calling thread are replaced; references to the elements of
+    // an unordered_map stay valid when other threads insert theirs
+    RunOutputs* runOutputs = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_runOutputsMutex);
+        runOutputs = &m_runOutputs[std::this_thread::get_id()];
+    }
 
-    assert(outputTensors.size() == m_numOutputs);
-    std::vector<DataOutputType> outputData;
-    outputData.reserve(m_numOutputs);
+    runOutputs->tensors = m_session.Run(Ort::RunOptions{nullptr}, m_inputNodeNames.data(), inputTensors.data(),
+                                        m_numInputs, m_selectedOutputNames.data(), m_selectedOutputNames.size());
+
+    assert(runOutputs->tensors.size() == m_selectedOutputs.size());
+    // outputs not selected stay {nullptr, {}}
+    std::vector<DataOutputType> outputData(m_numOutputs);
+    runOutputs->float16Outputs.resize(m_numOutputs);
+
+    for (std::size_t k = 0; k < m_selectedOutputs.size(); ++k) {
+        const std::size_t i = m_selectedOutputs[k];
+        auto& elem = runOutputs->tensors[k];
+        const auto tensorInfo = elem.GetTensorTypeAndShapeInfo();
+        const ONNXTensorElementDataType outputType = tensorInfo.GetElementType();
+        DEBUG_LOG("type of output %zu: %s", i + 1, toString(outputType).c_str());
+
+        float* data = elem.GetTensorMutableData<float>();
+        if (outputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+            auto& widened = runOutputs->float16Outputs[i];
+            widened.resize(tensorInfo.GetElementCount());
+            convertFloat16ToFloat(reinterpret_cast<const Float16*>(data), widened.data(), widened.size());
+            data = widened.data();
+        }
 
-    int count = 1;
-    for (auto& elem : outputTensors) {
-        DEBUG_LOG("type of input %d: %s", count++, toString(elem.GetTensorTypeAndShapeInfo().GetElementType()).c_str());
-        outputData.emplace_back(
-            std::make_pair(std::move(elem.GetTensorMutableData<float>()), elem.GetTensorTypeAndShapeInfo().GetShape()));
+        outputData[i] = std::make_pair(data, tensorInfo.GetShape());
     }
 
     return outputData;
@@ -342,4 +471,19 @@ void OrtSessionHandler::updateInputShapes(const std::vector<std::vector<int64_t>
 {
     m_piml->updateInputShapes(inputShapes);
 }
+
+bool OrtSessionHandler::inputIsFloat16(std::size_t inputIdx) const
+{
+    return m_piml->inputIsFloat16(inputIdx);
+}
+
+void OrtSessionHandler::selectOutputs(const std::vector<std::size_t>& outputIndices)
+{
+    m_piml->selectOutputs(outputIndices);
+}
+
+std::vector<TensorBuffer> OrtSessionHandler::allocateInputBuffers(TensorBuffer::PageMode pageMode) const
+{
+    return m_piml->allocateInputBuffers(pageMode);
+}
 }  // namespace Ort
@@ -0,0 +1,66 @@
+/**
+ * @file    ParallelFor.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace Ort
+{
+/**
+ *  @brief number of workers to spread count items costing totalWork over
+ *
+ *  below minWorkPerThread per worker, starting a thread costs more than it saves; there is at least one worker and
+ *  never more workers than items
+ *
+ *  @param maxThreads maximum number of workers, 0 for std::thread::hardware_concurrency()
+ */
+inline std::size_t numParallelWorkers(const std::size_t count, const std::size_t totalWork,
+                                      const std::size_t minWorkPerThread, std::size_t maxThreads)
+{
+    if (maxThreads == 0) {
+        maxThreads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    return std::max<std::size_t>(std::min({count, maxThreads, totalWork / minWorkPerThread}), 1);
+}
+
+/**
+ *  @brief run func(worker) for every worker of [0, numWorkers), worker 0 on the calling thread
+ */
+template <typename Func> void runWorkers(const std::size_t numWorkers, const Func& func)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers > 1 ? numWorkers - 1 : 0);
+    for (std::size_t w = 1; w < numWorkers; ++w) {
+        workers.emplace_back([&func, w] { func(w); });
+    }
+    func(std::size_t(0));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ *  @brief split [0, count) in contiguous ranges of about the same size and run func(begin, end) on each of them,
+ *  one worker per range; items are assumed to cost the same, see numParallelWorkers() for the other parameters
+ */
+template <typename Func>
+void parallelForRanges(const std::size_t count, const std::size_t totalWork, const std::size_t minWorkPerThread,
+                       const std::size_t maxThreads, const Func& func)
+{
+    const std::size_t numWorkers = numParallelWorkers(count, totalWork, minWorkPerThread, maxThreads);
+    if (numWorkers == 1) {
+        func(std::size_t(0), count);
+        return;
+    }
+
+    runWorkers(numWorkers, [&](const std::size_t w) { func(count * w / numWorkers, count * (w + 1) / numWorkers); });
+}
+}  // namespace Ort
@@ -0,0 +1,226 @@
+/**
+ * @file    PreprocessCustomOp.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <ort_utility/ort_utility.hpp>
+
+#include "PreprocessCustomOp.hpp"
+
+namespace
+{
+float getFloatAttribute(const OrtApi& api, const OrtKernelInfo* info, const char* name, float defaultVal)
+{
+    float value = defaultVal;
+    if (OrtStatus* status = api.KernelInfoGetAttribute_float(info, name, &value)) {
+        api.ReleaseStatus(status);
+        return defaultVal;
+    }
+    return value;
+}
+
+int64_t getIntAttribute(const OrtApi& api, const OrtKernelInfo* info, const char* name, int64_t defaultVal)
+{
+    int64_t value = defaultVal;
+    if (OrtStatus* status = api.KernelInfoGetAttribute_int64(info, name, &value)) {
+        api.ReleaseStatus(status);
+        return defaultVal;
+    }
+    return value;
+}
+
+std::vector<float> getFloatsAttribute(const OrtApi& api, const OrtKernelInfo* info, const char* name)
+{
+    size_t size = 0;
+    if (OrtStatus* status = api.KernelInfoGetAttributeArray_float(info, name, nullptr, &size)) {
+        api.ReleaseStatus(status);
+        return {};
+    }
+
+    std::vector<float> values(size);
+    Ort::ThrowOnError(api.KernelInfoGetAttributeArray_float(info, name, values.data(), &size));
+    return values;
+}
+
+std::vector<int64_t> getShape(const OrtApi& api, const OrtValue* value)
+{
+    OrtTensorTypeAndShapeInfo* info = nullptr;
+    Ort::ThrowOnError(api.GetTensorTypeAndShape(value, &info));
+
+    size_t numDims = 0;
+    Ort::ThrowOnError(api.GetDimensionsCount(info, &numDims));
+    std::vector<int64_t> shape(numDims);
+    Ort::ThrowOnError(api.GetDimensions(info, shape.data(), numDims));
+    api.ReleaseTensorTypeAndShapeInfo(info);
+
+    return shape;
+}
+
+// everything one output row needs, so rows can be dispatched to the intra-op thread pool
+struct PreprocessJob {
+    const uint8_t* src;
+    float* dst;
+    int64_t srcHeight;
+    int64_t srcWidth;
+    int64_t numChannels;
+    int64_t dstHeight;
+    int64_t dstWidth;
+    const int64_t* xOffsets;
+    const float* xWeights;
+    const float* alphas;
+    const float* betas;
+    const int64_t* channelMap;
+};
+
+void processRow(void* userData, size_t rowIdx)
+{
+    const auto& job = *static_cast<const PreprocessJob*>(userData);
+    const int64_t batchIdx = rowIdx / job.dstHeight;
+    const int64_t y = rowIdx % job.dstHeight;
+
+    const float srcY =
+        std::clamp((y + 0.5f) * job.srcHeight / job.dstHeight - 0.5f, 0.f, static_cast<float>(job.srcHeight - 1));
+    const int64_t y0 = std::min<int64_t>(srcY, std::max<int64_t>(job.srcHeight - 2, 0));
+    const int64_t y1 = std::min(y0 + 1, job.srcHeight - 1);
+    const float wy = srcY - y0;
+
+    const int64_t srcStride = job.srcWidth * job.numChannels;
+    const uint8_t* batchSrc = job.src + batchIdx * job.srcHeight * srcStride;
+    const uint8_t* row0 = batchSrc + y0 * srcStride;
+    const uint8_t* row1 = batchSrc + y1 * srcStride;
+    const int64_t nextPixel = job.srcWidth > 1 ? job.numChannels : 0;
+
+    const int64_t planeSize = job.dstHeight * job.dstWidth;
+    float* batchDst = job.dst + batchIdx * job.numChannels * planeSize + y * job.dstWidth;
+
+    for (int64_t c = 0; c < job.numChannels; ++c) {
+        const int64_t srcC = job.channelMap[c];
+        const float alpha = job.alphas[c];
+        const float beta = job.betas[c];
+        float* dstRow = batchDst + c * planeSize;
+        for (int64_t x = 0; x < job.dstWidth; ++x) {
+            const float wx = job.xWeights[x];
+            const uint8_t* p0 = row0 + job.xOffsets[x] + srcC;
+            const uint8_t* p1 = row1 + job.xOffsets[x] + srcC;
+            const float top = p0[0] + (p0[nextPixel] - p0[0]) * wx;
+            const float bottom = p1[0] + (p1[nextPixel] - p1[0]) * wx;
+            dstRow[x] = (top + (bottom - top) * wy) * alpha + beta;
+        }
+    }
+}
+}  // namespace
+
+namespace Ort
+{
+ImagePreprocessKernel::ImagePreprocessKernel(const OrtApi& api, const OrtKernelInfo* info)
+    : m_api(api)
+    , m_height(::getIntAttribute(api, info, "height", 0))
+    , m_width(::getIntAttribute(api, info, "width", 0))
+    , m_scale(::getFloatAttribute(api, info, "scale", 1.0))
+    , m_swapRB(::getIntAttribute(api, info, "swap_rb", 0) != 0)
+    , m_mean(::getFloatsAttribute(api, info, "mean"))
+    , m_std(::getFloatsAttribute(api, info, "std"))
+{
+    if (m_mean.size() != m_std.size()) {
+        throw std::runtime_error("mean and std attributes of ImagePreprocess must have the same size");
+    }
+}
+
+void ImagePreprocessKernel::Compute(OrtKernelContext* context)
+{
+    const OrtValue* input = nullptr;
+    Ort::ThrowOnError(m_api.KernelContext_GetInput(context, 0, &input));
+
+    const std::vector<int64_t> inputShape = ::getShape(m_api, input);
+    if (inputShape.size() != 4) {
+        throw std::runtime_error("ImagePreprocess expects an input of shape [N, H, W, C]");
+    }
+
+    const int64_t batchSize = inputShape[0];
+    const int64_t srcHeight = inputShape[1];
+    const int64_t srcWidth = inputShape[2];
+    const int64_t numChannels = inputShape[3];
+    const int64_t dstHeight = m_height > 0 ? m_height : srcHeight;
+    const int64_t dstWidth = m_width > 0 ? m_width : srcWidth;
+
+    if (!m_mean.empty() && m_mean.size() != static_cast<std::size_t>(numChannels)) {
+        throw std::runtime_error("mean and std of ImagePreprocess must have one value per channel, got " +
+                                 std::to_string(m_mean.size()) + " for " + std::to_string(numChannels) + " channels");
+    }
+    if (m_swapRB && numChannels < 3) {
+        throw std::runtime_error("swap_rb of ImagePreprocess needs at least 3 channels");
+    }
+
+    const int64_t outputShape[4] = {batchSize, numChannels, dstHeight, dstWidth};
+    OrtValue* output = nullptr;
+    Ort::ThrowOnError(m_api.KernelContext_GetOutput(context, 0, outputShape, 4, &output));
+
+    void* srcData = nullptr;
+    void* dstData = nullptr;
+    Ort::ThrowOnError(m_api.GetTensorMutableData(const_cast<OrtValue*>(input), &srcData));
+    Ort::ThrowOnError(m_api.GetTensorMutableData(output, &dstData));
+
+    // (x * scale - mean) / std folded into x * alpha + beta
+    std::vector<float> alphas(numChannels, m_scale);
+    std::vector<float> betas(numChannels, 0);
+    std::vector<int64_t> channelMap(numChannels);
+    for (int64_t c = 0; c < numChannels; ++c) {
+        if (!m_mean.empty()) {
+            alphas[c] = m_scale / m_std[c];
+            betas[c] = -m_mean[c] / m_std[c];
+        }
+        channelMap[c] = c;
+    }
+    if (m_swapRB) {
+        std::swap(channelMap[0], channelMap[2]);
+    }
+
+    std::vector<int64_t> xOffsets(dstWidth);
+    std::vector<float> xWeights(dstWidth);
+    for (int64_t x = 0; x < dstWidth; ++x) {
+        const float srcX = std::clamp((x + 0.5f) * srcWidth / dstWidth - 0.5f, 0.f, static_cast<float>(srcWidth - 1));
+        const int64_t x0 = std::min<int64_t>(srcX, std::max<int64_t>(srcWidth - 2, 0));
+        xOffsets[x] = x0 * numChannels;
+        xWeights[x] = srcWidth > 1 ? srcX - x0 : 0;
+    }
+
+    ::PreprocessJob job{static_cast<const uint8_t*>(srcData),
+                        static_cast<float*>(dstData),
+                        srcHeight,
+                        srcWidth,
+                        numChannels,
+                        dstHeight,
+                        dstWidth,
+                        xOffsets.data(),
+                        xWeights.data(),
+                        alphas.data(),
+                        betas.data(),
+                        channelMap.data()};
+    const size_t numRows = batchSize * dstHeight;
+
+#if ORT_API_VERSION >= 16
+    Ort::ThrowOnError(m_api.KernelContext_ParallelFor(context, ::processRow, numRows, 0, &job));
+#else
+    // the intra-op thread pool is only exposed to custom ops from onnxruntime 1.16
+    for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+        ::processRow(&job, rowIdx);
+    }
+#endif
+}
+
+void* ImagePreprocessCustomOp::CreateKernel(const OrtApi& api, const OrtKernelInfo* info) const
+{
+    return new ImagePreprocessKernel(api, info);
+}
+
+const char* ImagePreprocessCustomOp::GetName() const
+{
+    return OrtSessionHandler::PREPROCESS_CUSTOM_OP_NAME;
+}
+}  // namespace Ort
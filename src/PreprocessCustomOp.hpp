@@ -0,0 +1,72 @@
+/**
+ * @file    PreprocessCustomOp.hpp
+ *
+ * @author  btran
+ *
+ */
+
+#pragma once
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+#include <vector>
+
+namespace Ort
+{
+/**
+ *  @brief onnxruntime kernel doing the resize/normalize/transpose step of the handlers' preprocess
+ *
+ *  input: uint8 frame of shape [N, H, W, C], as stored by opencv
+ *  output: float tensor of shape [N, C, height, width]
+ *
+ *  attributes:
+ *    height, width (int): output size, bilinearly resized; 0 or missing keeps the input size
+ *    scale (float, default 1): applied first, 1/255 for most models
+ *    mean, std (floats, default 0 and 1): one value per channel, applied after scale
+ *    swap_rb (int, default 0): swap the first and third channels (BGR <-> RGB)
+ */
+class ImagePreprocessKernel
+{
+ public:
+    ImagePreprocessKernel(const OrtApi& api, const OrtKernelInfo* info);
+
+    void Compute(OrtKernelContext* context);
+
+ private:
+    const OrtApi& m_api;
+
+    int64_t m_height;
+    int64_t m_width;
+    float m_scale;
+    bool m_swapRB;
+    std::vector<float> m_mean;
+    std::vector<float> m_std;
+};
+
+struct ImagePreprocessCustomOp : Ort::CustomOpBase<ImagePreprocessCustomOp, ImagePreprocessKernel> {
+    void* CreateKernel(const OrtApi& api, const OrtKernelInfo* info) const;
+
+    const char* GetName() const;
+
+    size_t GetInputTypeCount() const
+    {
+        return 1;
+    }
+
+    ONNXTensorElementDataType GetInputType(size_t /*index*/) const
+    {
+        return ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+    }
+
+    size_t GetOutputTypeCount() const
+    {
+        return 1;
+    }
+
+    ONNXTensorElementDataType GetOutputType(size_t /*index*/) const
+    {
+        return ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+    }
+};
+}  // namespace Ort
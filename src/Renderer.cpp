@@ -0,0 +1,335 @@
+/**
+ * @file    Renderer.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+constexpr int GLYPH_WIDTH = 5;
+constexpr int GLYPH_HEIGHT = 7;
+constexpr char FIRST_GLYPH = ' ';
+constexpr char LAST_GLYPH = '~';
+
+// printable ascii, one byte per column from left to right, bit r of a column lit in row r
+constexpr uint8_t FONT[LAST_GLYPH - FIRST_GLYPH + 1][GLYPH_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00},  // ' '
+    {0x00, 0x00, 0x5f, 0x00, 0x00},  // '!'
+    {0x00, 0x07, 0x00, 0x07, 0x00},  // '"'
+    {0x14, 0x7f, 0x14, 0x7f, 0x14},  // '#'
+    {0x24, 0x2a, 0x7f, 0x2a, 0x12},  // '$'
+    {0x23, 0x13, 0x08, 0x64, 0x62},  // '%'
+    {0x36, 0x49, 0x55, 0x22, 0x50},  // '&'
+    {0x00, 0x05, 0x03, 0x00, 0x00},  // "'"
+    {0x00, 0x1c, 0x22, 0x41, 0x00},  // '('
+    {0x00, 0x41, 0x22, 0x1c, 0x00},  // ')'
+    {0x08, 0x2a, 0x1c, 0x2a, 0x08},  // '*'
+    {0x08, 0x08, 0x3e, 0x08, 0x08},  // '+'
+    {0x00, 0x50, 0x30, 0x00, 0x00},  // ','
+    {0x08, 0x08, 0x08, 0x08, 0x08},  // '-'
+    {0x00, 0x60, 0x60, 0x00, 0x00},  // '.'
+    {0x20, 0x10, 0x08, 0x04, 0x02},  // '/'
+    {0x3e, 0x51, 0x49, 0x45, 0x3e},  // '0'
+    {0x00, 0x42, 0x7f, 0x40, 0x00},  // '1'
+    {0x42, 0x61, 0x51, 0x49, 0x46},  // '2'
+    {0x21, 0x41, 0x45, 0x4b, 0x31},  // '3'
+    {0x18, 0x14, 0x12, 0x7f, 0x10},  // '4'
+    {0x27, 0x45, 0x45, 0x45, 0x39},  // '5'
+    {0x3c, 0x4a, 0x49, 0x49, 0x30},  // '6'
+    {0x01, 0x71, 0x09, 0x05, 0x03},  // '7'
+    {0x36, 0x49, 0x49, 0x49, 0x36},  // '8'
+    {0x06, 0x49, 0x49, 0x29, 0x1e},  // '9'
+    {0x00, 0x36, 0x36, 0x00, 0x00},  // ':'
+    {0x00, 0x56, 0x36, 0x00, 0x00},  // ';'
+    {0x08, 0x14, 0x22, 0x41, 0x00},  // '<'
+    {0x14, 0x14, 0x14, 0x14, 0x14},  // '='
+    {0x00, 0x41, 0x22, 0x14, 0x08},  // '>'
+    {0x02, 0x01, 0x51, 0x09, 0x06},  // '?'
+    {0x32, 0x49, 0x79, 0x41, 0x3e},  // '@'
+    {0x7e, 0x11, 0x11, 0x11, 0x7e},  // 'A'
+    {0x7f, 0x49, 0x49, 0x49, 0x36},  // 'B'
+    {0x3e, 0x41, 0x41, 0x41, 0x22},  // 'C'
+    {0x7f, 0x41, 0x41, 0x22, 0x1c},  // 'D'
+    {0x7f, 0x49, 0x49, 0x49, 0x41},  // 'E'
+    {0x7f, 0x09, 0x09, 0x01, 0x01},  // 'F'
+    {0x3e, 0x41, 0x41, 0x51, 0x32},  // 'G'
+    {0x7f, 0x08, 0x08, 0x08, 0x7f},  // 'H'
+    {0x00, 0x41, 0x7f, 0x41, 0x00},  // 'I'
+    {0x20, 0x40, 0x41, 0x3f, 0x01},  // 'J'
+    {0x7f, 0x08, 0x14, 0x22, 0x41},  // 'K'
+    {0x7f, 0x40, 0x40, 0x40, 0x40},  // 'L'
+    {0x7f, 0x02, 0x04, 0x02, 0x7f},  // 'M'
+    {0x7f, 0x04, 0x08, 0x10, 0x7f},  // 'N'
+    {0x3e, 0x41, 0x41, 0x41, 0x3e},  // 'O'
+    {0x7f, 0x09, 0x09, 0x09, 0x06},  // 'P'
+    {0x3e, 0x41, 0x51, 0x21, 0x5e},  // 'Q'
+    {0x7f, 0x09, 0x19, 0x29, 0x46},  // 'R'
+    {0x46, 0x49, 0x49, 0x49, 0x31},  // 'S'
+    {0x01, 0x01, 0x7f, 0x01, 0x01},  // 'T'
+    {0x3f, 0x40, 0x40, 0x40, 0x3f},  // 'U'
+    {0x1f, 0x20, 0x40, 0x20, 0x1f},  // 'V'
+    {0x7f, 0x20, 0x18, 0x20, 0x7f},  // 'W'
+    {0x63, 0x14, 0x08, 0x14, 0x63},  // 'X'
+    {0x03, 0x04, 0x78, 0x04, 0x03},  // 'Y'
+    {0x61, 0x51, 0x49, 0x45, 0x43},  // 'Z'
+    {0x00, 0x7f, 0x41, 0x41, 0x00},  // '['
+    {0x02, 0x04, 0x08, 0x10, 0x20},  // '\\'
+    {0x00, 0x41, 0x41, 0x7f, 0x00},  // ']'
+    {0x04, 0x02, 0x01, 0x02, 0x04},  // '^'
+    {0x40, 0x40, 0x40, 0x40, 0x40},  // '_'
+    {0x00, 0x01, 0x02, 0x04, 0x00},  // '`'
+    {0x20, 0x54, 0x54, 0x54, 0x78},  // 'a'
+    {0x7f, 0x48, 0x44, 0x44, 0x38},  // 'b'
+    {0x38, 0x44, 0x44, 0x44, 0x20},  // 'c'
+    {0x38, 0x44, 0x44, 0x48, 0x7f},  // 'd'
+    {0x38, 0x54, 0x54, 0x54, 0x18},  // 'e'
+    {0x08, 0x7e, 0x09, 0x01, 0x02},  // 'f'
+    {0x0c, 0x52, 0x52, 0x52, 0x3e},  // 'g'
+    {0x7f, 0x08, 0x04, 0x04, 0x78},  // 'h'
+    {0x00, 0x44, 0x7d, 0x40, 0x00},  // 'i'
+    {0x20, 0x40, 0x44, 0x3d, 0x00},  // 'j'
+    {0x7f, 0x10, 0x28, 0x44, 0x00},  // 'k'
+    {0x00, 0x41, 0x7f, 0x40, 0x00},  // 'l'
+    {0x7c, 0x04, 0x18, 0x04, 0x78},  // 'm'
+    {0x7c, 0x08, 0x04, 0x04, 0x78},  // 'n'
+    {0x38, 0x44, 0x44, 0x44, 0x38},  // 'o'
+    {0x7c, 0x14, 0x14, 0x14, 0x08},  // 'p'
+    {0x08, 0x14, 0x14, 0x18, 0x7c},  // 'q'
+    {0x7c, 0x08, 0x04, 0x04, 0x08},  // 'r'
+    {0x48, 0x54, 0x54, 0x54, 0x20},  // 's'
+    {0x04, 0x3f, 0x44, 0x40, 0x20},  // 't'
+    {0x3c, 0x40, 0x40, 0x20, 0x7c},  // 'u'
+    {0x1c, 0x20, 0x40, 0x20, 0x1c},  // 'v'
+    {0x3c, 0x40, 0x30, 0x40, 0x3c},  // 'w'
+    {0x44, 0x28, 0x10, 0x28, 0x44},  // 'x'
+    {0x0c, 0x50, 0x50, 0x50, 0x3c},  // 'y'
+    {0x44, 0x64, 0x54, 0x4c, 0x44},  // 'z'
+    {0x00, 0x08, 0x36, 0x41, 0x00},  // '{'
+    {0x00, 0x00, 0x7f, 0x00, 0x00},  // '|'
+    {0x00, 0x41, 0x36, 0x08, 0x00},  // '}'
+    {0x02, 0x01, 0x02, 0x04, 0x02},  // '~'
+};
+
+// pixels blended per call of blendRow(): the longer the run, the larger the color terms of every class
+constexpr std::size_t MASK_RUN_PIXELS = 64;
+
+// count pixels of color from dst, doubling the filled part with every copy
+void fillPixels(uint8_t* dst, const std::array<uint8_t, 3>& color, const std::size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    std::memcpy(dst, color.data(), 3);
+    for (std::size_t filled = 1; filled < count;) {
+        const std::size_t numCopied = std::min(filled, count - filled);
+        std::memcpy(dst + 3 * filled, dst, 3 * numCopied);
+        filled += numCopied;
+    }
+}
+
+// [x0, x1) x [y0, y1) clipped to the frame
+void fillRect(int64_t x0, int64_t x1, int64_t y0, int64_t y1, const std::array<uint8_t, 3>& color, uint8_t* frame,
+              const std::size_t width, const std::size_t height, const std::size_t stride)
+{
+    x0 = std::max<int64_t>(x0, 0);
+    y0 = std::max<int64_t>(y0, 0);
+    x1 = std::min<int64_t>(x1, width);
+    y1 = std::min<int64_t>(y1, height);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    uint8_t* firstRow = frame + y0 * stride + 3 * x0;
+    ::fillPixels(firstRow, color, x1 - x0);
+    for (int64_t y = y0 + 1; y < y1; ++y) {
+        std::memcpy(frame + y * stride + 3 * x0, firstRow, 3 * (x1 - x0));
+    }
+}
+}  // namespace
+
+namespace Ort
+{
+Renderer::Renderer(const std::vector<std::string>& classNames, const std::vector<std::array<int, 3>>& colors,
+                   const RenderParams& params)
+    : m_params(params)
+{
+    if (!classNames.empty() && classNames.size() != colors.size()) {
+        throw std::runtime_error("one color per class name is needed");
+    }
+    if (params.boxThickness < 0 || params.textScale <= 0) {
+        throw std::runtime_error("invalid render params");
+    }
+
+    m_colors.resize(colors.size());
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            m_colors[i][c] = std::min(std::max(colors[i][c], 0), 255);
+        }
+    }
+
+    // glyphs advance by their width plus one blank column; the tag pads the text by one blank pixel, all scaled
+    const std::size_t scale = params.textScale;
+    const std::size_t advance = (GLYPH_WIDTH + 1) * scale;
+    m_tagHeight = (GLYPH_HEIGHT + 2) * scale;
+    m_tagOffsets.resize(colors.size());
+    m_tagWidths.resize(colors.size());
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        const std::string text = classNames.empty() ? std::to_string(i) : classNames[i];
+        m_tagOffsets[i] = m_atlas.size();
+        m_tagWidths[i] = text.size() * advance + scale;
+        m_atlas.resize(m_atlas.size() + 3 * m_tagWidths[i] * m_tagHeight);
+
+        uint8_t* tag = m_atlas.data() + m_tagOffsets[i];
+        const std::size_t tagStride = 3 * m_tagWidths[i];
+        ::fillRect(0, m_tagWidths[i], 0, m_tagHeight, m_colors[i], tag, m_tagWidths[i], m_tagHeight, tagStride);
+        for (std::size_t k = 0; k < text.size(); ++k) {
+            // characters out of the font are drawn as '?'
+            const char ch = text[k] >= FIRST_GLYPH && text[k] <= LAST_GLYPH ? text[k] : '?';
+            const uint8_t* glyph = FONT[ch - FIRST_GLYPH];
+            const int64_t x0 = scale + k * advance;
+            for (int col = 0; col < GLYPH_WIDTH; ++col) {
+                for (int row = 0; row < GLYPH_HEIGHT; ++row) {
+                    if (glyph[col] >> row & 1) {
+                        const int64_t x = x0 + col * scale;
+                        const int64_t y = (row + 1) * scale;
+                        ::fillRect(x, x + scale, y, y + scale, {255, 255, 255}, tag, m_tagWidths[i], m_tagHeight,
+                                   tagStride);
+                    }
+                }
+            }
+        }
+    }
+
+    m_maskFrameWeight = Ort::blendFrameWeight(params.maskAlpha);
+    m_maskTerms.resize(colors.size() * 3 * MASK_RUN_PIXELS);
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        for (std::size_t k = 0; k < 3 * MASK_RUN_PIXELS; ++k) {
+            m_maskTerms[i * 3 * MASK_RUN_PIXELS + k] = Ort::blendColorTerm(m_colors[i][k % 3], m_maskFrameWeight);
+        }
+    }
+}
+
+void Renderer::drawDetections(const DetectionBatch& detections, const std::size_t imageIdx, uint8_t* frame,
+                              const std::size_t width, const std::size_t height, const std::size_t stride) const
+{
+    if (imageIdx >= detections.numImages()) {
+        throw std::runtime_error("image index out of the batch");
+    }
+
+    // tags over all the boxes, none hidden by the outline of a neighbour
+    const std::size_t begin = detections.imageBegin(imageIdx);
+    const std::size_t end = detections.imageEnd(imageIdx);
+    for (std::size_t i = begin; i < end; ++i) {
+        this->drawBox(detections.bbox(i), detections.classIdx(i), frame, width, height, stride);
+    }
+    for (std::size_t i = begin; i < end; ++i) {
+        this->drawTag(detections.bbox(i), detections.classIdx(i), frame, width, height, stride);
+    }
+}
+
+void Renderer::drawMasks(const uint16_t* instanceIds, const DetectionBatch& detections, const std::size_t imageIdx,
+                         uint8_t* frame, const std::size_t width, const std::size_t height,
+                         const std::size_t stride) const
+{
+    if (imageIdx >= detections.numImages()) {
+        throw std::runtime_error("image index out of the batch");
+    }
+
+    const std::size_t begin = detections.imageBegin(imageIdx);
+    const std::size_t numInstances = detections.imageEnd(imageIdx) - begin;
+    for (std::size_t y = 0; y < height; ++y) {
+        const uint16_t* ids = instanceIds + y * width;
+        // only read inside the frame: border rows are outlined whole
+        const bool isBorderRow = y == 0 || y + 1 == height;
+        const uint16_t* prevIds = isBorderRow ? ids : ids - width;
+        const uint16_t* nextIds = isBorderRow ? ids : ids + width;
+        uint8_t* row = frame + y * stride;
+
+        // runs of one instance share its color terms
+        for (std::size_t x = 0; x < width;) {
+            const uint16_t id = ids[x];
+            if (id == 0) {
+                ++x;
+                continue;
+            }
+            if (id > numInstances) {
+                throw std::runtime_error("instance id without a detection");
+            }
+            const uint64_t classIdx = detections.classIdx(begin + id - 1);
+            if (classIdx >= m_colors.size()) {
+                throw std::runtime_error("class index without a color");
+            }
+
+            std::size_t runEnd = x + 1;
+            while (runEnd < width && ids[runEnd] == id) {
+                ++runEnd;
+            }
+
+            const uint16_t* terms = m_maskTerms.data() + classIdx * 3 * MASK_RUN_PIXELS;
+            for (std::size_t k = x; k < runEnd; k += MASK_RUN_PIXELS) {
+                Ort::blendRow(terms, m_maskFrameWeight, 3 * std::min(MASK_RUN_PIXELS, runEnd - k), row + 3 * k);
+            }
+
+            // pixels with a 4-neighbour of another instance, or on the frame border, draw the outline as
+            // cv::findContours finds it: both ends of the run, and the pixels whose upper or lower neighbour differs
+            const auto& color = m_colors[classIdx];
+            std::memcpy(row + 3 * x, color.data(), 3);
+            std::memcpy(row + 3 * (runEnd - 1), color.data(), 3);
+            for (std::size_t k = x + 1; k + 1 < runEnd; ++k) {
+                if (isBorderRow || prevIds[k] != id || nextIds[k] != id) {
+                    std::memcpy(row + 3 * k, color.data(), 3);
+                }
+            }
+            x = runEnd;
+        }
+    }
+}
+
+void Renderer::drawBox(const std::array<float, 4>& bbox, const uint64_t classIdx, uint8_t* frame,
+                       const std::size_t width, const std::size_t height, const std::size_t stride) const
+{
+    if (classIdx >= m_colors.size()) {
+        throw std::runtime_error("class index without a color");
+    }
+
+    // outlines centered on the box edges, as cv::rectangle
+    const int64_t thickness = m_params.boxThickness;
+    const int64_t xmin = std::lround(bbox[0]) - thickness / 2;
+    const int64_t ymin = std::lround(bbox[1]) - thickness / 2;
+    const int64_t xmax = std::lround(bbox[2]) - thickness / 2;
+    const int64_t ymax = std::lround(bbox[3]) - thickness / 2;
+    const auto& color = m_colors[classIdx];
+
+    ::fillRect(xmin, xmax + thickness, ymin, ymin + thickness, color, frame, width, height, stride);
+    ::fillRect(xmin, xmax + thickness, ymax, ymax + thickness, color, frame, width, height, stride);
+    ::fillRect(xmin, xmin + thickness, ymin + thickness, ymax, color, frame, width, height, stride);
+    ::fillRect(xmax, xmax + thickness, ymin + thickness, ymax, color, frame, width, height, stride);
+}
+
+void Renderer::drawTag(const std::array<float, 4>& bbox, const uint64_t classIdx, uint8_t* frame,
+                       const std::size_t width, const std::size_t height, const std::size_t stride) const
+{
+    // tags of boxes touching the frame border are shifted into the frame
+    const int64_t tagWidth = m_tagWidths[classIdx];
+    const int64_t tagHeight = m_tagHeight;
+    const int64_t x0 = std::min<int64_t>(std::max<int64_t>(std::lround(bbox[0]), 0),
+                                         std::max<int64_t>(width - tagWidth, 0));
+    const int64_t y0 = std::min<int64_t>(std::max<int64_t>(std::lround(bbox[1]), 0),
+                                         std::max<int64_t>(height - tagHeight, 0));
+    const std::size_t numCols = std::min<int64_t>(tagWidth, width);
+    const std::size_t numRows = std::min<int64_t>(tagHeight, height);
+
+    const uint8_t* tag = m_atlas.data() + m_tagOffsets[classIdx];
+    for (std::size_t r = 0; r < numRows; ++r) {
+        std::memcpy(frame + (y0 + r) * stride + 3 * x0, tag + 3 * r * tagWidth, 3 * numCols);
+    }
+}
+}  // namespace Ort
@@ -0,0 +1,287 @@
+/**
+ * @file    Rle.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+// boundaries are collected chunk by chunk, bounding the position buffer
+constexpr std::size_t BOUNDARY_CHUNK_SIZE = 4096;
+
+// side of the square tiles of the transposes, so that both sides stay in cache
+constexpr std::size_t TRANSPOSE_TILE_SIZE = 32;
+
+/**
+ *  @brief write the positions i + 1, i < count, where data[i] != data[i + 1]; data[count] must be readable
+ *
+ *  @return number of positions written, in increasing order
+ */
+using FindBoundariesFunc = std::size_t (*)(const uint16_t* data, std::size_t count, uint32_t* positions);
+
+std::size_t findBoundariesScalar(const uint16_t* data, const std::size_t count, uint32_t* positions)
+{
+    std::size_t numFound = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        positions[numFound] = i + 1;
+        numFound += data[i] != data[i + 1];
+    }
+    return numFound;
+}
+
+#if ORT_UTILITY_X86
+__attribute__((target("avx2,bmi"))) std::size_t findBoundariesAvx2(const uint16_t* data, const std::size_t count,
+                                                                   uint32_t* positions)
+{
+    std::size_t numFound = 0;
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        // two mask bits per 16 bit element, keep the low one
+        uint32_t bits = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(current, next))) & 0x55555555u;
+        while (bits) {
+            positions[numFound++] = i + _tzcnt_u32(bits) / 2 + 1;
+            bits &= bits - 1;
+        }
+    }
+
+    for (; i < count; ++i) {
+        positions[numFound] = i + 1;
+        numFound += data[i] != data[i + 1];
+    }
+    return numFound;
+}
+#endif
+
+FindBoundariesFunc selectFindBoundaries()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) {
+        return findBoundariesAvx2;
+    }
+#endif
+    return findBoundariesScalar;
+}
+
+// one run of the mask of a label ends at position, closing a run of 1 or of 0 depending on the side of the boundary
+inline void closeRun(const uint64_t position, Ort::RleMask* mask, uint64_t* lastBoundary)
+{
+    mask->counts.emplace_back(position - *lastBoundary);
+    *lastBoundary = position;
+}
+}  // namespace
+
+namespace Ort
+{
+uint64_t RleMask::area() const
+{
+    uint64_t result = 0;
+    for (std::size_t i = 1; i < counts.size(); i += 2) {
+        result += counts[i];
+    }
+    return result;
+}
+
+// Ref: https://github.com/cocodataset/cocoapi/blob/master/common/maskApi.c, rleToString
+void RleMask::toString(std::string* dst) const
+{
+    dst->clear();
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        // counts of the same parity are close: store the difference from the previous one
+        int64_t x = counts[i];
+        if (i > 2) {
+            x -= counts[i - 2];
+        }
+
+        // 5 bits per character, the sixth bit telling whether more characters follow
+        bool more = true;
+        while (more) {
+            char c = x & 0x1f;
+            x >>= 5;
+            more = (c & 0x10) ? x != -1 : x != 0;
+            if (more) {
+                c |= 0x20;
+            }
+            dst->push_back(c + 48);
+        }
+    }
+}
+
+// Ref: https://github.com/cocodataset/cocoapi/blob/master/common/maskApi.c, rleFrString
+void RleMask::fromString(const std::string& str, const uint32_t maskHeight, const uint32_t maskWidth)
+{
+    height = maskHeight;
+    width = maskWidth;
+    counts.clear();
+
+    std::size_t p = 0;
+    while (p < str.size()) {
+        int64_t x = 0;
+        int k = 0;
+        bool more = true;
+        while (more) {
+            if (p >= str.size()) {
+                throw std::runtime_error("truncated rle string");
+            }
+            const int64_t c = str[p] - 48;
+            x |= (c & 0x1f) << (5 * k);
+            more = c & 0x20;
+            ++p;
+            ++k;
+            if (!more && (c & 0x10)) {
+                x |= -(int64_t(1) << (5 * k));
+            }
+        }
+        if (counts.size() > 2) {
+            x += counts[counts.size() - 2];
+        }
+        if (x < 0) {
+            throw std::runtime_error("invalid rle string");
+        }
+        counts.emplace_back(x);
+    }
+}
+
+const std::vector<RleMask>& RleCodec::encode(const uint8_t* labels, const std::size_t width, const std::size_t height,
+                                             const std::size_t numLabels, const uint16_t firstLabel)
+{
+    return this->encodeLabels(labels, width, height, numLabels, firstLabel);
+}
+
+const std::vector<RleMask>& RleCodec::encode(const uint16_t* labels, const std::size_t width, const std::size_t height,
+                                             const std::size_t numLabels, const uint16_t firstLabel)
+{
+    return this->encodeLabels(labels, width, height, numLabels, firstLabel);
+}
+
+void RleCodec::decode(const RleMask& mask, const uint8_t label, uint8_t* labels)
+{
+    this->decodeLabels(mask, label, labels);
+}
+
+void RleCodec::decode(const RleMask& mask, const uint16_t label, uint16_t* labels)
+{
+    this->decodeLabels(mask, label, labels);
+}
+
+template <typename Label>
+const std::vector<RleMask>& RleCodec::encodeLabels(const Label* labels, const std::size_t width,
+                                                   const std::size_t height, const std::size_t numLabels,
+                                                   const uint16_t firstLabel)
+{
+    const std::size_t numPixels = width * height;
+    if (numPixels == 0) {
+        throw std::runtime_error("cannot encode an empty label image");
+    }
+
+    m_columnMajor.resize(numPixels + 1);
+    for (std::size_t row0 = 0; row0 < height; row0 += TRANSPOSE_TILE_SIZE) {
+        const std::size_t rowEnd = std::min(row0 + TRANSPOSE_TILE_SIZE, height);
+        for (std::size_t col0 = 0; col0 < width; col0 += TRANSPOSE_TILE_SIZE) {
+            const std::size_t colEnd = std::min(col0 + TRANSPOSE_TILE_SIZE, width);
+            for (std::size_t col = col0; col < colEnd; ++col) {
+                for (std::size_t row = row0; row < rowEnd; ++row) {
+                    m_columnMajor[col * height + row] = labels[row * width + col];
+                }
+            }
+        }
+    }
+    // the padding never differs from the last pixel: the end of the image is closed separately
+    m_columnMajor[numPixels] = m_columnMajor[numPixels - 1];
+
+    m_masks.resize(numLabels);
+    for (auto& mask : m_masks) {
+        mask.height = height;
+        mask.width = width;
+        mask.counts.clear();
+    }
+    m_lastBoundaries.assign(numLabels, 0);
+
+    // index of the mask of label, numLabels when it is not encoded
+    auto maskIndex = [numLabels, firstLabel](const uint16_t label) -> std::size_t {
+        const std::size_t idx = label - firstLabel;
+        return label >= firstLabel && idx < numLabels ? idx : numLabels;
+    };
+
+    // masks start with a run of 0, empty for the mask of the first pixel
+    const std::size_t firstIdx = maskIndex(m_columnMajor[0]);
+    if (firstIdx < numLabels) {
+        m_masks[firstIdx].counts.emplace_back(0);
+    }
+
+    static const FindBoundariesFunc findBoundaries = ::selectFindBoundaries();
+    uint32_t positions[BOUNDARY_CHUNK_SIZE];
+    for (std::size_t begin = 0; begin < numPixels; begin += BOUNDARY_CHUNK_SIZE) {
+        const std::size_t count = std::min(BOUNDARY_CHUNK_SIZE, numPixels - begin);
+        const std::size_t numBoundaries = findBoundaries(m_columnMajor.data() + begin, count, positions);
+        for (std::size_t i = 0; i < numBoundaries; ++i) {
+            // the run of the label before the boundary ends, and so does the run of 0 of the label after it
+            const uint64_t position = begin + positions[i];
+            const std::size_t endingIdx = maskIndex(m_columnMajor[position - 1]);
+            const std::size_t startingIdx = maskIndex(m_columnMajor[position]);
+            if (endingIdx < numLabels) {
+                ::closeRun(position, &m_masks[endingIdx], &m_lastBoundaries[endingIdx]);
+            }
+            if (startingIdx < numLabels) {
+                ::closeRun(position, &m_masks[startingIdx], &m_lastBoundaries[startingIdx]);
+            }
+        }
+    }
+
+    // close the last run of every mask: of 1 for the label of the last pixel, of 0 for the others
+    for (std::size_t i = 0; i < numLabels; ++i) {
+        ::closeRun(numPixels, &m_masks[i], &m_lastBoundaries[i]);
+    }
+
+    return m_masks;
+}
+
+template <typename Label> void RleCodec::decodeLabels(const RleMask& mask, const Label label, Label* labels)
+{
+    const std::size_t height = mask.height;
+    const std::size_t width = mask.width;
+    const std::size_t numPixels = height * width;
+    if (std::accumulate(mask.counts.begin(), mask.counts.end(), uint64_t(0)) != numPixels) {
+        throw std::runtime_error("rle counts do not match the mask size");
+    }
+
+    // runs of 1 are contiguous in column major order: fill them whole, then transpose
+    m_decoded.assign(numPixels, 0);
+    std::size_t position = 0;
+    for (std::size_t i = 0; i < mask.counts.size(); ++i) {
+        if (i % 2) {
+            std::fill_n(m_decoded.begin() + position, mask.counts[i], 1);
+        }
+        position += mask.counts[i];
+    }
+
+    for (std::size_t row0 = 0; row0 < height; row0 += TRANSPOSE_TILE_SIZE) {
+        const std::size_t rowEnd = std::min(row0 + TRANSPOSE_TILE_SIZE, height);
+        for (std::size_t col0 = 0; col0 < width; col0 += TRANSPOSE_TILE_SIZE) {
+            const std::size_t colEnd = std::min(col0 + TRANSPOSE_TILE_SIZE, width);
+            for (std::size_t row = row0; row < rowEnd; ++row) {
+                for (std::size_t col = col0; col < colEnd; ++col) {
+                    Label& dst = labels[row * width + col];
+                    dst = m_decoded[col * height + row] ? label : dst;
+                }
+            }
+        }
+    }
+}
+}  // namespace Ort
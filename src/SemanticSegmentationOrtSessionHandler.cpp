@@ -0,0 +1,146 @@
+/**
+ * @file    SemanticSegmentationOrtSessionHandler.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "ort_utility/ort_utility.hpp"
+
+#include "ParallelFor.hpp"
+
+namespace
+{
+// minimum logits per worker, see Ort::numParallelWorkers()
+constexpr std::size_t MIN_LOGITS_PER_THREAD = 1 << 18;
+
+}  // namespace
+
+namespace Ort
+{
+SemanticSegmentationOrtSessionHandler::SemanticSegmentationOrtSessionHandler(
+    const uint16_t numClasses,            //
+    const std::string& modelPath,         //
+    const std::optional<size_t>& gpuIdx,  //
+    const std::optional<std::vector<std::vector<int64_t>>>& inputShapes)
+    : ImageRecognitionOrtSessionHandlerBase(numClasses, modelPath, gpuIdx, inputShapes)
+{
+}
+
+SemanticSegmentationOrtSessionHandler::~SemanticSegmentationOrtSessionHandler()
+{
+}
+
+void SemanticSegmentationOrtSessionHandler::initColors(const std::vector<std::array<int, 3>>& colors)
+{
+    if (colors.size() > m_colors.size()) {
+        throw std::runtime_error("labels are at most 255");
+    }
+
+    m_colors = {};
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            m_colors[i][c] = std::min(std::max(colors[i][c], 0), 255);
+        }
+    }
+}
+
+void SemanticSegmentationOrtSessionHandler::narrowLabels(const DataOutputType& labelOutput,  //
+                                                         const std::size_t imageIdx,         //
+                                                         uint8_t* labels) const
+{
+    const auto& outputShape = labelOutput.second;
+    if (outputShape.size() < 3 || static_cast<int64_t>(imageIdx) >= outputShape[0]) {
+        throw std::runtime_error("unexpected label map shape");
+    }
+
+    const std::size_t numPixels =
+        std::accumulate(outputShape.begin() + 1, outputShape.end(), int64_t(1), std::multiplies<int64_t>());
+    // the label tensor is int64: the float pointer of the output only carries its address
+    const int64_t* src = reinterpret_cast<const int64_t*>(labelOutput.first) + imageIdx * numPixels;
+    Ort::narrowLabels(src, numPixels, labels);
+}
+
+void SemanticSegmentationOrtSessionHandler::argmaxLabels(const DataOutputType& logitOutput,  //
+                                                         const std::size_t imageIdx,         //
+                                                         uint8_t* labels,                    //
+                                                         float* maxProbs,                    //
+                                                         const std::size_t numThreads) const
+{
+    const auto& outputShape = logitOutput.second;
+    if (outputShape.size() != 4 || static_cast<int64_t>(imageIdx) >= outputShape[0]) {
+        throw std::runtime_error("unexpected logit shape");
+    }
+    if (outputShape[1] != m_numClasses) {
+        throw std::runtime_error("output shape does not match the number of classes");
+    }
+    // checked before the workers start: an exception cannot leave their threads
+    if (m_numClasses == 0 || m_numClasses > 256) {
+        throw std::runtime_error("labels are at most 255");
+    }
+
+    const std::size_t height = outputShape[2];
+    const std::size_t width = outputShape[3];
+    const std::size_t planeSize = height * width;
+    const float* logits = logitOutput.first + imageIdx * m_numClasses * planeSize;
+
+    auto processRows = [&](const std::size_t begin, const std::size_t end) {
+        Ort::argmaxChannels(logits + begin * width, m_numClasses, planeSize, (end - begin) * width,
+                            labels + begin * width, maxProbs ? maxProbs + begin * width : nullptr);
+    };
+
+    // contiguous bands of rows: every pixel costs the same
+    Ort::parallelForRanges(height, m_numClasses * planeSize, MIN_LOGITS_PER_THREAD, numThreads, processRows);
+}
+
+void SemanticSegmentationOrtSessionHandler::overlayLabels(const uint8_t* labels, const std::size_t labelWidth,
+                                                          const std::size_t labelHeight, const float alpha,
+                                                          uint8_t* frame, const std::size_t frameWidth,
+                                                          const std::size_t frameHeight,
+                                                          const std::size_t frameStride) const
+{
+    if (labelWidth == 0 || labelHeight == 0) {
+        throw std::runtime_error("empty label map");
+    }
+
+    const uint16_t frameWeight = Ort::blendFrameWeight(alpha);
+
+    // weighted colors with the rounding term, for every label
+    std::array<std::array<uint16_t, 3>, 256> colorTerms;
+    for (std::size_t label = 0; label < colorTerms.size(); ++label) {
+        for (int c = 0; c < 3; ++c) {
+            colorTerms[label][c] = Ort::blendColorTerm(m_colors[label][c], frameWeight);
+        }
+    }
+
+    // nearest neighbour as cv::INTER_NEAREST: floor(x * labelWidth / frameWidth)
+    thread_local std::vector<uint32_t> labelCols;
+    thread_local std::vector<uint16_t> rowTerms;
+    labelCols.resize(frameWidth);
+    rowTerms.resize(3 * frameWidth);
+    for (std::size_t x = 0; x < frameWidth; ++x) {
+        labelCols[x] = x * labelWidth / frameWidth;
+    }
+
+    std::size_t cachedLabelRow = labelHeight;
+    for (std::size_t y = 0; y < frameHeight; ++y) {
+        const std::size_t labelRow = y * labelHeight / frameHeight;
+        if (labelRow != cachedLabelRow) {
+            const uint8_t* rowLabels = labels + labelRow * labelWidth;
+            for (std::size_t x = 0; x < frameWidth; ++x) {
+                const auto& terms = colorTerms[rowLabels[labelCols[x]]];
+                std::copy(terms.begin(), terms.end(), rowTerms.begin() + 3 * x);
+            }
+            cachedLabelRow = labelRow;
+        }
+        Ort::blendRow(rowTerms.data(), frameWeight, 3 * frameWidth, frame + y * frameStride);
+    }
+}
+}  // namespace Ort
@@ -0,0 +1,149 @@
+/**
+ * @file    TensorBuffer.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+std::size_t roundUp(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#if defined(__linux__)
+void* mapAnonymous(std::size_t mappedSize, int extraFlags)
+{
+    void* data = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+// mappedSize bytes starting on a huge page boundary, so that transparent huge pages can back all of them: mmap only
+// aligns to the base page size, the slack around the aligned range is unmapped again
+void* mapHugePageAligned(std::size_t mappedSize, std::size_t hugePageSize)
+{
+    void* data = ::mapAnonymous(mappedSize + hugePageSize, 0);
+    if (!data) {
+        return nullptr;
+    }
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(data);
+    const uintptr_t aligned = ::roundUp(base, hugePageSize);
+    const std::size_t tailSize = base + hugePageSize - aligned;
+    if (aligned > base) {
+        munmap(data, aligned - base);
+    }
+    if (tailSize) {
+        munmap(reinterpret_cast<void*>(aligned + mappedSize), tailSize);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+}  // namespace
+
+namespace Ort
+{
+TensorBuffer::TensorBuffer(std::size_t numBytes, PageMode pageMode)
+    : m_size(numBytes)
+{
+    if (numBytes == 0) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (pageMode != PageMode::DEFAULT && numBytes >= HUGE_PAGE_SIZE) {
+        // huge page aligned memory is also ALIGNMENT aligned; m_data is the start of the whole mapping either way
+        const std::size_t mappedSize = ::roundUp(numBytes, HUGE_PAGE_SIZE);
+
+#ifdef MAP_HUGETLB
+        if (pageMode == PageMode::HUGETLB) {
+            m_data = ::mapAnonymous(mappedSize, MAP_HUGETLB);
+            if (!m_data) {
+                DEBUG_LOG("no hugetlbfs page left, falling back to transparent huge pages");
+            }
+        }
+#endif
+
+        if (!m_data) {
+            m_data = ::mapHugePageAligned(mappedSize, HUGE_PAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+            if (m_data) {
+                // only a hint: fails harmlessly when transparent huge pages are disabled
+                madvise(m_data, mappedSize, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        if (!m_data) {
+            throw std::bad_alloc();
+        }
+        m_mappedSize = mappedSize;
+        return;
+    }
+#else
+    (void)pageMode;
+#endif
+
+    m_data = std::aligned_alloc(ALIGNMENT, ::roundUp(numBytes, ALIGNMENT));
+    if (!m_data) {
+        throw std::bad_alloc();
+    }
+}
+
+TensorBuffer::~TensorBuffer()
+{
+    this->release();
+}
+
+TensorBuffer::TensorBuffer(TensorBuffer&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_mappedSize(std::exchange(other.m_mappedSize, 0))
+{
+}
+
+TensorBuffer& TensorBuffer::operator=(TensorBuffer&& other) noexcept
+{
+    if (this != &other) {
+        this->release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_mappedSize = std::exchange(other.m_mappedSize, 0);
+    }
+
+    return *this;
+}
+
+void TensorBuffer::release()
+{
+    if (!m_data) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (m_mappedSize) {
+        munmap(m_data, m_mappedSize);
+    } else {
+        std::free(m_data);
+    }
+#else
+    std::free(m_data);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mappedSize = 0;
+}
+}  // namespace Ort
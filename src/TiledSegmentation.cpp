@@ -0,0 +1,341 @@
+/**
+ * @file    TiledSegmentation.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+// origins of the tiles covering length pixels, the last one aligned to the end
+std::vector<int64_t> tileOrigins(const int64_t length, const int64_t tileLength, const int64_t overlap)
+{
+    if (length <= tileLength) {
+        return {0};
+    }
+
+    const int64_t stride = tileLength - overlap;
+    const int64_t numTiles = (length - tileLength + stride - 1) / stride + 1;
+    std::vector<int64_t> origins(numTiles);
+    for (int64_t i = 0; i < numTiles; ++i) {
+        origins[i] = std::min(i * stride, length - tileLength);
+    }
+    return origins;
+}
+
+// [owned[i], owned[i + 1]) are the pixels closer to tile i than to its neighbours
+std::vector<int64_t> ownedBounds(const std::vector<int64_t>& origins, const int64_t length, const int64_t tileLength)
+{
+    std::vector<int64_t> owned(origins.size() + 1);
+    owned.front() = 0;
+    for (std::size_t i = 1; i < origins.size(); ++i) {
+        owned[i] = (origins[i - 1] + tileLength + origins[i]) / 2;
+    }
+    owned.back() = length;
+    return owned;
+}
+
+// 1 in the tile, ramping down to 1 / (overlap + 1) at its borders
+std::vector<float> rampWeights(const int64_t tileLength, const int64_t overlap)
+{
+    std::vector<float> weights(tileLength);
+    for (int64_t i = 0; i < tileLength; ++i) {
+        weights[i] = std::min({1.f, (i + 1.f) / (overlap + 1), static_cast<float>(tileLength - i) / (overlap + 1)});
+    }
+    return weights;
+}
+}  // namespace
+
+namespace Ort
+{
+TiledSegmentation::TiledSegmentation(const std::vector<SemanticSegmentationOrtSessionHandler*>& sessions,  //
+                                     const int64_t tileWidth, const int64_t tileHeight, const int64_t overlap,  //
+                                     const std::size_t batchSize, const std::size_t maxInFlightTiles)
+    : m_tileWidth(tileWidth)
+    , m_tileHeight(tileHeight)
+    , m_overlap(overlap)
+    , m_batchSize(maxInFlightTiles ? std::min(batchSize, maxInFlightTiles) : batchSize)
+    , m_weightsX(::rampWeights(tileWidth, overlap))
+    , m_weightsY(::rampWeights(tileHeight, overlap))
+{
+    if (sessions.empty()) {
+        throw std::runtime_error("at least one session is needed");
+    }
+    if (tileWidth <= 0 || tileHeight <= 0 || overlap < 0 || overlap >= std::min(tileWidth, tileHeight)) {
+        throw std::runtime_error("the overlap must be less than the tile size");
+    }
+    if (batchSize == 0) {
+        throw std::runtime_error("batch size must be more than 0");
+    }
+
+    const std::size_t numWorkers =
+        maxInFlightTiles ? std::min(sessions.size(), std::max<std::size_t>(maxInFlightTiles / m_batchSize, 1))
+                         : sessions.size();
+    m_workers.reserve(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        sessions[i]->updateInputShapes({{static_cast<int64_t>(m_batchSize), 3, tileHeight, tileWidth}});
+        m_workers.emplace_back(
+            Worker{sessions[i], sessions[i]->allocateInputBuffers(), std::vector<uint8_t>(3 * tileWidth * tileHeight)});
+    }
+}
+
+TiledSegmentation::~TiledSegmentation()
+{
+}
+
+void TiledSegmentation::segment(const uint8_t* frame, const int64_t frameWidth, const int64_t frameHeight,
+                                const std::size_t frameStride, uint8_t* labels)
+{
+    if (frameWidth <= 0 || frameHeight <= 0) {
+        throw std::runtime_error("empty frame");
+    }
+
+    m_tileXs = ::tileOrigins(frameWidth, m_tileWidth, m_overlap);
+    m_tileYs = ::tileOrigins(frameHeight, m_tileHeight, m_overlap);
+    m_ownedXs = ::ownedBounds(m_tileXs, frameWidth, m_tileWidth);
+    m_ownedYs = ::ownedBounds(m_tileYs, frameHeight, m_tileHeight);
+    m_logitSums.clear();
+    m_numLogitClasses = 0;
+
+    // the sums cover the rows of the tile rows the workers can hold at once, plus the first one
+    const std::size_t tilesPerRow = m_tileXs.size();
+    const int64_t inFlightTileRows = (m_workers.size() * m_batchSize + tilesPerRow - 1) / tilesPerRow;
+    m_sumRows = std::min(frameHeight, m_tileHeight + inFlightTileRows * (m_tileHeight - m_overlap));
+
+    const std::size_t numBands = m_tileYs.size();
+    m_bandPendingTiles.assign(numBands, 0);
+    for (std::size_t ty = 0; ty < numBands; ++ty) {
+        const int64_t tileEnd = std::min(m_tileYs[ty] + m_tileHeight, frameHeight);
+        for (std::size_t k = ty; k < numBands && m_tileYs[k] < tileEnd; ++k) {
+            m_bandPendingTiles[k] += tilesPerRow;
+        }
+    }
+    if (m_bandMutexes.size() != numBands) {
+        std::vector<std::mutex>(numBands).swap(m_bandMutexes);
+    }
+    m_nextBand = 0;
+    m_argmaxing = false;
+    m_mergeAborted = false;
+
+    // every worker pulls the next batch of tiles once its session is free
+    std::atomic<std::size_t> nextTile(0);
+    std::vector<std::exception_ptr> errors(m_workers.size());
+    auto run = [&](const std::size_t w) {
+        try {
+            this->runWorker(&m_workers[w], &nextTile, frame, frameWidth, frameHeight, frameStride, labels);
+        } catch (...) {
+            errors[w] = std::current_exception();
+            // let the other workers stop after their current batch
+            nextTile = this->numTiles();
+            this->abortMerge();
+        }
+    };
+
+    const std::size_t numWorkers = std::min(m_workers.size(), (this->numTiles() + m_batchSize - 1) / m_batchSize);
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers - 1);
+    for (std::size_t w = 1; w < numWorkers; ++w) {
+        workers.emplace_back(run, w);
+    }
+    run(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void TiledSegmentation::runWorker(Worker* worker, std::atomic<std::size_t>* nextTile, const uint8_t* frame,
+                                  const int64_t frameWidth, const int64_t frameHeight, const std::size_t frameStride,
+                                  uint8_t* labels)
+{
+    const std::size_t numTiles = this->numTiles();
+    const std::size_t tileSize = m_tileWidth * m_tileHeight;
+    // preprocess writes fp16 for fp16 models: the tiles of the batch are input element sizes apart
+    const std::size_t inputTileBytes =
+        3 * tileSize * (worker->session->inputIsFloat16(0) ? sizeof(Float16) : sizeof(float));
+    uint8_t* input = worker->inputBuffers[0].data<uint8_t>();
+
+    while (true) {
+        const std::size_t first = nextTile->fetch_add(m_batchSize);
+        if (first >= numTiles) {
+            return;
+        }
+        // the slots of a last partial batch keep stale tiles whose outputs are ignored
+        const std::size_t last = std::min(first + m_batchSize, numTiles);
+
+        for (std::size_t tileIdx = first; tileIdx < last; ++tileIdx) {
+            this->cropTile(tileIdx, frame, frameWidth, frameHeight, frameStride, worker->tile.data());
+            worker->session->preprocess(reinterpret_cast<float*>(input + (tileIdx - first) * inputTileBytes),
+                                        worker->tile.data(), m_tileWidth, m_tileHeight, 3);
+        }
+
+        const auto inferenceOutput = (*worker->session)({worker->inputBuffers[0].data()});
+        const auto& outputShape = inferenceOutput[0].second;
+        if (outputShape.size() < 3 || outputShape[0] < static_cast<int64_t>(last - first) ||
+            outputShape[outputShape.size() - 2] != m_tileHeight || outputShape.back() != m_tileWidth) {
+            throw std::runtime_error("the segmentation output does not match the tile size");
+        }
+
+        const bool isLogits = outputShape.size() == 4 && outputShape[1] > 1;
+        for (std::size_t tileIdx = first; tileIdx < last; ++tileIdx) {
+            if (isLogits) {
+                const std::size_t numClasses = outputShape[1];
+                this->mergeLogits(inferenceOutput[0].first + (tileIdx - first) * numClasses * tileSize, numClasses,
+                                  tileIdx, frameWidth, frameHeight, labels);
+            } else {
+                // the label tensor is int64: the float pointer of the output only carries its address
+                this->mergeLabels(reinterpret_cast<const int64_t*>(inferenceOutput[0].first) +
+                                      (tileIdx - first) * tileSize,
+                                  tileIdx, frameWidth, labels);
+            }
+        }
+    }
+}
+
+void TiledSegmentation::cropTile(const std::size_t tileIdx, const uint8_t* frame, const int64_t frameWidth,
+                                 const int64_t frameHeight, const std::size_t frameStride, uint8_t* tile) const
+{
+    const int64_t x0 = m_tileXs[tileIdx % m_tileXs.size()];
+    const int64_t y0 = m_tileYs[tileIdx / m_tileXs.size()];
+    const int64_t width = std::min(m_tileWidth, frameWidth - x0);
+    const int64_t height = std::min(m_tileHeight, frameHeight - y0);
+
+    // tiles only overhang frames smaller than them
+    if (width < m_tileWidth || height < m_tileHeight) {
+        std::fill_n(tile, 3 * m_tileWidth * m_tileHeight, 0);
+    }
+    for (int64_t y = 0; y < height; ++y) {
+        std::memcpy(tile + 3 * y * m_tileWidth, frame + (y0 + y) * frameStride + 3 * x0, 3 * width);
+    }
+}
+
+void TiledSegmentation::mergeLabels(const int64_t* tileLabels, const std::size_t tileIdx, const int64_t frameWidth,
+                                    uint8_t* labels) const
+{
+    const std::size_t tx = tileIdx % m_tileXs.size();
+    const std::size_t ty = tileIdx / m_tileXs.size();
+    const int64_t xBegin = m_ownedXs[tx], xEnd = m_ownedXs[tx + 1];
+    const int64_t yBegin = m_ownedYs[ty], yEnd = m_ownedYs[ty + 1];
+
+    // tiles own disjoint pixels: no lock needed
+    for (int64_t y = yBegin; y < yEnd; ++y) {
+        Ort::narrowLabels(tileLabels + (y - m_tileYs[ty]) * m_tileWidth + (xBegin - m_tileXs[tx]), xEnd - xBegin,
+                          labels + y * frameWidth + xBegin);
+    }
+}
+
+void TiledSegmentation::mergeLogits(const float* tileLogits, const std::size_t numClasses, const std::size_t tileIdx,
+                                    const int64_t frameWidth, const int64_t frameHeight, uint8_t* labels)
+{
+    if (numClasses > 256) {
+        throw std::runtime_error("labels are at most 255");
+    }
+
+    const std::size_t ty = tileIdx / m_tileXs.size();
+    const int64_t x0 = m_tileXs[tileIdx % m_tileXs.size()];
+    const int64_t y0 = m_tileYs[ty];
+    const int64_t width = std::min(m_tileWidth, frameWidth - x0);
+    const int64_t height = std::min(m_tileHeight, frameHeight - y0);
+    const std::size_t planeSize = m_sumRows * frameWidth;
+
+    {
+        std::unique_lock<std::mutex> lock(m_logitMutex);
+        if (m_numLogitClasses == 0) {
+            m_numLogitClasses = numClasses;
+            m_logitSums.assign(numClasses * planeSize, 0);
+        } else if (m_numLogitClasses != numClasses) {
+            throw std::runtime_error("tiles with different numbers of classes");
+        }
+
+        // the rows of the tile get their own sums once the bands above are argmaxed
+        m_bandsReleased.wait(lock, [&] {
+            return m_mergeAborted || y0 + height <= this->bandBegin(m_nextBand, frameHeight) + m_sumRows;
+        });
+        if (m_mergeAborted) {
+            return;
+        }
+    }
+
+    // the tile starts its first band and overlaps the next ones
+    std::size_t band = ty;
+    for (; band < m_tileYs.size() && m_tileYs[band] < y0 + height; ++band) {
+        const int64_t yBegin = m_tileYs[band];
+        const int64_t yEnd = std::min(this->bandBegin(band + 1, frameHeight), y0 + height);
+
+        std::lock_guard<std::mutex> bandLock(m_bandMutexes[band]);
+        for (std::size_t c = 0; c < numClasses; ++c) {
+            for (int64_t y = yBegin; y < yEnd; ++y) {
+                const float weightY = m_weightsY[y - y0];
+                const float* src = tileLogits + (c * m_tileHeight + y - y0) * m_tileWidth;
+                float* dst = m_logitSums.data() + c * planeSize + (y % m_sumRows) * frameWidth + x0;
+                for (int64_t x = 0; x < width; ++x) {
+                    dst[x] += weightY * m_weightsX[x] * src[x];
+                }
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_logitMutex);
+    for (std::size_t k = ty; k < band; ++k) {
+        --m_bandPendingTiles[k];
+    }
+    this->argmaxReadyBands(&lock, frameWidth, frameHeight, labels);
+}
+
+void TiledSegmentation::argmaxReadyBands(std::unique_lock<std::mutex>* lock, const int64_t frameWidth,
+                                         const int64_t frameHeight, uint8_t* labels)
+{
+    // bands are released in order by one worker at a time, which also takes the bands completed meanwhile
+    if (m_argmaxing) {
+        return;
+    }
+    m_argmaxing = true;
+
+    const std::size_t planeSize = m_sumRows * frameWidth;
+    while (m_nextBand < m_tileYs.size() && m_bandPendingTiles[m_nextBand] == 0) {
+        const int64_t yBegin = m_tileYs[m_nextBand];
+        const int64_t yEnd = this->bandBegin(m_nextBand + 1, frameHeight);
+        lock->unlock();
+
+        // the rows of a band are contiguous in the sums up to their wrap around
+        for (int64_t y = yBegin; y < yEnd;) {
+            const int64_t end = std::min(yEnd, y - y % m_sumRows + m_sumRows);
+            const std::size_t count = (end - y) * frameWidth;
+            float* sums = m_logitSums.data() + (y % m_sumRows) * frameWidth;
+            Ort::argmaxChannels(sums, m_numLogitClasses, planeSize, count, labels + y * frameWidth);
+            for (std::size_t c = 0; c < m_numLogitClasses; ++c) {
+                std::fill_n(sums + c * planeSize, count, 0.f);
+            }
+            y = end;
+        }
+
+        lock->lock();
+        ++m_nextBand;
+        m_bandsReleased.notify_all();
+    }
+
+    m_argmaxing = false;
+}
+
+void TiledSegmentation::abortMerge()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_logitMutex);
+        m_mergeAborted = true;
+    }
+    m_bandsReleased.notify_all();
+}
+}  // namespace Ort
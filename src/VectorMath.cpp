@@ -0,0 +1,1081 @@
+/**
+ * @file    VectorMath.cpp
+ *
+ * @author  btran
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ORT_UTILITY_X86 1
+#else
+#define ORT_UTILITY_X86 0
+#endif
+
+#include "ort_utility/ort_utility.hpp"
+
+namespace
+{
+using ArgmaxFunc = std::size_t (*)(const float*, std::size_t);
+
+using FindAboveThresholdFunc = std::size_t (*)(const float*, std::size_t, std::size_t, float, uint64_t*);
+
+using TopKFunc = std::size_t (*)(const float*, std::size_t, std::size_t, uint64_t*);
+
+// indices[0, k) is a heap of indices of data whose top is the worst element: the smallest, the latest on ties
+struct WorseFirst {
+    bool operator()(const uint64_t lhs, const uint64_t rhs) const
+    {
+        return data[lhs] > data[rhs] || (data[lhs] == data[rhs] && lhs < rhs);
+    }
+
+    const float* data;
+};
+
+// heap the first k indices; data[indices[0]] is then the value to beat
+void initTopKHeap(const float* data, const std::size_t k, uint64_t* indices)
+{
+    for (std::size_t i = 0; i < k; ++i) {
+        indices[i] = i;
+    }
+    std::make_heap(indices, indices + k, WorseFirst{data});
+}
+
+// idx comes after every index of the heap, so it must be strictly greater than the worst element to enter
+void pushTopK(const float* data, const std::size_t k, const uint64_t idx, uint64_t* indices)
+{
+    if (!(data[idx] > data[indices[0]])) {
+        return;
+    }
+    std::pop_heap(indices, indices + k, WorseFirst{data});
+    indices[k - 1] = idx;
+    std::push_heap(indices, indices + k, WorseFirst{data});
+}
+
+std::size_t finishTopK(const float* data, const std::size_t k, uint64_t* indices)
+{
+    std::sort_heap(indices, indices + k, WorseFirst{data});
+    return k;
+}
+
+std::size_t argmaxScalar(const float* data, const std::size_t size)
+{
+    return std::max_element(data, data + size) - data;
+}
+
+std::size_t findAboveThresholdScalar(const float* data, const std::size_t count, const std::size_t stride,
+                                     const float thresh, uint64_t* indices)
+{
+    std::size_t numFound = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        indices[numFound] = i;
+        numFound += data[i * stride] > thresh;
+    }
+    return numFound;
+}
+
+std::size_t topKScalar(const float* data, const std::size_t size, std::size_t k, uint64_t* indices)
+{
+    k = std::min(k, size);
+    if (k == 0) {
+        return 0;
+    }
+
+    ::initTopKHeap(data, k, indices);
+    for (std::size_t i = k; i < size; ++i) {
+        ::pushTopK(data, k, i, indices);
+    }
+    return ::finishTopK(data, k, indices);
+}
+
+// lanes [0, numLanes) holding an element of interest when a register starts on one
+uint32_t strideLaneMask(const std::size_t stride, const std::size_t numLanes)
+{
+    uint32_t mask = 0;
+    for (std::size_t lane = 0; lane < numLanes; lane += stride) {
+        mask |= 1u << lane;
+    }
+    return mask;
+}
+
+#if ORT_UTILITY_X86
+// first the maximum, then its first position: both passes are branch free over full registers
+__attribute__((target("avx2"))) std::size_t argmaxAvx2(const float* data, const std::size_t size)
+{
+    if (size < 8) {
+        return argmaxScalar(data, size);
+    }
+
+    __m256 maxs = _mm256_loadu_ps(data);
+    std::size_t i = 8;
+    for (; i + 8 <= size; i += 8) {
+        maxs = _mm256_max_ps(maxs, _mm256_loadu_ps(data + i));
+    }
+    __m128 halves = _mm_max_ps(_mm256_castps256_ps128(maxs), _mm256_extractf128_ps(maxs, 1));
+    halves = _mm_max_ps(halves, _mm_movehl_ps(halves, halves));
+    halves = _mm_max_ss(halves, _mm_shuffle_ps(halves, halves, 1));
+    float maxVal = _mm_cvtss_f32(halves);
+    for (; i < size; ++i) {
+        maxVal = std::max(maxVal, data[i]);
+    }
+
+    const __m256 target = _mm256_set1_ps(maxVal);
+    for (i = 0; i + 8 <= size; i += 8) {
+        const int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(data + i), target, _CMP_EQ_OQ));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + (std::find(data + i, data + size, maxVal) - (data + i));
+}
+
+// compare full registers, then only walk the set bits: survivors are usually rare
+__attribute__((target("avx2"))) std::size_t findAboveThresholdAvx2(const float* data, const std::size_t count,
+                                                                   const std::size_t stride, const float thresh,
+                                                                   uint64_t* indices)
+{
+    if (count == 0 || 8 % stride != 0) {
+        return findAboveThresholdScalar(data, count, stride, thresh, indices);
+    }
+
+    // do not read past the last element of interest
+    const std::size_t numValues = (count - 1) * stride + 1;
+    const uint32_t laneMask = ::strideLaneMask(stride, 8);
+    const __m256 threshs = _mm256_set1_ps(thresh);
+
+    std::size_t numFound = 0;
+    std::size_t pos = 0;
+    for (; pos + 8 <= numValues; pos += 8) {
+        uint32_t mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(data + pos), threshs, _CMP_GT_OQ)) & laneMask;
+        while (mask) {
+            indices[numFound++] = (pos + __builtin_ctz(mask)) / stride;
+            mask &= mask - 1;
+        }
+    }
+
+    for (std::size_t i = pos / stride; i < count; ++i) {
+        indices[numFound] = i;
+        numFound += data[i * stride] > thresh;
+    }
+    return numFound;
+}
+
+__attribute__((target("avx2"))) std::size_t topKAvx2(const float* data, const std::size_t size, std::size_t k,
+                                                     uint64_t* indices)
+{
+    k = std::min(k, size);
+    if (k == 0) {
+        return 0;
+    }
+
+    ::initTopKHeap(data, k, indices);
+    __m256 worst = _mm256_set1_ps(data[indices[0]]);
+    std::size_t i = k;
+    for (; i + 8 <= size; i += 8) {
+        uint32_t mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(data + i), worst, _CMP_GT_OQ));
+        if (!mask) {
+            continue;
+        }
+        while (mask) {
+            ::pushTopK(data, k, i + __builtin_ctz(mask), indices);
+            mask &= mask - 1;
+        }
+        worst = _mm256_set1_ps(data[indices[0]]);
+    }
+    for (; i < size; ++i) {
+        ::pushTopK(data, k, i, indices);
+    }
+    return ::finishTopK(data, k, indices);
+}
+
+// gcc 12 reports the _mm512_undefined_ps() placeholders of its own avx-512 headers as maybe-uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f"))) std::size_t argmaxAvx512(const float* data, const std::size_t size)
+{
+    if (size < 16) {
+        return argmaxAvx2(data, size);
+    }
+
+    __m512 maxs = _mm512_loadu_ps(data);
+    std::size_t i = 16;
+    for (; i + 16 <= size; i += 16) {
+        maxs = _mm512_max_ps(maxs, _mm512_loadu_ps(data + i));
+    }
+    float maxVal = _mm512_reduce_max_ps(maxs);
+    for (; i < size; ++i) {
+        maxVal = std::max(maxVal, data[i]);
+    }
+
+    const __m512 target = _mm512_set1_ps(maxVal);
+    for (i = 0; i + 16 <= size; i += 16) {
+        const __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(data + i), target, _CMP_EQ_OQ);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + (std::find(data + i, data + size, maxVal) - (data + i));
+}
+
+__attribute__((target("avx512f"))) std::size_t findAboveThresholdAvx512(const float* data, const std::size_t count,
+                                                                        const std::size_t stride, const float thresh,
+                                                                        uint64_t* indices)
+{
+    if (count == 0 || 16 % stride != 0) {
+        return findAboveThresholdAvx2(data, count, stride, thresh, indices);
+    }
+
+    const std::size_t numValues = (count - 1) * stride + 1;
+    const __mmask16 laneMask = ::strideLaneMask(stride, 16);
+    const __m512 threshs = _mm512_set1_ps(thresh);
+
+    std::size_t numFound = 0;
+    std::size_t pos = 0;
+    for (; pos + 16 <= numValues; pos += 16) {
+        uint32_t mask = _mm512_mask_cmp_ps_mask(laneMask, _mm512_loadu_ps(data + pos), threshs, _CMP_GT_OQ);
+        while (mask) {
+            indices[numFound++] = (pos + __builtin_ctz(mask)) / stride;
+            mask &= mask - 1;
+        }
+    }
+
+    for (std::size_t i = pos / stride; i < count; ++i) {
+        indices[numFound] = i;
+        numFound += data[i * stride] > thresh;
+    }
+    return numFound;
+}
+
+__attribute__((target("avx512f"))) std::size_t topKAvx512(const float* data, const std::size_t size, std::size_t k,
+                                                          uint64_t* indices)
+{
+    k = std::min(k, size);
+    if (k == 0) {
+        return 0;
+    }
+
+    ::initTopKHeap(data, k, indices);
+    __m512 worst = _mm512_set1_ps(data[indices[0]]);
+    std::size_t i = k;
+    for (; i + 16 <= size; i += 16) {
+        uint32_t mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(data + i), worst, _CMP_GT_OQ);
+        if (!mask) {
+            continue;
+        }
+        while (mask) {
+            ::pushTopK(data, k, i + __builtin_ctz(mask), indices);
+            mask &= mask - 1;
+        }
+        worst = _mm512_set1_ps(data[indices[0]]);
+    }
+    for (; i < size; ++i) {
+        ::pushTopK(data, k, i, indices);
+    }
+    return ::finishTopK(data, k, indices);
+}
+
+#pragma GCC diagnostic pop
+#endif
+
+ArgmaxFunc selectArgmax()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return argmaxAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return argmaxAvx2;
+    }
+#endif
+    return argmaxScalar;
+}
+
+FindAboveThresholdFunc selectFindAboveThreshold()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return findAboveThresholdAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return findAboveThresholdAvx2;
+    }
+#endif
+    return findAboveThresholdScalar;
+}
+
+TopKFunc selectTopK()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return topKAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return topKAvx2;
+    }
+#endif
+    return topKScalar;
+}
+
+// exp(x) = 2^n * exp(r) with n = round(x / ln(2)) and |r| <= ln(2) / 2, exp(r) by a polynomial in r
+constexpr float LOG2E = 1.44269504088896341f;
+constexpr float LN2_HI = 0.693359375f;
+constexpr float LN2_LO = -2.12194440e-4f;
+
+// below, exp underflows to 0 even as a subnormal; above, it overflows to infinity
+constexpr float EXP_MIN_INPUT = -104.f;
+constexpr float EXP_MAX_INPUT = 88.7228394f;
+
+// polynomial coefficients of exp(r), from the constant term up
+template <Ort::ExpAccuracy ACCURACY> struct ExpPolynomial;
+
+// relative minimax fit, error 7.5e-5
+template <> struct ExpPolynomial<Ort::ExpAccuracy::LOW> {
+    static constexpr std::size_t DEGREE = 3;
+    static constexpr float COEFFS[DEGREE + 1] = {9.999280572e-01f, 1.000164151e+00f, 5.049632788e-01f,
+                                                 1.656684279e-01f};
+};
+
+// relative minimax fit, error 2.2e-7
+template <> struct ExpPolynomial<Ort::ExpAccuracy::MEDIUM> {
+    static constexpr std::size_t DEGREE = 5;
+    static constexpr float COEFFS[DEGREE + 1] = {1.000000119e+00f, 9.999997020e-01f, 4.999889433e-01f,
+                                                 1.666757464e-01f, 4.191538319e-02f, 8.297654800e-03f};
+};
+
+// cephes expf
+template <> struct ExpPolynomial<Ort::ExpAccuracy::HIGH> {
+    static constexpr std::size_t DEGREE = 7;
+    static constexpr float COEFFS[DEGREE + 1] = {1.f,
+                                                 1.f,
+                                                 5.0000001201e-1f,
+                                                 1.6666665459e-1f,
+                                                 4.1665795894e-2f,
+                                                 8.3334519073e-3f,
+                                                 1.3981999507e-3f,
+                                                 1.9875691500e-4f};
+};
+
+// the same functions for every instruction set, so tails and the scalar fallback round like the simd kernels
+struct ExpKernels {
+    // dst = exp(src)
+    void (*exp)(const float* src, float* dst, std::size_t size);
+
+    // dst = exp(src - offset) unless dst is nullptr, return the sum of exp(src - offset)
+    float (*expSum)(const float* src, float* dst, std::size_t size, float offset);
+
+    // dst = 1 / (1 + exp(-src))
+    void (*sigmoid)(const float* src, float* dst, std::size_t size);
+
+    // dst = exp(src - offsets) unless dst is nullptr, sums += exp(src - offsets)
+    void (*expSubAccumulate)(const float* src, const float* offsets, float* dst, float* sums, std::size_t size);
+};
+
+template <Ort::ExpAccuracy ACCURACY> float expScalar(float x)
+{
+    using Polynomial = ExpPolynomial<ACCURACY>;
+    if (std::isnan(x)) {
+        return x;
+    }
+    x = std::min(std::max(x, EXP_MIN_INPUT), EXP_MAX_INPUT);
+    const float n = std::nearbyint(x * LOG2E);
+    float r = std::fma(-n, LN2_HI, x);
+    r = std::fma(-n, LN2_LO, r);
+
+    float y = Polynomial::COEFFS[Polynomial::DEGREE];
+    for (std::size_t k = Polynomial::DEGREE; k-- > 0;) {
+        y = std::fma(y, r, Polynomial::COEFFS[k]);
+    }
+    return std::ldexp(y, static_cast<int>(n));
+}
+
+template <Ort::ExpAccuracy ACCURACY> void expArrayScalar(const float* src, float* dst, const std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        dst[i] = ::expScalar<ACCURACY>(src[i]);
+    }
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+float expSumScalar(const float* src, float* dst, const std::size_t size, const float offset)
+{
+    // one accumulator, unlike the simd lanes: keep its rounding error low over long rows
+    double sum = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        const float value = ::expScalar<ACCURACY>(src[i] - offset);
+        if (dst) {
+            dst[i] = value;
+        }
+        sum += value;
+    }
+    return static_cast<float>(sum);
+}
+
+template <Ort::ExpAccuracy ACCURACY> void sigmoidArrayScalar(const float* src, float* dst, const std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        dst[i] = 1 / (1 + ::expScalar<ACCURACY>(-src[i]));
+    }
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+void expSubAccumulateScalar(const float* src, const float* offsets, float* dst, float* sums, const std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        const float value = ::expScalar<ACCURACY>(src[i] - offsets[i]);
+        if (dst) {
+            dst[i] = value;
+        }
+        sums[i] += value;
+    }
+}
+
+#if ORT_UTILITY_X86
+template <Ort::ExpAccuracy ACCURACY> __attribute__((target("avx2,fma"))) __m256 expAvx2(__m256 x)
+{
+    using Polynomial = ExpPolynomial<ACCURACY>;
+    // max and min return their second operand when one is NaN: NaN inputs stay NaN
+    x = _mm256_min_ps(_mm256_set1_ps(EXP_MAX_INPUT), _mm256_max_ps(_mm256_set1_ps(EXP_MIN_INPUT), x));
+    const __m256 n =
+        _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_HI), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_LO), r);
+
+    __m256 y = _mm256_set1_ps(Polynomial::COEFFS[Polynomial::DEGREE]);
+    for (std::size_t k = Polynomial::DEGREE; k-- > 0;) {
+        y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(Polynomial::COEFFS[k]));
+    }
+
+    // n spans [-150, 128], more than the exponent field: multiply by 2^(n / 2) and 2^(n - n / 2), both normal
+    const __m256i bias = _mm256_set1_epi32(127);
+    const __m256i n0 = _mm256_cvtps_epi32(n);
+    const __m256i n1 = _mm256_srai_epi32(n0, 1);
+    const __m256 pow2n1 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n1, bias), 23));
+    const __m256 pow2n2 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(n0, n1), bias), 23));
+    return _mm256_mul_ps(_mm256_mul_ps(y, pow2n1), pow2n2);
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx2,fma"))) void expArrayAvx2(const float* src, float* dst, const std::size_t size)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(dst + i, ::expAvx2<ACCURACY>(_mm256_loadu_ps(src + i)));
+    }
+    ::expArrayScalar<ACCURACY>(src + i, dst + i, size - i);
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx2,fma"))) float expSumAvx2(const float* src, float* dst, const std::size_t size,
+                                                     const float offset)
+{
+    const __m256 offsets = _mm256_set1_ps(offset);
+    __m256 sums = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m256 values = ::expAvx2<ACCURACY>(_mm256_sub_ps(_mm256_loadu_ps(src + i), offsets));
+        if (dst) {
+            _mm256_storeu_ps(dst + i, values);
+        }
+        sums = _mm256_add_ps(sums, values);
+    }
+    __m128 halves = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+    halves = _mm_add_ps(halves, _mm_movehl_ps(halves, halves));
+    halves = _mm_add_ss(halves, _mm_shuffle_ps(halves, halves, 1));
+    return _mm_cvtss_f32(halves) + ::expSumScalar<ACCURACY>(src + i, dst ? dst + i : nullptr, size - i, offset);
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx2,fma"))) void sigmoidArrayAvx2(const float* src, float* dst, const std::size_t size)
+{
+    const __m256 ones = _mm256_set1_ps(1);
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m256 negExps = ::expAvx2<ACCURACY>(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_div_ps(ones, _mm256_add_ps(ones, negExps)));
+    }
+    ::sigmoidArrayScalar<ACCURACY>(src + i, dst + i, size - i);
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx2,fma"))) void expSubAccumulateAvx2(const float* src, const float* offsets, float* dst,
+                                                              float* sums, const std::size_t size)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m256 values =
+            ::expAvx2<ACCURACY>(_mm256_sub_ps(_mm256_loadu_ps(src + i), _mm256_loadu_ps(offsets + i)));
+        if (dst) {
+            _mm256_storeu_ps(dst + i, values);
+        }
+        _mm256_storeu_ps(sums + i, _mm256_add_ps(_mm256_loadu_ps(sums + i), values));
+    }
+    ::expSubAccumulateScalar<ACCURACY>(src + i, offsets + i, dst ? dst + i : nullptr, sums + i, size - i);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+template <Ort::ExpAccuracy ACCURACY> __attribute__((target("avx512f"))) __m512 expAvx512(__m512 x)
+{
+    using Polynomial = ExpPolynomial<ACCURACY>;
+    x = _mm512_min_ps(_mm512_set1_ps(EXP_MAX_INPUT), _mm512_max_ps(_mm512_set1_ps(EXP_MIN_INPUT), x));
+    const __m512 n =
+        _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_HI), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_LO), r);
+
+    __m512 y = _mm512_set1_ps(Polynomial::COEFFS[Polynomial::DEGREE]);
+    for (std::size_t k = Polynomial::DEGREE; k-- > 0;) {
+        y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(Polynomial::COEFFS[k]));
+    }
+
+    // scalef computes y * 2^n with a single rounding, subnormal and infinite results included
+    return _mm512_scalef_ps(y, n);
+}
+
+// mask of the size < 16 first lanes
+inline __mmask16 tailMask(const std::size_t size)
+{
+    return static_cast<__mmask16>((1u << size) - 1);
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx512f"))) void expArrayAvx512(const float* src, float* dst, const std::size_t size)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        _mm512_storeu_ps(dst + i, ::expAvx512<ACCURACY>(_mm512_loadu_ps(src + i)));
+    }
+    if (i < size) {
+        const __mmask16 tail = ::tailMask(size - i);
+        _mm512_mask_storeu_ps(dst + i, tail, ::expAvx512<ACCURACY>(_mm512_maskz_loadu_ps(tail, src + i)));
+    }
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx512f"))) float expSumAvx512(const float* src, float* dst, const std::size_t size,
+                                                      const float offset)
+{
+    const __m512 offsets = _mm512_set1_ps(offset);
+    __m512 sums = _mm512_setzero_ps();
+    for (std::size_t i = 0; i < size; i += 16) {
+        const __mmask16 mask = i + 16 <= size ? static_cast<__mmask16>(0xFFFF) : ::tailMask(size - i);
+        const __m512 values = ::expAvx512<ACCURACY>(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, src + i), offsets));
+        if (dst) {
+            _mm512_mask_storeu_ps(dst + i, mask, values);
+        }
+        sums = _mm512_mask_add_ps(sums, mask, sums, values);
+    }
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, sums);
+    return std::accumulate(lanes, lanes + 16, 0.f);
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx512f"))) void sigmoidArrayAvx512(const float* src, float* dst, const std::size_t size)
+{
+    const __m512 ones = _mm512_set1_ps(1);
+    for (std::size_t i = 0; i < size; i += 16) {
+        const __mmask16 mask = i + 16 <= size ? static_cast<__mmask16>(0xFFFF) : ::tailMask(size - i);
+        const __m512 negExps =
+            ::expAvx512<ACCURACY>(_mm512_sub_ps(_mm512_setzero_ps(), _mm512_maskz_loadu_ps(mask, src + i)));
+        _mm512_mask_storeu_ps(dst + i, mask, _mm512_div_ps(ones, _mm512_add_ps(ones, negExps)));
+    }
+}
+
+template <Ort::ExpAccuracy ACCURACY>
+__attribute__((target("avx512f"))) void expSubAccumulateAvx512(const float* src, const float* offsets, float* dst,
+                                                               float* sums, const std::size_t size)
+{
+    for (std::size_t i = 0; i < size; i += 16) {
+        const __mmask16 mask = i + 16 <= size ? static_cast<__mmask16>(0xFFFF) : ::tailMask(size - i);
+        const __m512 values = ::expAvx512<ACCURACY>(
+            _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, src + i), _mm512_maskz_loadu_ps(mask, offsets + i)));
+        if (dst) {
+            _mm512_mask_storeu_ps(dst + i, mask, values);
+        }
+        _mm512_mask_storeu_ps(sums + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, sums + i), values));
+    }
+}
+#pragma GCC diagnostic pop
+#endif
+
+template <Ort::ExpAccuracy ACCURACY> ExpKernels selectExpKernels()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {expArrayAvx512<ACCURACY>, expSumAvx512<ACCURACY>, sigmoidArrayAvx512<ACCURACY>,
+                expSubAccumulateAvx512<ACCURACY>};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {expArrayAvx2<ACCURACY>, expSumAvx2<ACCURACY>, sigmoidArrayAvx2<ACCURACY>,
+                expSubAccumulateAvx2<ACCURACY>};
+    }
+#endif
+    return {expArrayScalar<ACCURACY>, expSumScalar<ACCURACY>, sigmoidArrayScalar<ACCURACY>,
+            expSubAccumulateScalar<ACCURACY>};
+}
+
+const ExpKernels& expKernels(const Ort::ExpAccuracy accuracy)
+{
+    static const ExpKernels kernels[] = {selectExpKernels<Ort::ExpAccuracy::LOW>(),
+                                         selectExpKernels<Ort::ExpAccuracy::MEDIUM>(),
+                                         selectExpKernels<Ort::ExpAccuracy::HIGH>()};
+    return kernels[static_cast<int>(accuracy)];
+}
+
+using NarrowLabelsFunc = void (*)(const int64_t*, std::size_t, uint8_t*);
+
+void narrowLabelsScalar(const int64_t* src, const std::size_t count, uint8_t* dst)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i] = std::min<int64_t>(std::max<int64_t>(src[i], 0), 255);
+    }
+}
+
+#if ORT_UTILITY_X86
+__attribute__((target("avx2"))) __m256i clampLabelsAvx2(const int64_t* src)
+{
+    const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i maxLabel = _mm256_set1_epi64x(255);
+    const __m256i positive = _mm256_blendv_epi8(zero, values, _mm256_cmpgt_epi64(values, zero));
+    return _mm256_blendv_epi8(positive, maxLabel, _mm256_cmpgt_epi64(positive, maxLabel));
+}
+
+__attribute__((target("avx2"))) void narrowLabelsAvx2(const int64_t* src, const std::size_t count, uint8_t* dst)
+{
+    // the low 32 bits of the 4 clamped labels of each register, gathered into the low half
+    const __m256i lowDwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i quarters[4];
+        for (int q = 0; q < 4; ++q) {
+            quarters[q] = _mm256_permutevar8x32_epi32(::clampLabelsAvx2(src + i + 4 * q), lowDwords);
+        }
+        const __m256i first = _mm256_permute2x128_si256(quarters[0], quarters[1], 0x20);
+        const __m256i second = _mm256_permute2x128_si256(quarters[2], quarters[3], 0x20);
+        // packing works within 128 bit lanes: restore the order of the 16 bit words before the last pack
+        const __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(first, second), 0xd8);
+        const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+    }
+
+    ::narrowLabelsScalar(src + i, count - i, dst + i);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f"))) void narrowLabelsAvx512(const int64_t* src, const std::size_t count, uint8_t* dst)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // unsigned saturation once negative labels are cleared
+        const __m512i values = _mm512_max_epi64(_mm512_loadu_si512(src + i), zero);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm512_cvtusepi64_epi8(values));
+    }
+
+    ::narrowLabelsScalar(src + i, count - i, dst + i);
+}
+#pragma GCC diagnostic pop
+#endif
+
+NarrowLabelsFunc selectNarrowLabels()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return narrowLabelsAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return narrowLabelsAvx2;
+    }
+#endif
+    return narrowLabelsScalar;
+}
+
+// blend weights are in 1/256 units
+constexpr int BLEND_SHIFT = 8;
+constexpr int BLEND_ONE = 1 << BLEND_SHIFT;
+
+using BlendRowFunc = void (*)(const uint16_t* colorTerms, uint16_t frameWeight, std::size_t count, uint8_t* dst);
+
+void blendRowScalar(const uint16_t* colorTerms, const uint16_t frameWeight, const std::size_t count, uint8_t* dst)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i] = (dst[i] * frameWeight + colorTerms[i]) >> BLEND_SHIFT;
+    }
+}
+
+#if ORT_UTILITY_X86
+__attribute__((target("avx2"))) void blendRowAvx2(const uint16_t* colorTerms, const uint16_t frameWeight,
+                                                  const std::size_t count, uint8_t* dst)
+{
+    const __m256i weights = _mm256_set1_epi16(frameWeight);
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i)));
+        const __m256i terms = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colorTerms + i));
+        // at most 255 * 256 + 128: fits the unsigned 16 bit words
+        const __m256i blended = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(pixels, weights), terms),
+                                                  BLEND_SHIFT);
+        const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(blended), _mm256_extracti128_si256(blended, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+    }
+
+    ::blendRowScalar(colorTerms + i, frameWeight, count - i, dst + i);
+}
+#endif
+
+BlendRowFunc selectBlendRow()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return blendRowAvx2;
+    }
+#endif
+    return blendRowScalar;
+}
+
+/**
+ *  @brief labels[i] = argmax_c data[i + c * planeStride], maxs[i] its value, the first channel winning ties
+ */
+using ArgmaxChannelsFunc = void (*)(const float* data, std::size_t numChannels, std::size_t planeStride,
+                                    std::size_t count, uint8_t* labels, float* maxs);
+
+void argmaxChannelsScalar(const float* data, const std::size_t numChannels, const std::size_t planeStride,
+                          const std::size_t count, uint8_t* labels, float* maxs)
+{
+    std::copy(data, data + count, maxs);
+    std::fill(labels, labels + count, 0);
+    for (std::size_t c = 1; c < numChannels; ++c) {
+        const float* plane = data + c * planeStride;
+        for (std::size_t i = 0; i < count; ++i) {
+            const bool better = plane[i] > maxs[i];
+            maxs[i] = better ? plane[i] : maxs[i];
+            labels[i] = better ? c : labels[i];
+        }
+    }
+}
+
+#if ORT_UTILITY_X86
+// one register of pixels at a time goes through every plane, keeping the maximum and its channel in registers
+__attribute__((target("avx2"))) void argmaxChannelsAvx2(const float* data, const std::size_t numChannels,
+                                                        const std::size_t planeStride, const std::size_t count,
+                                                        uint8_t* labels, float* maxs)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 best = _mm256_loadu_ps(data + i);
+        __m256i bestChannels = _mm256_setzero_si256();
+        for (std::size_t c = 1; c < numChannels; ++c) {
+            const __m256 values = _mm256_loadu_ps(data + c * planeStride + i);
+            const __m256 better = _mm256_cmp_ps(values, best, _CMP_GT_OQ);
+            best = _mm256_blendv_ps(best, values, better);
+            bestChannels = _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(bestChannels), _mm256_castsi256_ps(_mm256_set1_epi32(c)), better));
+        }
+        _mm256_storeu_ps(maxs + i, best);
+        const __m128i words =
+            _mm_packs_epi32(_mm256_castsi256_si128(bestChannels), _mm256_extracti128_si256(bestChannels, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(labels + i), _mm_packus_epi16(words, words));
+    }
+
+    ::argmaxChannelsScalar(data + i, numChannels, planeStride, count - i, labels + i, maxs + i);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f"))) void argmaxChannelsAvx512(const float* data, const std::size_t numChannels,
+                                                             const std::size_t planeStride, const std::size_t count,
+                                                             uint8_t* labels, float* maxs)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 best = _mm512_loadu_ps(data + i);
+        __m512i bestChannels = _mm512_setzero_si512();
+        for (std::size_t c = 1; c < numChannels; ++c) {
+            const __m512 values = _mm512_loadu_ps(data + c * planeStride + i);
+            const __mmask16 better = _mm512_cmp_ps_mask(values, best, _CMP_GT_OQ);
+            best = _mm512_mask_mov_ps(best, better, values);
+            bestChannels = _mm512_mask_mov_epi32(bestChannels, better, _mm512_set1_epi32(c));
+        }
+        _mm512_storeu_ps(maxs + i, best);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(labels + i), _mm512_cvtepi32_epi8(bestChannels));
+    }
+
+    ::argmaxChannelsAvx2(data + i, numChannels, planeStride, count - i, labels + i, maxs + i);
+}
+#pragma GCC diagnostic pop
+#endif
+
+ArgmaxChannelsFunc selectArgmaxChannels()
+{
+#if ORT_UTILITY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return argmaxChannelsAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return argmaxChannelsAvx2;
+    }
+#endif
+    return argmaxChannelsScalar;
+}
+
+// rows adjacent in memory are processed side by side, one row per simd lane, this many at a time
+constexpr std::size_t ROW_BLOCK_SIZE = 256;
+
+// maxs[i] = max_j data[i + j * elementStride], for i < numRows
+void columnMax(const float* data, const std::size_t elementStride, const std::size_t rowSize,
+               const std::size_t numRows, float* maxs)
+{
+    std::copy(data, data + numRows, maxs);
+    for (std::size_t j = 1; j < rowSize; ++j) {
+        const float* column = data + j * elementStride;
+        for (std::size_t i = 0; i < numRows; ++i) {
+            maxs[i] = std::max(maxs[i], column[i]);
+        }
+    }
+}
+
+bool isContiguous(const Ort::StridedRows& rows)
+{
+    return rows.elementStride == 1 && (rows.numRows <= 1 || rows.rowStride == rows.rowSize);
+}
+
+// rows that are neither contiguous nor adjacent go through a contiguous buffer, one at a time
+template <typename RowFunc> void forEachGatheredRow(const float* src, const Ort::StridedRows& rows, const RowFunc& func)
+{
+    thread_local std::vector<float> buffer;
+    buffer.resize(rows.rowSize);
+    for (std::size_t i = 0; i < rows.numRows; ++i) {
+        const float* row = src + i * rows.rowStride;
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            buffer[j] = row[j * rows.elementStride];
+        }
+        func(i, buffer.data());
+    }
+}
+}  // namespace
+
+namespace Ort
+{
+std::size_t argmax(const float* data, std::size_t size)
+{
+    static const ArgmaxFunc argmaxFunc = ::selectArgmax();
+    return argmaxFunc(data, size);
+}
+
+std::size_t findAboveThreshold(const float* data, std::size_t count, std::size_t stride, float thresh,
+                               uint64_t* indices)
+{
+    static const FindAboveThresholdFunc findFunc = ::selectFindAboveThreshold();
+    return findFunc(data, count, stride, thresh, indices);
+}
+
+std::size_t topK(const float* data, std::size_t size, std::size_t k, uint64_t* indices)
+{
+    static const TopKFunc topKFunc = ::selectTopK();
+    return topKFunc(data, size, k, indices);
+}
+
+void narrowLabels(const int64_t* src, std::size_t count, uint8_t* dst)
+{
+    static const NarrowLabelsFunc narrowFunc = ::selectNarrowLabels();
+    narrowFunc(src, count, dst);
+}
+
+void blendRow(const uint16_t* colorTerms, uint16_t frameWeight, std::size_t count, uint8_t* dst)
+{
+    static const BlendRowFunc blendFunc = ::selectBlendRow();
+    blendFunc(colorTerms, frameWeight, count, dst);
+}
+
+uint16_t blendFrameWeight(const float alpha)
+{
+    return BLEND_ONE - std::lround(std::min(std::max(alpha, 0.f), 1.f) * BLEND_ONE);
+}
+
+uint16_t blendColorTerm(const uint8_t color, const uint16_t frameWeight)
+{
+    return color * (BLEND_ONE - frameWeight) + BLEND_ONE / 2;
+}
+
+float sumExp(const float* data, std::size_t size, float offset)
+{
+    return ::expKernels(ExpAccuracy::HIGH).expSum(data, nullptr, size, offset);
+}
+
+void vectorExp(const float* src, float* dst, std::size_t size, ExpAccuracy accuracy)
+{
+    ::expKernels(accuracy).exp(src, dst, size);
+}
+
+void softmax(const float* src, float* dst, const StridedRows& rows, ExpAccuracy accuracy)
+{
+    if (rows.rowSize == 0) {
+        return;
+    }
+    const auto& kernels = ::expKernels(accuracy);
+
+    if (rows.elementStride == 1) {
+        for (std::size_t i = 0; i < rows.numRows; ++i) {
+            const float* row = src + i * rows.rowStride;
+            float* out = dst + i * rows.rowStride;
+            const float maxVal = row[Ort::argmax(row, rows.rowSize)];
+            const float scale = 1 / kernels.expSum(row, out, rows.rowSize, maxVal);
+            for (std::size_t j = 0; j < rows.rowSize; ++j) {
+                out[j] *= scale;
+            }
+        }
+        return;
+    }
+
+    if (rows.rowStride == 1) {
+        float maxs[ROW_BLOCK_SIZE];
+        float sums[ROW_BLOCK_SIZE];
+        for (std::size_t begin = 0; begin < rows.numRows; begin += ROW_BLOCK_SIZE) {
+            const std::size_t numBlockRows = std::min(ROW_BLOCK_SIZE, rows.numRows - begin);
+            ::columnMax(src + begin, rows.elementStride, rows.rowSize, numBlockRows, maxs);
+            std::fill(sums, sums + numBlockRows, 0.f);
+            for (std::size_t j = 0; j < rows.rowSize; ++j) {
+                const std::size_t offset = begin + j * rows.elementStride;
+                kernels.expSubAccumulate(src + offset, maxs, dst + offset, sums, numBlockRows);
+            }
+            for (std::size_t i = 0; i < numBlockRows; ++i) {
+                sums[i] = 1 / sums[i];
+            }
+            for (std::size_t j = 0; j < rows.rowSize; ++j) {
+                float* out = dst + begin + j * rows.elementStride;
+                for (std::size_t i = 0; i < numBlockRows; ++i) {
+                    out[i] *= sums[i];
+                }
+            }
+        }
+        return;
+    }
+
+    ::forEachGatheredRow(src, rows, [&](const std::size_t i, float* row) {
+        softmax(row, row, StridedRows{1, rows.rowSize, rows.rowSize}, accuracy);
+        float* out = dst + i * rows.rowStride;
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            out[j * rows.elementStride] = row[j];
+        }
+    });
+}
+
+void sigmoid(const float* src, float* dst, const StridedRows& rows, ExpAccuracy accuracy)
+{
+    const auto& kernels = ::expKernels(accuracy);
+
+    if (::isContiguous(rows)) {
+        kernels.sigmoid(src, dst, rows.numRows * rows.rowSize);
+        return;
+    }
+
+    if (rows.elementStride == 1) {
+        for (std::size_t i = 0; i < rows.numRows; ++i) {
+            kernels.sigmoid(src + i * rows.rowStride, dst + i * rows.rowStride, rows.rowSize);
+        }
+        return;
+    }
+
+    if (rows.rowStride == 1) {
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            kernels.sigmoid(src + j * rows.elementStride, dst + j * rows.elementStride, rows.numRows);
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < rows.numRows; ++i) {
+        for (std::size_t j = 0; j < rows.rowSize; ++j) {
+            const std::size_t offset = i * rows.rowStride + j * rows.elementStride;
+            kernels.sigmoid(src + offset, dst + offset, 1);
+        }
+    }
+}
+
+void logSumExp(const float* src, float* dst, const StridedRows& rows, ExpAccuracy accuracy)
+{
+    if (rows.rowSize == 0) {
+        std::fill(dst, dst + rows.numRows, -std::numeric_limits<float>::infinity());
+        return;
+    }
+    const auto& kernels = ::expKernels(accuracy);
+
+    if (rows.elementStride == 1) {
+        for (std::size_t i = 0; i < rows.numRows; ++i) {
+            const float* row = src + i * rows.rowStride;
+            const float maxVal = row[Ort::argmax(row, rows.rowSize)];
+            dst[i] = maxVal + std::log(kernels.expSum(row, nullptr, rows.rowSize, maxVal));
+        }
+        return;
+    }
+
+    if (rows.rowStride == 1) {
+        float maxs[ROW_BLOCK_SIZE];
+        float sums[ROW_BLOCK_SIZE];
+        for (std::size_t begin = 0; begin < rows.numRows; begin += ROW_BLOCK_SIZE) {
+            const std::size_t numBlockRows = std::min(ROW_BLOCK_SIZE, rows.numRows - begin);
+            ::columnMax(src + begin, rows.elementStride, rows.rowSize, numBlockRows, maxs);
+            std::fill(sums, sums + numBlockRows, 0.f);
+            for (std::size_t j = 0; j < rows.rowSize; ++j) {
+                kernels.expSubAccumulate(src + begin + j * rows.elementStride, maxs, nullptr, sums, numBlockRows);
+            }
+            for (std::size_t i = 0; i < numBlockRows; ++i) {
+                dst[begin + i] = maxs[i] + std::log(sums[i]);
+            }
+        }
+        return;
+    }
+
+    ::forEachGatheredRow(src, rows, [&](const std::size_t i, float* row) {
+        logSumExp(row, dst + i, StridedRows{1, rows.rowSize, rows.rowSize}, accuracy);
+    });
+}
+
+void argmaxChannels(const float* data, std::size_t numChannels, std::size_t planeStride, std::size_t count,
+                    uint8_t* labels, float* maxProbs, ExpAccuracy accuracy)
+{
+    if (numChannels == 0 || numChannels > 256) {
+        throw std::runtime_error("argmax over 1 to 256 channels only");
+    }
+    static const ArgmaxChannelsFunc argmaxFunc = ::selectArgmaxChannels();
+
+    // blocks of pixels small enough for their planes to stay in cache between the argmax and the softmax passes
+    float maxs[ROW_BLOCK_SIZE];
+    float sums[ROW_BLOCK_SIZE];
+    for (std::size_t begin = 0; begin < count; begin += ROW_BLOCK_SIZE) {
+        const std::size_t numBlockPixels = std::min(ROW_BLOCK_SIZE, count - begin);
+        argmaxFunc(data + begin, numChannels, planeStride, numBlockPixels, labels + begin, maxs);
+        if (!maxProbs) {
+            continue;
+        }
+
+        const auto& kernels = ::expKernels(accuracy);
+        std::fill(sums, sums + numBlockPixels, 0.f);
+        for (std::size_t c = 0; c < numChannels; ++c) {
+            kernels.expSubAccumulate(data + c * planeStride + begin, maxs, nullptr, sums, numBlockPixels);
+        }
+        // the softmax of the maximum: exp(0) over the sum
+        for (std::size_t i = 0; i < numBlockPixels; ++i) {
+            maxProbs[begin + i] = 1 / sums[i];
+        }
+    }
+}
+}  // namespace Ort